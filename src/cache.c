@@ -0,0 +1,612 @@
+/*
+ *     Copyright (C) 2024 - 2025  Einholz
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU Affero General Public License as published
+ *     by the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU Affero General Public License for more details.
+ *
+ *     You should have received a copy of the GNU Affero General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef TXC_POSIX
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif /* TXC_POSIX */
+
+#include "cache.h"
+#include "node.h"
+#include "parser.h"
+#include "util.h"
+#include "var.h"
+
+// bytes of a cache file, it is created sparse and stops taking new lines once full
+#ifndef TXC_CACHE_FILE_SIZE
+#define TXC_CACHE_FILE_SIZE (64 * 1024 * 1024)
+#endif /* TXC_CACHE_FILE_SIZE */
+
+// hash slots of a cache file, at most half of them are taken
+#ifndef TXC_CACHE_SLOTS
+#define TXC_CACHE_SLOTS (256 * 1024)
+#endif /* TXC_CACHE_SLOTS */
+#if TXC_CACHE_SLOTS < 2 || (TXC_CACHE_SLOTS & (TXC_CACHE_SLOTS - 1)) != 0
+#error "TXC_CACHE_SLOTS has to be a power of 2 of at least 2"
+#endif /* TXC_CACHE_SLOTS < 2 || (TXC_CACHE_SLOTS & (TXC_CACHE_SLOTS - 1)) != 0 */
+#if TXC_CACHE_FILE_SIZE <= 56 + 16 * TXC_CACHE_SLOTS
+#error "TXC_CACHE_FILE_SIZE has to leave room for records after the header and the slots"
+#endif /* TXC_CACHE_FILE_SIZE <= 56 + 16 * TXC_CACHE_SLOTS */
+
+#define TXC_CACHE_MAGIC "TXCCACHE"
+// changes whenever the layout of the file does
+#define TXC_CACHE_FORMAT 2
+
+/* DEFINITIONS */
+
+extern int yylex(void);
+
+// All fields are native endian, as a file is only shared between runs on the same machine.
+struct cache_header {
+    char magic[8];
+    uint32_t version[3];
+    uint32_t format;
+    uint64_t slot_amount;
+    uint64_t size;
+    // end of the records from the start of the file
+    uint64_t used;
+    uint64_t lines;
+};
+
+struct cache_slot {
+    uint64_t hash;
+    // of the record from the start of the file, 0 while the slot is empty
+    uint64_t offset;
+};
+
+// followed by the key, the zero terminated value and the zero terminated lines printed for it, padded to a multiple of 8 bytes
+struct cache_record {
+    uint64_t key_len;
+    uint64_t value_len;
+};
+
+struct token {
+    int kind;
+    size_t offset;
+    size_t len;
+};
+
+#ifdef TXC_POSIX
+static int fd = -1;
+#endif /* TXC_POSIX */
+static unsigned char *map = NULL;
+static struct txc_cache_stats stats = { 0 };
+
+// the line read ahead, handed on to the parser from tokens_next on
+static struct token *tokens = NULL;
+static size_t tokens_used = 0;
+static size_t tokens_size = 0;
+static size_t tokens_next = 0;
+// digits of the integer tokens, yytext is overwritten by reading ahead
+static char *lexemes = NULL;
+static size_t lexemes_used = 0;
+static size_t lexemes_size = 0;
+// a token that did not fit into the buffers, the rest of its line goes to the parser directly
+static int pending = -1;
+static YYSTYPE pending_value;
+static bool direct = false;
+
+// normalized text of the line being parsed, valid until its result is stored
+static char *key = NULL;
+static size_t key_len = 0;
+static size_t key_size = 0;
+static uint64_t key_hash = 0;
+static bool key_valid = false;
+// cached value of the definition being parsed and the lines printed for it
+static char *known = NULL;
+static char *known_lines = NULL;
+
+/* MEMORY */
+
+static bool reserve(void **const buf, size_t *const size, const size_t needed, const size_t elem_size, const char *const purpose)
+{
+    if (needed <= *size)
+        return true;
+    size_t new_size = *size == 0 ? 64 : *size;
+    while (new_size < needed && new_size <= SIZE_MAX / elem_size / 2)
+        new_size *= 2;
+    if (new_size < needed) {
+        TXC_ERROR_OVERFLOW(purpose);
+        return false;
+    }
+    void *const new_buf = realloc(*buf, elem_size * new_size);
+    if (new_buf == NULL) {
+        TXC_ERROR_ALLOC(elem_size * new_size, purpose);
+        return false;
+    }
+    *buf = new_buf;
+    *size = new_size;
+    return true;
+}
+
+static struct cache_header *header(void)
+{
+    return (struct cache_header *)map;
+}
+
+static struct cache_slot *slots(void)
+{
+    return (struct cache_slot *)(map + sizeof(struct cache_header));
+}
+
+static uint64_t records_start(void)
+{
+    return sizeof(struct cache_header) + sizeof(struct cache_slot) * (uint64_t)TXC_CACHE_SLOTS;
+}
+
+static bool header_matches(void)
+{
+    const struct cache_header *const head = header();
+    return memcmp(head->magic, TXC_CACHE_MAGIC, sizeof head->magic) == 0 && head->version[0] == TXC_VERSION_MAJOR && head->version[1] == TXC_VERSION_MINOR
+           && head->version[2] == TXC_VERSION_PATCH && head->format == TXC_CACHE_FORMAT && head->slot_amount == TXC_CACHE_SLOTS && head->size == TXC_CACHE_FILE_SIZE
+           && head->used >= records_start() && head->used <= head->size && head->lines < head->slot_amount;
+}
+
+static void reset(void)
+{
+    memset(map, 0, records_start());
+    struct cache_header *const head = header();
+    memcpy(head->magic, TXC_CACHE_MAGIC, sizeof head->magic);
+    head->version[0] = TXC_VERSION_MAJOR;
+    head->version[1] = TXC_VERSION_MINOR;
+    head->version[2] = TXC_VERSION_PATCH;
+    head->format = TXC_CACHE_FORMAT;
+    head->slot_amount = TXC_CACHE_SLOTS;
+    head->size = TXC_CACHE_FILE_SIZE;
+    head->used = records_start();
+    head->lines = 0;
+}
+
+#ifdef TXC_POSIX
+// Readers share the file, writers and resets have it to themselves.
+static bool lock(const short type)
+{
+    struct flock region;
+    region.l_type = type;
+    region.l_whence = SEEK_SET;
+    region.l_start = 0;
+    region.l_len = 0;
+    while (fcntl(fd, F_SETLKW, &region) != 0) {
+        if (errno != EINTR) {
+            TXC_ERROR_FILE("Locking", "the cache file");
+            return false;
+        }
+    }
+    return true;
+}
+#endif /* TXC_POSIX */
+
+bool txc_cache_open(const char *const path)
+{
+    assert(path != NULL);
+    txc_cache_close();
+#ifdef TXC_POSIX
+    fd = open(path, O_RDWR | O_CREAT, 0666);
+    if (fd < 0) {
+        TXC_ERROR_FILE("Opening", path);
+        return false;
+    }
+    if (!lock(F_WRLCK)) {
+        txc_cache_close();
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (info.st_size != TXC_CACHE_FILE_SIZE && ftruncate(fd, TXC_CACHE_FILE_SIZE) != 0)) {
+        TXC_ERROR_FILE("Sizing", path);
+        txc_cache_close();
+        return false;
+    }
+    void *const mapped = mmap(NULL, TXC_CACHE_FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        TXC_ERROR_FILE("Mapping", path);
+        txc_cache_close();
+        return false;
+    }
+    map = mapped;
+    if (!header_matches())
+        reset();
+    lock(F_UNLCK);
+    return true;
+#else /* TXC_POSIX */
+    TXC_ERROR_NYI("Cache files in this environment");
+    return false;
+#endif /* TXC_POSIX */
+}
+
+void txc_cache_close(void)
+{
+#ifdef TXC_POSIX
+    if (map != NULL)
+        munmap(map, TXC_CACHE_FILE_SIZE);
+    if (fd >= 0)
+        close(fd);
+    fd = -1;
+#endif /* TXC_POSIX */
+    map = NULL;
+    free(tokens);
+    free(lexemes);
+    free(key);
+    free(known);
+    free(known_lines);
+    tokens = NULL;
+    lexemes = NULL;
+    key = NULL;
+    known = NULL;
+    known_lines = NULL;
+    tokens_used = tokens_size = tokens_next = 0;
+    lexemes_used = lexemes_size = 0;
+    key_len = key_size = 0;
+    key_valid = false;
+    pending = -1;
+    direct = false;
+    stats = (struct txc_cache_stats){ 0 };
+}
+
+/* CACHE */
+
+static bool has_lexeme(const int kind)
+{
+    return kind == BIN_INT || kind == DEC_INT || kind == HEX_INT || kind == CARET_DIGIT || kind == VAR;
+}
+
+static const char *spelling(const int kind)
+{
+    switch (kind) {
+    case L_PAREN:
+        return "(";
+    case R_PAREN:
+        return ")";
+    case L_BRACE:
+        return "{";
+    case R_BRACE:
+        return "}";
+    case L_BRACKET:
+        return "[";
+    case R_BRACKET:
+        return "]";
+    case PLUS:
+        return "+";
+    case MINUS:
+        return "-";
+    case BANG:
+        return "!";
+    case CDOT:
+        return "\\cdot";
+    case FRAC:
+        return "\\frac";
+    case BMOD:
+        return "\\bmod";
+    case PMOD:
+        return "\\pmod";
+    case LFLOOR:
+        return "\\lfloor";
+    case RFLOOR:
+        return "\\rfloor";
+    case SQRT:
+        return "\\sqrt";
+    case BINOM:
+        return "\\binom";
+    case CARET: /* FALLTHROUGH */
+    case CARET_DIGIT:
+        return "^";
+    case BIN_INT:
+        return "0b";
+    case DEC_INT:
+        return "";
+    case HEX_INT:
+        return "0x";
+    case VAR:
+        return "";
+    case EQUALS:
+        return "=";
+    case END:
+        return "\\\\";
+    default:
+        return NULL;
+    }
+}
+
+static bool push_token(const int kind)
+{
+    if (!reserve((void **)&tokens, &tokens_size, tokens_used + 1, sizeof *tokens, "cache tokens"))
+        return false;
+    struct token *const token = &tokens[tokens_used];
+    token->kind = kind;
+    token->offset = lexemes_used;
+    token->len = 0;
+    if (has_lexeme(kind)) {
+        // terminated like yytext, as the parser may read up to the end of a lexeme
+        if (!reserve((void **)&lexemes, &lexemes_size, lexemes_used + yylval.pascal_str.len + 1, 1, "cache lexemes"))
+            return false;
+        memcpy(lexemes + lexemes_used, yylval.pascal_str.str, yylval.pascal_str.len);
+        lexemes[lexemes_used + yylval.pascal_str.len] = '\0';
+        token->len = yylval.pascal_str.len;
+        lexemes_used += token->len + 1;
+    }
+    tokens_used++;
+    return true;
+}
+
+static bool append_key(const char *const str, const size_t len)
+{
+    // the key is not allocated before anything is appended
+    if (len == 0)
+        return true;
+    if (!reserve((void **)&key, &key_size, key_len + len, 1, "cache key"))
+        return false;
+    memcpy(key + key_len, str, len);
+    key_len += len;
+    return true;
+}
+
+static bool is_definition(void)
+{
+    return tokens_used > 1 && tokens[0].kind == VAR && tokens[1].kind == EQUALS;
+}
+
+// The variable of token i was referred to before in the line.
+static bool repeated(const size_t i)
+{
+    for (size_t j = is_definition() ? 1 : 0; j < i; j++)
+        if (tokens[j].kind == VAR && tokens[j].len == tokens[i].len && memcmp(lexemes + tokens[j].offset, lexemes + tokens[i].offset, tokens[i].len) == 0)
+            return true;
+    return false;
+}
+
+// Spells out the tokens separated by single spaces, followed by a line for the value of each variable referred to, and hashes them with FNV-1a.
+// Lines referring to a variable which is undefined or a NAN have no key, as their results are NANs as well.
+static bool normalize(void)
+{
+    key_len = 0;
+    for (size_t i = 0; i < tokens_used; i++) {
+        const char *const spelled = spelling(tokens[i].kind);
+        if (spelled == NULL || (i > 0 && !append_key(" ", 1)) || !append_key(spelled, strlen(spelled))
+            || !append_key(lexemes + tokens[i].offset, tokens[i].len))
+            return false;
+    }
+    // lines referring to a redefined variable miss, all others still hit
+    for (size_t i = is_definition() ? 1 : 0; i < tokens_used; i++) {
+        if (tokens[i].kind != VAR || repeated(i))
+            continue;
+        bool nan;
+        const char *const value = txc_var_str(lexemes + tokens[i].offset, tokens[i].len, &nan);
+        if (value == NULL || nan || !append_key("\n", 1) || !append_key(value, strlen(value)))
+            return false;
+    }
+    key_hash = 0xcbf29ce484222325u;
+    for (size_t i = 0; i < key_len; i++)
+        key_hash = (key_hash ^ (unsigned char)key[i]) * 0x100000001b3u;
+    return true;
+}
+
+// NULL unless the slot holds a well formed record of the current key.
+static const char *record_value(const struct cache_slot *const slot)
+{
+    const struct cache_header *const head = header();
+    if (slot->hash != key_hash || slot->offset < records_start() || slot->offset > head->used - sizeof(struct cache_record))
+        return NULL;
+    const struct cache_record *const record = (const struct cache_record *)(map + slot->offset);
+    const uint64_t room = head->used - slot->offset - sizeof *record;
+    if (record->key_len != key_len || record->key_len > room || record->value_len == 0 || record->value_len > room - record->key_len)
+        return NULL;
+    const char *const stored = (const char *)(record + 1);
+    if (memcmp(stored, key, key_len) != 0 || stored[key_len + record->value_len - 1] != '\0' || memchr(stored + key_len, '\0', record->value_len - 1) == NULL)
+        return NULL;
+    return stored + key_len;
+}
+
+// The lines printed for a value returned by record_value, which follow it.
+static const char *record_lines(const char *const value)
+{
+    return value + strlen(value) + 1;
+}
+
+// Prints the cached lines of the current key while the file is locked, so no reset can interfere.
+// Definitions are parsed all the same, so their value and lines are only copied to known and known_lines.
+static bool print_cached(const bool definition)
+{
+#ifdef TXC_POSIX
+    if (!lock(F_RDLCK))
+        return false;
+#endif /* TXC_POSIX */
+    bool found = false;
+    if (header_matches()) {
+        const struct cache_slot *const table = slots();
+        for (uint64_t i = 0; i < TXC_CACHE_SLOTS; i++) {
+            const struct cache_slot *const slot = &table[(key_hash + i) & (TXC_CACHE_SLOTS - 1)];
+            if (slot->offset == 0)
+                break;
+            const char *const value = record_value(slot);
+            if (value != NULL) {
+                if (definition) {
+                    known = txc_strdup(value);
+                    known_lines = txc_strdup(record_lines(value));
+                } else {
+                    fputs(record_lines(value), stdout);
+                }
+                found = !definition || (known != NULL && known_lines != NULL);
+                break;
+            }
+        }
+    }
+#ifdef TXC_POSIX
+    lock(F_UNLCK);
+#endif /* TXC_POSIX */
+    return found;
+}
+
+// A full file keeps its lines but takes no new ones.
+static void store(const char *const value, const char *const lines)
+{
+#ifdef TXC_POSIX
+    if (!lock(F_WRLCK))
+        return;
+#endif /* TXC_POSIX */
+    struct cache_header *const head = header();
+    const size_t len = strlen(value) + 1;
+    const uint64_t value_len = len + strlen(lines) + 1;
+    const uint64_t bytes = (sizeof(struct cache_record) + key_len + value_len + 7) / 8 * 8;
+    if (header_matches() && head->lines < TXC_CACHE_SLOTS / 2 && bytes <= head->size - head->used) {
+        struct cache_slot *const table = slots();
+        for (uint64_t i = 0; i < TXC_CACHE_SLOTS; i++) {
+            struct cache_slot *const slot = &table[(key_hash + i) & (TXC_CACHE_SLOTS - 1)];
+            if (slot->offset != 0 && record_value(slot) == NULL)
+                continue;
+            if (slot->offset == 0) {
+                struct cache_record *const record = (struct cache_record *)(map + head->used);
+                record->key_len = key_len;
+                record->value_len = value_len;
+                memcpy(record + 1, key, key_len);
+                memcpy((char *)(record + 1) + key_len, value, len);
+                memcpy((char *)(record + 1) + key_len + len, lines, value_len - len);
+                // the slot is published last
+                slot->hash = key_hash;
+                slot->offset = head->used;
+                head->used += bytes;
+                head->lines++;
+                stats.stored++;
+            }
+            break;
+        }
+    }
+#ifdef TXC_POSIX
+    lock(F_UNLCK);
+#endif /* TXC_POSIX */
+}
+
+static void read_line(void)
+{
+    tokens_used = 0;
+    tokens_next = 0;
+    lexemes_used = 0;
+    key_valid = false;
+    free(known);
+    free(known_lines);
+    known = NULL;
+    known_lines = NULL;
+    int kind;
+    do {
+        kind = yylex();
+        if (!push_token(kind)) {
+            pending = kind;
+            pending_value = yylval;
+            return;
+        }
+    } while (kind != END && kind != 0);
+    // lines without an expression print nothing
+    if (kind != END || tokens_used < 2 || !normalize())
+        return;
+    const bool definition = is_definition();
+    if (print_cached(definition)) {
+        stats.hits++;
+        // the value of a definition is not computed before a line missing the cache needs it
+        if (!definition)
+            tokens_used = 0;
+        return;
+    }
+    stats.misses++;
+    key_valid = true;
+}
+
+int txc_cache_lex(void)
+{
+    if (map == NULL)
+        return yylex();
+    while (true) {
+        if (tokens_next < tokens_used) {
+            const struct token *const token = &tokens[tokens_next++];
+            if (has_lexeme(token->kind)) {
+                yylval.pascal_str.str = lexemes + token->offset;
+                yylval.pascal_str.len = token->len;
+            }
+            return token->kind;
+        }
+        if (pending >= 0 || direct) {
+            int kind = pending;
+            if (pending >= 0)
+                yylval = pending_value;
+            else
+                kind = yylex();
+            pending = -1;
+            direct = kind != END && kind != 0;
+            return kind;
+        }
+        read_line();
+    }
+}
+
+// Prints the lines for input whose result rendered to str and keeps them in the cache file, the same ones are printed again on a hit.
+static void print_and_store(const txc_node *const input, const char *const str, const bool nan)
+{
+    char *const lines = txc_node_line_str(input, str);
+    if (lines == NULL) {
+        txc_node_print_if_debug(input);
+        txc_node_print_str(str);
+    } else {
+        fputs(lines, stdout);
+    }
+    // NANs might stem from a lack of memory and are not kept
+    if (map != NULL && key_valid && str != NULL && lines != NULL && !nan)
+        store(str, lines);
+    key_valid = false;
+    free(lines);
+}
+
+void txc_cache_simplify_and_print(const txc_node *const node)
+{
+    // variables are evaluated once the simplification reaches them, results referring to them are not kept past the line
+    bool nan;
+    char *const str = txc_node_simplify_to_str(node, &nan);
+    print_and_store(node, str, nan);
+    free(str);
+}
+
+void txc_cache_define_and_print(const txc_node *const var, const txc_node *const definition)
+{
+    const txc_node *const error = txc_var_define(var, definition, known);
+    free(known);
+    known = NULL;
+    if (error != NULL || known_lines != NULL) {
+        if (error != NULL)
+            txc_node_print(error);
+        else
+            fputs(known_lines, stdout);
+        free(known_lines);
+        known_lines = NULL;
+        key_valid = false;
+        return;
+    }
+    const char *const name = txc_node_variable_name(var);
+    bool nan;
+    const char *const str = txc_var_str(name, strlen(name), &nan);
+    print_and_store(definition, str, nan);
+}
+
+struct txc_cache_stats txc_cache_stats(void)
+{
+    return stats;
+}
@@ -0,0 +1,58 @@
+/*
+ *     Copyright (C) 2024 - 2025  Einholz
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU Affero General Public License as published
+ *     by the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU Affero General Public License for more details.
+ *
+ *     You should have received a copy of the GNU Affero General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TXC_CACHE
+#define TXC_CACHE
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "node.h"
+
+/* DEFINITIONS */
+
+struct txc_cache_stats {
+    size_t hits;
+    size_t misses;
+    size_t stored;
+};
+
+/* MEMORY */
+
+// The output of whole lines in a memory mapped file, keyed by the tokens of the line with whitespace ignored and the values of its variables.
+// The file is shared by all runs of the same version and reset by runs of another one.
+extern bool txc_cache_open(const char *const path);
+
+extern void txc_cache_close(void);
+
+/* CACHE */
+
+// Stands in for yylex. With a cache file open, every line is read ahead and printed right away if it is cached,
+// otherwise its tokens are handed on to the parser.
+extern int txc_cache_lex(void);
+
+// Simplifies and prints the line just parsed and keeps its result in the cache file.
+extern void txc_cache_simplify_and_print(const txc_node *const node);
+
+// Defines the variable var as definition and prints its value, which is taken from the cache file if the line was found there.
+extern void txc_cache_define_and_print(const txc_node *const var, const txc_node *const definition);
+
+extern struct txc_cache_stats txc_cache_stats(void);
+
+#endif /* TXC_CACHE */
@@ -43,6 +43,10 @@
 #endif /* (_POSIX_VERSION >= 200112L) */
 #endif /* _WIN32 */
 
+#if defined(TXC_POSIX) && defined(_POSIX_THREADS) && !defined(TXC_NO_THREADS)
+#define TXC_THREADS
+#endif /* defined(TXC_POSIX) && defined(_POSIX_THREADS) && !defined(TXC_NO_THREADS) */
+
 #if !defined(TXC_WIN) && !defined(TXC_POSIX)
 #pragma GCC warning "This environment seems to not comply with neither Windows nor POSIX.1-2001 or newer and is thus not supported."
 #endif /* !defined(TXC_WIN) && !defined(TXC_POSIX) */
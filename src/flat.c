@@ -0,0 +1,603 @@
+/*
+ *     Copyright (C) 2024  Einholz
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU Affero General Public License as published
+ *     by the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU Affero General Public License for more details.
+ *
+ *     You should have received a copy of the GNU Affero General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flat.h"
+#include "integer.h"
+#include "node.h"
+#include "util.h"
+
+// bits of the largest powers evaluated on registers, larger ones are left to txc_node_simplify, whose \bmod may reduce them
+#ifndef TXC_FLAT_POW_BITS
+#define TXC_FLAT_POW_BITS 1048576
+#endif /* TXC_FLAT_POW_BITS */
+
+/* DEFINITIONS */
+
+struct txc_flat {
+    uint32_t len;
+    uint32_t integers_len;
+    uint32_t reasons_len;
+    // one enum txc_node_type per node
+    uint8_t *types;
+    // the children of node i are pool[offsets[i]] up to pool[offsets[i + 1]]
+    uint32_t *offsets;
+    uint32_t *pool;
+    // index into integers or reasons for INT and NAN nodes
+    uint32_t *values;
+    struct txc_int **integers;
+    char **reasons;
+    // allocated by the first txc_flat_eval and all NULL between evaluations, the value of node i is in registers[i]
+    struct txc_int **registers;
+    // the second half gathers the operands of a sum or product
+    const struct txc_int **operands;
+};
+
+struct counts {
+    size_t nodes;
+    size_t pool;
+    size_t integers;
+    size_t reasons;
+};
+
+// Fills the arrays front to back, the stack holds finished nodes still waiting for their parent.
+struct builder {
+    struct txc_flat *flat;
+    uint32_t *stack;
+    uint32_t stack_len;
+    uint32_t pool_len;
+    bool success;
+};
+
+/* VALID */
+
+bool txc_flat_test_valid(const struct txc_flat *const flat)
+{
+    if (flat == NULL) {
+        TXC_ERROR_NULL("txc_flat");
+        return false;
+    }
+    if (flat->len == 0) {
+        TXC_ERROR_NULL("flat root");
+        return false;
+    }
+    if (flat->offsets[0] != 0) {
+        TXC_ERROR_OUT_OF_BOUNDS((size_t)flat->offsets[0], (size_t)0);
+        return false;
+    }
+    for (uint32_t i = 0; i < flat->len; i++) {
+        if (flat->offsets[i + 1] < flat->offsets[i]) {
+            TXC_ERROR_OUT_OF_BOUNDS((size_t)flat->offsets[i], (size_t)flat->offsets[i + 1]);
+            return false;
+        }
+        const size_t amount = flat->offsets[i + 1] - flat->offsets[i];
+        for (size_t j = flat->offsets[i]; j < flat->offsets[i + 1]; j++) {
+            // post-order, so children always come first
+            if (flat->pool[j] >= i) {
+                TXC_ERROR_OUT_OF_BOUNDS((size_t)flat->pool[j], (size_t)i);
+                return false;
+            }
+        }
+        bool valid_amount = true;
+        switch (flat->types[i]) {
+        case TXC_NAN:
+            if (flat->values[i] >= flat->reasons_len) {
+                TXC_ERROR_OUT_OF_BOUNDS((size_t)flat->values[i], (size_t)flat->reasons_len);
+                return false;
+            }
+            valid_amount = amount == 0;
+            break;
+        case TXC_INT:
+            if (flat->values[i] >= flat->integers_len) {
+                TXC_ERROR_OUT_OF_BOUNDS((size_t)flat->values[i], (size_t)flat->integers_len);
+                return false;
+            }
+            if (!txc_int_test_valid(flat->integers[flat->values[i]]))
+                return false;
+            valid_amount = amount == 0;
+            break;
+        case TXC_NEG: /* FALLTHROUGH */
+        case TXC_FACT: /* FALLTHROUGH */
+        case TXC_FLOOR:
+            valid_amount = amount == 1;
+            break;
+        case TXC_FRAC: /* FALLTHROUGH */
+        case TXC_ROOT:
+            valid_amount = amount >= 1 && amount <= 2;
+            break;
+        case TXC_POW: /* FALLTHROUGH */
+        case TXC_BINOM: /* FALLTHROUGH */
+        case TXC_MOD:
+            valid_amount = amount == 2;
+            break;
+        case TXC_ADD: /* FALLTHROUGH */
+        case TXC_MUL:
+            break;
+        default:
+            TXC_ERROR_INVALID_NODE_TYPE(flat->types[i]);
+            return false;
+        }
+        if (!valid_amount) {
+            TXC_ERROR_INVALID_CHILD_AMOUNT(flat->types[i], amount);
+            return false;
+        }
+    }
+    return true;
+}
+
+/* MEMORY */
+
+// Sums of sums and products of products become a single node.
+static bool merges(const txc_node *const parent, const txc_node *const child)
+{
+    const enum txc_node_type type = txc_node_get_type(parent);
+    return (type == TXC_ADD || type == TXC_MUL) && txc_node_get_type(child) == type;
+}
+
+// A node being walked by count or emit. Sums nested into a sum and products nested into a product are walked as part of it.
+struct walk_frame {
+    const txc_node *node;
+    // the node all children are counted or emitted for, node itself unless it is merged into it
+    const txc_node *parent;
+    size_t next;
+    // stack length of the builder before the children of parent were emitted
+    uint32_t base;
+};
+
+static bool walk_push(struct walk_frame **const stack, size_t *const used, size_t *const size, const struct walk_frame frame)
+{
+    if (*used == *size) {
+        struct walk_frame *const tmp = txc_grow(*stack, size, sizeof **stack, "flat walk stack");
+        if (tmp == NULL)
+            return false;
+        *stack = tmp;
+    }
+    (*stack)[(*used)++] = frame;
+    return true;
+}
+
+static bool count(const txc_node *const node, struct counts *const counts)
+{
+    struct walk_frame *stack = NULL;
+    size_t used = 0;
+    size_t size = 0;
+    bool success = walk_push(&stack, &used, &size, (struct walk_frame){ node, node, 0, 0 });
+    if (success) {
+        counts->nodes++;
+        if (txc_node_get_type(node) == TXC_INT)
+            counts->integers++;
+        else if (txc_node_get_type(node) == TXC_NAN)
+            counts->reasons++;
+    }
+    while (success && used > 0) {
+        struct walk_frame *const top = &stack[used - 1];
+        if (top->next == txc_node_children_amount(top->node)) {
+            used--;
+            continue;
+        }
+        const txc_node *const parent = top->parent;
+        const txc_node *const child = txc_node_child(top->node, top->next++);
+        // counts the children of child as children of parent, which child is merged into
+        if (merges(parent, child)) {
+            success = walk_push(&stack, &used, &size, (struct walk_frame){ child, parent, 0, 0 });
+            continue;
+        }
+        counts->pool++;
+        counts->nodes++;
+        if (txc_node_get_type(child) == TXC_INT)
+            counts->integers++;
+        else if (txc_node_get_type(child) == TXC_NAN)
+            counts->reasons++;
+        success = walk_push(&stack, &used, &size, (struct walk_frame){ child, child, 0, 0 });
+    }
+    free(stack);
+    return success;
+}
+
+// Writes node once all its children are written, which are on the stack of the builder from base on.
+static void emit_node(struct builder *const builder, const txc_node *const node, const uint32_t base)
+{
+    struct txc_flat *const flat = builder->flat;
+    const uint32_t i = flat->len;
+    const uint32_t amount = builder->stack_len - base;
+    flat->types[i] = (uint8_t)txc_node_get_type(node);
+    flat->offsets[i] = builder->pool_len;
+    memcpy(flat->pool + builder->pool_len, builder->stack + base, sizeof *flat->pool * amount);
+    builder->pool_len += amount;
+    builder->stack_len = base;
+    flat->values[i] = 0;
+    switch (txc_node_get_type(node)) {
+    case TXC_INT:
+        flat->values[i] = flat->integers_len;
+        flat->integers[flat->integers_len] = txc_int_copy(txc_node_to_int((txc_node *)node));
+        if (flat->integers[flat->integers_len] == NULL) {
+            builder->success = false;
+            return;
+        }
+        flat->integers_len++;
+        break;
+    case TXC_NAN:
+        flat->values[i] = flat->reasons_len;
+        flat->reasons[flat->reasons_len] = txc_strdup(txc_node_nan_reason(node));
+        if (flat->reasons[flat->reasons_len] == NULL) {
+            TXC_ERROR_ALLOC(strlen(txc_node_nan_reason(node)) + 1, "flat nan reason");
+            builder->success = false;
+            return;
+        }
+        flat->reasons_len++;
+        break;
+    default:
+        break;
+    }
+    flat->len++;
+    builder->stack[builder->stack_len++] = i;
+}
+
+static void emit(struct builder *const builder, const txc_node *const node)
+{
+    struct walk_frame *stack = NULL;
+    size_t used = 0;
+    size_t size = 0;
+    builder->success = walk_push(&stack, &used, &size, (struct walk_frame){ node, node, 0, builder->stack_len });
+    while (builder->success && used > 0) {
+        struct walk_frame *const top = &stack[used - 1];
+        if (top->next == txc_node_children_amount(top->node)) {
+            const struct walk_frame done = *top;
+            used--;
+            if (done.node == done.parent)
+                emit_node(builder, done.node, done.base);
+            continue;
+        }
+        const txc_node *const parent = top->parent;
+        const txc_node *const child = txc_node_child(top->node, top->next++);
+        if (merges(parent, child))
+            builder->success = walk_push(&stack, &used, &size, (struct walk_frame){ child, parent, 0, 0 });
+        else
+            builder->success = walk_push(&stack, &used, &size, (struct walk_frame){ child, child, 0, builder->stack_len });
+    }
+    free(stack);
+}
+
+struct txc_flat *txc_flat_from_node(const txc_node *const node)
+{
+    assert(txc_node_test_valid(node, true));
+    struct counts counts = { 0, 0, 0, 0 };
+    if (!count(node, &counts))
+        return NULL;
+    if (counts.nodes >= UINT32_MAX || counts.pool >= UINT32_MAX) {
+        TXC_ERROR_OVERFLOW("flat node indices");
+        return NULL;
+    }
+    struct txc_flat *const flat = calloc(1, sizeof *flat);
+    if (flat == NULL) {
+        TXC_ERROR_ALLOC(sizeof *flat, "flat tree");
+        return NULL;
+    }
+    // one spare element each, so nothing is allocated with a size of 0
+    flat->types = malloc(sizeof *flat->types * counts.nodes);
+    flat->offsets = malloc(sizeof *flat->offsets * (counts.nodes + 1));
+    flat->pool = malloc(sizeof *flat->pool * (counts.pool + 1));
+    flat->values = malloc(sizeof *flat->values * counts.nodes);
+    flat->integers = malloc(sizeof *flat->integers * (counts.integers + 1));
+    flat->reasons = malloc(sizeof *flat->reasons * (counts.reasons + 1));
+    struct builder builder = { flat, malloc(sizeof *builder.stack * counts.nodes), 0, 0, true };
+    if (flat->types == NULL || flat->offsets == NULL || flat->pool == NULL || flat->values == NULL || flat->integers == NULL || flat->reasons == NULL || builder.stack == NULL) {
+        TXC_ERROR_ALLOC((sizeof *flat->types + sizeof *flat->offsets + sizeof *flat->values + sizeof *builder.stack) * counts.nodes + sizeof *flat->pool * counts.pool + sizeof *flat->integers * counts.integers + sizeof *flat->reasons * counts.reasons, "flat arrays");
+        free(builder.stack);
+        txc_flat_free(flat);
+        return NULL;
+    }
+    emit(&builder, node);
+    free(builder.stack);
+    if (!builder.success) {
+        txc_flat_free(flat);
+        return NULL;
+    }
+    flat->offsets[flat->len] = builder.pool_len;
+    assert(txc_flat_test_valid(flat));
+    return flat;
+}
+
+txc_node *txc_flat_to_node(const struct txc_flat *const flat)
+{
+    assert(txc_flat_test_valid(flat));
+    // the second half gathers the children of one node at a time
+    txc_node **const nodes = malloc(sizeof *nodes * flat->len * 2);
+    if (nodes == NULL) {
+        TXC_ERROR_ALLOC(sizeof *nodes * flat->len * 2, "flat conversion");
+        return (txc_node *)&TXC_NAN_ERROR_ALLOC;
+    }
+    txc_node **const children = nodes + flat->len;
+    for (uint32_t i = 0; i < flat->len; i++) {
+        const uint32_t amount = flat->offsets[i + 1] - flat->offsets[i];
+        union impl impl;
+        impl.integer = NULL;
+        switch (flat->types[i]) {
+        case TXC_INT:
+            nodes[i] = txc_int_to_node(txc_int_copy(flat->integers[flat->values[i]]));
+            break;
+        case TXC_NAN:
+            nodes[i] = txc_node_create_nan(flat->reasons[flat->values[i]]);
+            break;
+        default:
+            for (uint32_t j = 0; j < amount; j++)
+                children[j] = nodes[flat->pool[flat->offsets[i] + j]];
+            nodes[i] = txc_node_create(children, impl, amount, (enum txc_node_type)flat->types[i]);
+            if (txc_node_is_nan(nodes[i]))
+                break;
+            // adopted by their parent
+            for (uint32_t j = 0; j < amount; j++)
+                nodes[flat->pool[flat->offsets[i] + j]] = NULL;
+            continue;
+        }
+        if (flat->types[i] == TXC_NAN || !txc_node_is_nan(nodes[i]))
+            continue;
+        txc_node *const nan = nodes[i];
+        for (uint32_t j = 0; j < i; j++)
+            txc_node_free(nodes[j]);
+        free(nodes);
+        return nan;
+    }
+    txc_node *const root = nodes[flat->len - 1];
+    free(nodes);
+    return root;
+}
+
+void txc_flat_free(const struct txc_flat *const flat)
+{
+    if (flat == NULL)
+        return;
+    for (uint32_t i = 0; i < flat->integers_len; i++)
+        txc_int_free(flat->integers[i]);
+    for (uint32_t i = 0; i < flat->reasons_len; i++)
+        free(flat->reasons[i]);
+    free(flat->types);
+    free(flat->offsets);
+    free(flat->pool);
+    free(flat->values);
+    free(flat->integers);
+    free(flat->reasons);
+    free(flat->registers);
+    free((struct txc_flat *)flat);
+}
+
+/* EVALUATION */
+
+uint32_t txc_flat_inputs(const struct txc_flat *const flat)
+{
+    assert(txc_flat_test_valid(flat));
+    return flat->integers_len;
+}
+
+bool txc_flat_bind(struct txc_flat *const flat, const uint32_t input, const struct txc_int *const value)
+{
+    assert(txc_flat_test_valid(flat));
+    assert(input < flat->integers_len);
+    assert(txc_int_test_valid(value));
+    struct txc_int *const copy = txc_int_copy(value);
+    if (copy == NULL)
+        return false;
+    txc_int_free(flat->integers[input]);
+    flat->integers[input] = copy;
+    return true;
+}
+
+// Powers with a sign fixed up like simplify_pow does.
+static struct txc_int *power(const struct txc_int *const base, const struct txc_int *const exponent)
+{
+    size_t power;
+    if (txc_int_is_neg(exponent) || !txc_int_abs_to_size(exponent, &power))
+        return NULL;
+    if (power != 0 && txc_int_bit_length(base) > TXC_FLAT_POW_BITS / power)
+        return NULL;
+    struct txc_int *result = txc_int_pow(base, power);
+    if (result != NULL && txc_int_is_neg(result))
+        result = txc_int_neg(result);
+    if (result != NULL && txc_int_is_neg(base) && power % 2 == 1)
+        result = txc_int_neg(result);
+    return result;
+}
+
+// Only exact roots of non-negative radicands are integers without further thought.
+static struct txc_int *root(const struct txc_int *const radicand, const struct txc_int *const degree_int)
+{
+    size_t degree = 2;
+    if (txc_int_is_neg(radicand) || (degree_int != NULL && (txc_int_is_neg(degree_int) || !txc_int_abs_to_size(degree_int, &degree) || degree < 2)))
+        return NULL;
+    bool exact;
+    struct txc_int *const result = txc_int_root(radicand, degree, &exact);
+    if (result != NULL && !exact) {
+        txc_int_free(result);
+        return NULL;
+    }
+    return result;
+}
+
+// Negative n is left to simplify_binom, negative k and k > n are 0.
+static struct txc_int *binomial(const struct txc_int *const n_int, const struct txc_int *const k_int)
+{
+    size_t n;
+    size_t k;
+    if (txc_int_is_neg(n_int) || !txc_int_abs_to_size(n_int, &n))
+        return NULL;
+    if (txc_int_is_neg(k_int) || !txc_int_abs_to_size(k_int, &k) || k > n)
+        return txc_int_create_zero();
+    return txc_int_binomial(n, k);
+}
+
+static struct txc_int *factorial(const struct txc_int *const n_int)
+{
+    size_t n;
+    if (txc_int_is_neg(n_int) || !txc_int_abs_to_size(n_int, &n))
+        return NULL;
+    return txc_int_factorial(n);
+}
+
+static struct txc_int *divide(const struct txc_int *const dividend, const struct txc_int *const divisor, const enum txc_int_div_mode mode, const bool remainder)
+{
+    if (txc_int_is_zero(divisor))
+        return NULL;
+    struct txc_int *result;
+    if (!txc_int_divmod(dividend, divisor, mode, remainder ? NULL : &result, remainder ? &result : NULL))
+        return NULL;
+    return result;
+}
+
+// Fractions are only integers if the division is exact, otherwise they are left to a floor around them.
+// Returns false if node i has to be left to txc_node_simplify and sets *pending for a fraction waiting for a floor.
+static bool quotient(const struct txc_flat *const flat, const uint32_t i, struct txc_int **const value, bool *const pending)
+{
+    const uint32_t *const children = flat->pool + flat->offsets[i];
+    const struct txc_int *const den = flat->registers[children[0]];
+    if (txc_int_is_zero(den))
+        return false;
+    if (flat->offsets[i + 1] - flat->offsets[i] == 1) {
+        if (!txc_int_is_pos_one(den) && !txc_int_is_neg_one(den))
+            return false;
+        *value = txc_int_copy(den);
+        return *value != NULL;
+    }
+    struct txc_int *rest;
+    if (!txc_int_divmod(flat->registers[children[1]], den, TXC_INT_DIV_TRUNC, value, &rest)) {
+        *value = NULL;
+        return false;
+    }
+    const bool exact = txc_int_is_zero(rest);
+    txc_int_free(rest);
+    if (!exact) {
+        txc_int_free(*value);
+        *value = NULL;
+        *pending = true;
+    }
+    return true;
+}
+
+// Sets *value to the integer value of node i, computed from the registers of its children.
+// Returns false if node i has to be left to txc_node_simplify.
+static bool evaluate(const struct txc_flat *const flat, const uint32_t i, struct txc_int **const value, bool *const pending)
+{
+    const uint32_t *const children = flat->pool + flat->offsets[i];
+    const uint32_t amount = flat->offsets[i + 1] - flat->offsets[i];
+    struct txc_int **const registers = flat->registers;
+    *value = NULL;
+    *pending = false;
+    // only a floor takes a fraction without an integer value
+    for (uint32_t j = 0; j < amount; j++) {
+        if (registers[children[j]] == NULL && flat->types[i] != TXC_FLOOR)
+            return false;
+    }
+    switch (flat->types[i]) {
+    case TXC_INT:
+        *value = txc_int_copy(flat->integers[flat->values[i]]);
+        break;
+    case TXC_NEG:
+        *value = txc_int_neg(registers[children[0]]);
+        registers[children[0]] = NULL;
+        break;
+    case TXC_ADD: /* FALLTHROUGH */
+    case TXC_MUL:
+        for (uint32_t j = 0; j < amount; j++)
+            flat->operands[j] = registers[children[j]];
+        *value = flat->types[i] == TXC_ADD ? txc_int_add(flat->operands, amount) : txc_int_mul(flat->operands, amount);
+        break;
+    case TXC_FRAC:
+        return quotient(flat, i, value, pending);
+    case TXC_POW:
+        *value = power(registers[children[0]], registers[children[1]]);
+        break;
+    case TXC_ROOT:
+        *value = root(registers[children[0]], amount == 2 ? registers[children[1]] : NULL);
+        break;
+    case TXC_FACT:
+        *value = factorial(registers[children[0]]);
+        break;
+    case TXC_BINOM:
+        *value = binomial(registers[children[0]], registers[children[1]]);
+        break;
+    case TXC_MOD:
+        *value = divide(registers[children[0]], registers[children[1]], TXC_INT_DIV_EUCLID, true);
+        break;
+    case TXC_FLOOR: {
+        const uint32_t operand = children[0];
+        if (registers[operand] != NULL) {
+            *value = registers[operand];
+            registers[operand] = NULL;
+            break;
+        }
+        // the registers of a pending fraction still hold its denominator and numerator
+        const uint32_t *const frac = flat->pool + flat->offsets[operand];
+        *value = divide(registers[frac[1]], registers[frac[0]], TXC_INT_DIV_FLOOR, false);
+        for (uint32_t j = 0; j < 2; j++) {
+            txc_int_free(registers[frac[j]]);
+            registers[frac[j]] = NULL;
+        }
+        break;
+    }
+    default:
+        return false;
+    }
+    return *value != NULL;
+}
+
+struct txc_node *txc_flat_eval(struct txc_flat *const flat)
+{
+    assert(txc_flat_test_valid(flat));
+    if (flat->registers == NULL) {
+        flat->registers = calloc(flat->len * 2, sizeof *flat->registers);
+        if (flat->registers == NULL) {
+            TXC_ERROR_ALLOC(sizeof *flat->registers * flat->len * 2, "flat registers");
+            return (txc_node *)&TXC_NAN_ERROR_ALLOC;
+        }
+        flat->operands = (const struct txc_int **)flat->registers + flat->len;
+    }
+    struct txc_int **const registers = flat->registers;
+    uint32_t i = 0;
+    for (; i < flat->len; i++) {
+        bool pending;
+        if (!evaluate(flat, i, &registers[i], &pending))
+            break;
+        if (pending)
+            continue;
+        // every node has a single parent, so the values of the children are used up
+        for (uint32_t j = flat->offsets[i]; j < flat->offsets[i + 1]; j++) {
+            txc_int_free(registers[flat->pool[j]]);
+            registers[flat->pool[j]] = NULL;
+        }
+    }
+    if (i == flat->len && registers[flat->len - 1] != NULL) {
+        txc_node *const result = txc_int_to_node(registers[flat->len - 1]);
+        registers[flat->len - 1] = NULL;
+        return result;
+    }
+    for (uint32_t j = 0; j < i && j < flat->len; j++) {
+        txc_int_free(registers[j]);
+        registers[j] = NULL;
+    }
+    txc_node *const tree = txc_flat_to_node(flat);
+    if (txc_node_is_nan(tree))
+        return tree;
+    txc_node *const result = txc_node_simplify(tree);
+    txc_node_free(tree);
+    return result;
+}
@@ -0,0 +1,60 @@
+/*
+ *     Copyright (C) 2024  Einholz
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU Affero General Public License as published
+ *     by the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU Affero General Public License for more details.
+ *
+ *     You should have received a copy of the GNU Affero General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TXC_FLAT
+#define TXC_FLAT
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "integer.h"
+#include "node.h"
+
+/* DEFINITIONS */
+
+// A whole tree in a few arrays addressed by 32 bit indices, stored in post-order so every child comes before its parent and the root is last.
+// Nested sums and products are merged into one node holding all summands or factors.
+typedef struct txc_flat txc_flat;
+
+/* VALID */
+
+extern bool txc_flat_test_valid(const txc_flat *const flat);
+
+/* MEMORY */
+
+// Integers are shared with the tree, NAN reasons are copied.
+extern txc_flat *txc_flat_from_node(const txc_node *const node);
+
+extern txc_node *txc_flat_to_node(const txc_flat *const flat);
+
+extern void txc_flat_free(const txc_flat *const flat);
+
+/* EVALUATION */
+
+// The integers of flat are its inputs, numbered in post-order like the nodes.
+extern uint32_t txc_flat_inputs(const txc_flat *const flat);
+
+// Replaces input i for later evaluations, flat keeps its own reference to value.
+extern bool txc_flat_bind(txc_flat *const flat, const uint32_t input, const txc_int *const value);
+
+// Same result as txc_node_simplify of txc_flat_to_node, but integer operations run on registers allocated by the first call.
+// Evaluating flat again with new inputs builds no tree unless a fraction, root, NAN or the like has to be left to txc_node_simplify.
+extern txc_node *txc_flat_eval(txc_flat *const flat);
+
+#endif /* TXC_FLAT */
@@ -25,6 +25,7 @@
 
 #include "node.h"
 #include "integer.h"
+#include "pool.h"
 #include "util.h"
 
 #ifndef TXC_INT_GROWTH_FACTOR
@@ -40,16 +41,91 @@
 #ifndef TXC_INT_ARRAY_TYPE_WIDTH
 #define TXC_INT_ARRAY_TYPE_WIDTH CHAR_BIT
 #endif /* TXC_INT_ARRAY_TYPE_WIDTH */
+// must be able to hold TXC_INT_ARRAY_TYPE_MAX * TXC_INT_ARRAY_TYPE_MAX + 2 * TXC_INT_ARRAY_TYPE_MAX
+#ifndef TXC_INT_DOUBLE_ARRAY_TYPE
+#define TXC_INT_DOUBLE_ARRAY_TYPE unsigned int
+#endif /* TXC_INT_DOUBLE_ARRAY_TYPE */
+
+// in elements of TXC_INT_ARRAY_TYPE
+#ifndef TXC_INT_KARATSUBA_THRESHOLD
+#define TXC_INT_KARATSUBA_THRESHOLD 16
+#endif /* TXC_INT_KARATSUBA_THRESHOLD */
+#ifndef TXC_INT_PARALLEL_THRESHOLD
+#define TXC_INT_PARALLEL_THRESHOLD 2048
+#endif /* TXC_INT_PARALLEL_THRESHOLD */
+// operands of exactly 128, 256 or 512 bits in this many limbs take unrolled kernels
+#define TXC_INT_FIXED_LEN(bits) ((bits) / TXC_INT_ARRAY_TYPE_WIDTH)
+#ifdef __GNUC__
+#define TXC_INT_PRAGMA(x) _Pragma(#x)
+#define TXC_INT_UNROLL TXC_INT_PRAGMA(GCC unroll 64)
+#else /* __GNUC__ */
+#define TXC_INT_UNROLL
+#endif /* __GNUC__ */
+// in decimal digits
+#ifndef TXC_INT_DEC_BASECASE
+#define TXC_INT_DEC_BASECASE 32
+#endif /* TXC_INT_DEC_BASECASE */
+#ifndef TXC_INT_DEC_PARALLEL_THRESHOLD
+#define TXC_INT_DEC_PARALLEL_THRESHOLD 8192
+#endif /* TXC_INT_DEC_PARALLEL_THRESHOLD */
+
+// in limbs, divisors for extracting perfect powers out of roots have to fit into a single limb
+#ifndef TXC_INT_ROOT_TRIAL_LIMIT
+#define TXC_INT_ROOT_TRIAL_LIMIT 255
+#endif /* TXC_INT_ROOT_TRIAL_LIMIT */
+#if TXC_INT_ROOT_TRIAL_LIMIT > TXC_INT_ARRAY_TYPE_MAX
+#error "TXC_INT_ROOT_TRIAL_LIMIT has to fit into TXC_INT_ARRAY_TYPE"
+#endif /* TXC_INT_ROOT_TRIAL_LIMIT > TXC_INT_ARRAY_TYPE_MAX */
+
+// in limbs, smaller divisor objects use schoolbook division instead of a reciprocal
+#ifndef TXC_INT_RECIPROCAL_THRESHOLD
+#define TXC_INT_RECIPROCAL_THRESHOLD 32
+#endif /* TXC_INT_RECIPROCAL_THRESHOLD */
+#if TXC_INT_RECIPROCAL_THRESHOLD < 2
+#error "TXC_INT_RECIPROCAL_THRESHOLD has to be at least 2"
+#endif /* TXC_INT_RECIPROCAL_THRESHOLD < 2 */
+
+// binomial coefficients up to this k are a quotient of two product trees instead of sieving primes up to n
+#ifndef TXC_INT_BINOM_DIRECT_LIMIT
+#define TXC_INT_BINOM_DIRECT_LIMIT 64
+#endif /* TXC_INT_BINOM_DIRECT_LIMIT */
+
+// limbs from each end mixed into a fingerprint, the middle of longer integers is skipped
+#ifndef TXC_INT_FINGERPRINT_LIMBS
+#define TXC_INT_FINGERPRINT_LIMBS 16
+#endif /* TXC_INT_FINGERPRINT_LIMBS */
 
 /* DEFINITIONS */
 
+// Shared by txc_int_copy and only cloned before a mutation while more than one reference exists.
+// The count is not atomic, so references are only taken and dropped by the thread owning the integer.
 struct txc_int {
     size_t size;
     size_t used;
+    size_t refs;
     bool neg;
     TXC_INT_ARRAY_TYPE data[];
 };
 
+// Not thread safe, as the scratch space is shared by all operations.
+struct txc_int_mod_ctx {
+    struct txc_int *modulus;
+    struct txc_int *mu;
+    TXC_INT_ARRAY_TYPE *scratch;
+};
+
+// Only read by divisions, so it may be shared between threads.
+struct txc_int_divisor {
+    struct txc_int *divisor;
+    // |divisor| shifted left until its highest bit is set
+    struct txc_int *norm;
+    uint_fast8_t shift;
+    // (B^2 - 1) / norm - B for single limbs
+    TXC_INT_ARRAY_TYPE inv;
+    // B^(2n) / norm for n >= TXC_INT_RECIPROCAL_THRESHOLD limbs, NULL otherwise
+    struct txc_int *recip;
+};
+
 /* VALID */
 
 bool txc_int_test_valid(const struct txc_int *const integer)
@@ -62,6 +138,10 @@ bool txc_int_test_valid(const struct txc_int *const integer)
         TXC_ERROR_OUT_OF_BOUNDS(integer->used, integer->size);
         return false;
     }
+    if (integer->refs <= 0) {
+        TXC_ERROR_INT_UNREFERENCED();
+        return false;
+    }
     if (integer->used > 0 && integer->data[integer->used - 1] <= 0) {
         TXC_ERROR_INT_LEADING_ZERO();
         return false;
@@ -90,15 +170,42 @@ static struct txc_int *init(const size_t size)
     }
     integer->size = size;
     integer->used = 0;
+    integer->refs = 1;
     integer->neg = false;
     return integer;
 }
 
+static struct txc_int *clone(const struct txc_int *const from)
+{
+    if (from == NULL)
+        return NULL;
+    assert(txc_int_test_valid(from));
+    struct txc_int *copy = init(from->used);
+    if (copy == NULL)
+        return NULL;
+    copy->used = from->used;
+    copy->neg = from->neg;
+    memcpy(copy->data, from->data, sizeof *copy->data * copy->used);
+    return copy;
+}
+
+// Gives up this reference for a private clone if it is shared, so the result may be mutated.
+// Frees nothing but the reference on failure.
+static struct txc_int *unshare(struct txc_int *const integer)
+{
+    if (integer == NULL || integer->refs == 1)
+        return integer;
+    struct txc_int *const copy = clone(integer);
+    integer->refs--;
+    return copy;
+}
+
 static struct txc_int *inc_size(struct txc_int *const integer, size_t new_size)
 {
     if (integer == NULL)
         return NULL;
     assert(txc_int_test_valid(integer));
+    assert(integer->refs == 1);
     if (integer->used >= SIZE_MAX)
         return integer;
     const size_t max_size = SIZE_MAX / sizeof *integer->data - sizeof *integer;
@@ -134,6 +241,7 @@ static struct txc_int *fit(struct txc_int *const integer)
     while (integer->used > 0 && integer->data[integer->used - 1] == 0)
         integer->used--;
     assert(txc_int_test_valid(integer));
+    assert(integer->refs == 1);
     if (integer->used == 0)
         integer->neg = false;
     if (integer->size == integer->used)
@@ -147,6 +255,480 @@ static struct txc_int *fit(struct txc_int *const integer)
     return fitted;
 }
 
+static TXC_INT_ARRAY_TYPE limbs_add(TXC_INT_ARRAY_TYPE *const r, const TXC_INT_ARRAY_TYPE *const a, const size_t a_len, const TXC_INT_ARRAY_TYPE *const b, const size_t b_len)
+{
+    assert(a_len >= b_len);
+    TXC_INT_DOUBLE_ARRAY_TYPE carry = 0;
+    for (size_t i = 0; i < b_len; i++) {
+        carry += (TXC_INT_DOUBLE_ARRAY_TYPE)a[i] + b[i];
+        r[i] = (TXC_INT_ARRAY_TYPE)carry;
+        carry >>= TXC_INT_ARRAY_TYPE_WIDTH;
+    }
+    for (size_t i = b_len; i < a_len; i++) {
+        carry += a[i];
+        r[i] = (TXC_INT_ARRAY_TYPE)carry;
+        carry >>= TXC_INT_ARRAY_TYPE_WIDTH;
+    }
+    return (TXC_INT_ARRAY_TYPE)carry;
+}
+
+static TXC_INT_ARRAY_TYPE limbs_sub(TXC_INT_ARRAY_TYPE *const r, const TXC_INT_ARRAY_TYPE *const a, const size_t a_len, const TXC_INT_ARRAY_TYPE *const b, const size_t b_len)
+{
+    assert(a_len >= b_len);
+    TXC_INT_ARRAY_TYPE borrow = 0;
+    for (size_t i = 0; i < b_len; i++) {
+        const TXC_INT_DOUBLE_ARRAY_TYPE sub = (TXC_INT_DOUBLE_ARRAY_TYPE)b[i] + borrow;
+        borrow = a[i] < sub;
+        r[i] = (TXC_INT_ARRAY_TYPE)(a[i] - sub);
+    }
+    for (size_t i = b_len; i < a_len; i++) {
+        const TXC_INT_ARRAY_TYPE new_borrow = a[i] < borrow;
+        r[i] = (TXC_INT_ARRAY_TYPE)(a[i] - borrow);
+        borrow = new_borrow;
+    }
+    return borrow;
+}
+
+static int_fast8_t limbs_cmp(const TXC_INT_ARRAY_TYPE *const a, const TXC_INT_ARRAY_TYPE *const b, const size_t len)
+{
+    for (size_t i = len; i > 0; i--) {
+        if (a[i - 1] != b[i - 1])
+            return a[i - 1] < b[i - 1] ? -1 : 1;
+    }
+    return 0;
+}
+
+// r = |a - b| with a_len elements, returns whether a < b
+static bool limbs_diff(TXC_INT_ARRAY_TYPE *const r, const TXC_INT_ARRAY_TYPE *const a, const size_t a_len, const TXC_INT_ARRAY_TYPE *const b, const size_t b_len)
+{
+    assert(a_len >= b_len);
+    bool a_smaller = true;
+    for (size_t i = b_len; i < a_len && a_smaller; i++)
+        a_smaller = a[i] == 0;
+    if (a_smaller)
+        a_smaller = limbs_cmp(a, b, b_len) < 0;
+    if (!a_smaller) {
+        limbs_sub(r, a, a_len, b, b_len);
+        return false;
+    }
+    limbs_sub(r, b, b_len, a, b_len);
+    for (size_t i = b_len; i < a_len; i++)
+        r[i] = 0;
+    return true;
+}
+
+static uint_fast8_t limb_clz(TXC_INT_ARRAY_TYPE limb)
+{
+    assert(limb != 0);
+    uint_fast8_t zeros = 0;
+    for (; (limb >> (TXC_INT_ARRAY_TYPE_WIDTH - 1)) == 0; zeros++)
+        limb <<= 1;
+    return zeros;
+}
+
+// r[0, len) = a[0, len) << shift, returns the bits shifted out
+static TXC_INT_ARRAY_TYPE limbs_lshift(TXC_INT_ARRAY_TYPE *const r, const TXC_INT_ARRAY_TYPE *const a, const size_t len, const uint_fast8_t shift)
+{
+    assert(shift < TXC_INT_ARRAY_TYPE_WIDTH);
+    if (shift == 0) {
+        memmove(r, a, sizeof *r * len);
+        return 0;
+    }
+    if (len == 0)
+        return 0;
+    const TXC_INT_ARRAY_TYPE out = a[len - 1] >> (TXC_INT_ARRAY_TYPE_WIDTH - shift);
+    for (size_t i = len - 1; i > 0; i--)
+        r[i] = (TXC_INT_ARRAY_TYPE)((a[i] << shift) | (a[i - 1] >> (TXC_INT_ARRAY_TYPE_WIDTH - shift)));
+    r[0] = (TXC_INT_ARRAY_TYPE)(a[0] << shift);
+    return out;
+}
+
+// r[0, len) = a[0, len] >> shift
+static void limbs_rshift(TXC_INT_ARRAY_TYPE *const r, const TXC_INT_ARRAY_TYPE *const a, const size_t len, const uint_fast8_t shift)
+{
+    assert(shift < TXC_INT_ARRAY_TYPE_WIDTH);
+    if (shift == 0) {
+        memmove(r, a, sizeof *r * len);
+        return;
+    }
+    for (size_t i = 0; i < len; i++)
+        r[i] = (TXC_INT_ARRAY_TYPE)((a[i] >> shift) | (a[i + 1] << (TXC_INT_ARRAY_TYPE_WIDTH - shift)));
+}
+
+// r[0, len) += a[0, len) * b, returns the carry
+static TXC_INT_ARRAY_TYPE limbs_addmul_1(TXC_INT_ARRAY_TYPE *const r, const TXC_INT_ARRAY_TYPE *const a, const size_t len, const TXC_INT_ARRAY_TYPE b)
+{
+    TXC_INT_DOUBLE_ARRAY_TYPE carry = 0;
+    for (size_t i = 0; i < len; i++) {
+        carry += (TXC_INT_DOUBLE_ARRAY_TYPE)a[i] * b + r[i];
+        r[i] = (TXC_INT_ARRAY_TYPE)carry;
+        carry >>= TXC_INT_ARRAY_TYPE_WIDTH;
+    }
+    return (TXC_INT_ARRAY_TYPE)carry;
+}
+
+// r[0, len) -= a[0, len) * b, returns the borrow
+static TXC_INT_ARRAY_TYPE limbs_submul_1(TXC_INT_ARRAY_TYPE *const r, const TXC_INT_ARRAY_TYPE *const a, const size_t len, const TXC_INT_ARRAY_TYPE b)
+{
+    TXC_INT_DOUBLE_ARRAY_TYPE carry = 0;
+    for (size_t i = 0; i < len; i++) {
+        carry += (TXC_INT_DOUBLE_ARRAY_TYPE)a[i] * b;
+        const TXC_INT_ARRAY_TYPE low = (TXC_INT_ARRAY_TYPE)carry;
+        carry >>= TXC_INT_ARRAY_TYPE_WIDTH;
+        if (r[i] < low)
+            carry++;
+        r[i] = (TXC_INT_ARRAY_TYPE)(r[i] - low);
+    }
+    return (TXC_INT_ARRAY_TYPE)carry;
+}
+
+// r[0, len) = B^len - r[0, len), the two's complement
+static void limbs_neg(TXC_INT_ARRAY_TYPE *const r, const size_t len)
+{
+    bool carry = true;
+    for (size_t i = 0; i < len; i++) {
+        r[i] = (TXC_INT_ARRAY_TYPE)~r[i];
+        if (carry) {
+            r[i]++;
+            carry = r[i] == 0;
+        }
+    }
+}
+
+static void limbs_mul_basecase(TXC_INT_ARRAY_TYPE *const r, const TXC_INT_ARRAY_TYPE *const a, const size_t a_len, const TXC_INT_ARRAY_TYPE *const b, const size_t b_len)
+{
+    for (size_t i = 0; i < a_len; i++)
+        r[i] = 0;
+    for (size_t i = 0; i < b_len; i++)
+        r[a_len + i] = limbs_addmul_1(r + i, a, a_len, b[i]);
+}
+
+// only the products above the diagonal are computed, r has 2 * len elements
+static void limbs_sqr_basecase(TXC_INT_ARRAY_TYPE *const r, const TXC_INT_ARRAY_TYPE *const a, const size_t len)
+{
+    for (size_t i = 0; i < 2 * len; i++)
+        r[i] = 0;
+    for (size_t i = 0; i + 1 < len; i++)
+        r[len + i] = limbs_addmul_1(r + 2 * i + 1, a + i + 1, len - i - 1, a[i]);
+    limbs_lshift(r, r, 2 * len, 1);
+    TXC_INT_DOUBLE_ARRAY_TYPE carry = 0;
+    for (size_t i = 0; i < len; i++) {
+        const TXC_INT_DOUBLE_ARRAY_TYPE square = (TXC_INT_DOUBLE_ARRAY_TYPE)a[i] * a[i];
+        carry += (TXC_INT_DOUBLE_ARRAY_TYPE)r[2 * i] + (TXC_INT_ARRAY_TYPE)square;
+        r[2 * i] = (TXC_INT_ARRAY_TYPE)carry;
+        carry >>= TXC_INT_ARRAY_TYPE_WIDTH;
+        carry += (TXC_INT_DOUBLE_ARRAY_TYPE)r[2 * i + 1] + (square >> TXC_INT_ARRAY_TYPE_WIDTH);
+        r[2 * i + 1] = (TXC_INT_ARRAY_TYPE)carry;
+        carry >>= TXC_INT_ARRAY_TYPE_WIDTH;
+    }
+    assert(carry == 0);
+}
+
+// add, sub and mul of two operands with bits / TXC_INT_ARRAY_TYPE_WIDTH limbs each, the product has twice as many
+#define TXC_INT_FIXED_KERNELS(bits) \
+    static TXC_INT_ARRAY_TYPE limbs_add_##bits(TXC_INT_ARRAY_TYPE *const r, const TXC_INT_ARRAY_TYPE *const a, const TXC_INT_ARRAY_TYPE *const b) \
+    { \
+        TXC_INT_DOUBLE_ARRAY_TYPE carry = 0; \
+        TXC_INT_UNROLL \
+        for (size_t i = 0; i < TXC_INT_FIXED_LEN(bits); i++) { \
+            carry += (TXC_INT_DOUBLE_ARRAY_TYPE)a[i] + b[i]; \
+            r[i] = (TXC_INT_ARRAY_TYPE)carry; \
+            carry >>= TXC_INT_ARRAY_TYPE_WIDTH; \
+        } \
+        return (TXC_INT_ARRAY_TYPE)carry; \
+    } \
+\
+    static TXC_INT_ARRAY_TYPE limbs_sub_##bits(TXC_INT_ARRAY_TYPE *const r, const TXC_INT_ARRAY_TYPE *const a, const TXC_INT_ARRAY_TYPE *const b) \
+    { \
+        TXC_INT_ARRAY_TYPE borrow = 0; \
+        TXC_INT_UNROLL \
+        for (size_t i = 0; i < TXC_INT_FIXED_LEN(bits); i++) { \
+            const TXC_INT_DOUBLE_ARRAY_TYPE sub = (TXC_INT_DOUBLE_ARRAY_TYPE)b[i] + borrow; \
+            borrow = a[i] < sub; \
+            r[i] = (TXC_INT_ARRAY_TYPE)(a[i] - sub); \
+        } \
+        return borrow; \
+    } \
+\
+    static int_fast8_t limbs_cmp_##bits(const TXC_INT_ARRAY_TYPE *const a, const TXC_INT_ARRAY_TYPE *const b) \
+    { \
+        TXC_INT_UNROLL \
+        for (size_t i = TXC_INT_FIXED_LEN(bits); i > 0; i--) { \
+            if (a[i - 1] != b[i - 1]) \
+                return a[i - 1] < b[i - 1] ? -1 : 1; \
+        } \
+        return 0; \
+    } \
+\
+    static void limbs_mul_##bits(TXC_INT_ARRAY_TYPE *const r, const TXC_INT_ARRAY_TYPE *const a, const TXC_INT_ARRAY_TYPE *const b) \
+    { \
+        TXC_INT_UNROLL \
+        for (size_t i = 0; i < TXC_INT_FIXED_LEN(bits); i++) \
+            r[i] = 0; \
+        for (size_t j = 0; j < TXC_INT_FIXED_LEN(bits); j++) { \
+            TXC_INT_DOUBLE_ARRAY_TYPE carry = 0; \
+            TXC_INT_UNROLL \
+            for (size_t i = 0; i < TXC_INT_FIXED_LEN(bits); i++) { \
+                carry += (TXC_INT_DOUBLE_ARRAY_TYPE)a[i] * b[j] + r[i + j]; \
+                r[i + j] = (TXC_INT_ARRAY_TYPE)carry; \
+                carry >>= TXC_INT_ARRAY_TYPE_WIDTH; \
+            } \
+            r[TXC_INT_FIXED_LEN(bits) + j] = (TXC_INT_ARRAY_TYPE)carry; \
+        } \
+    }
+
+TXC_INT_FIXED_KERNELS(128)
+TXC_INT_FIXED_KERNELS(256)
+TXC_INT_FIXED_KERNELS(512)
+
+static bool fixed_len(const size_t len)
+{
+    return len == TXC_INT_FIXED_LEN(128) || len == TXC_INT_FIXED_LEN(256) || len == TXC_INT_FIXED_LEN(512);
+}
+
+// calls the kernel for len, which has to be one of the fixed lengths
+#define TXC_INT_FIXED_DISPATCH(len, kernel, ...) \
+    ((len) == TXC_INT_FIXED_LEN(128) ? kernel##_128(__VA_ARGS__) : (len) == TXC_INT_FIXED_LEN(256) ? kernel##_256(__VA_ARGS__) : kernel##_512(__VA_ARGS__))
+
+struct mul_task {
+    struct txc_pool_task task;
+    TXC_INT_ARRAY_TYPE *r;
+    const TXC_INT_ARRAY_TYPE *a;
+    const TXC_INT_ARRAY_TYPE *b;
+    size_t len;
+    bool success;
+};
+
+static bool limbs_mul_n(TXC_INT_ARRAY_TYPE *const r, const TXC_INT_ARRAY_TYPE *const a, const TXC_INT_ARRAY_TYPE *const b, const size_t len);
+
+static void mul_task_run(void *const arg)
+{
+    struct mul_task *const task = arg;
+    task->success = limbs_mul_n(task->r, task->a, task->b, task->len);
+}
+
+// Karatsuba, r has 2 * len elements and must not overlap with a or b, a == b squares
+static bool limbs_mul_n(TXC_INT_ARRAY_TYPE *const r, const TXC_INT_ARRAY_TYPE *const a, const TXC_INT_ARRAY_TYPE *const b, const size_t len)
+{
+    const bool square = a == b;
+    if (len < TXC_INT_KARATSUBA_THRESHOLD) {
+        if (square)
+            limbs_sqr_basecase(r, a, len);
+        else
+            limbs_mul_basecase(r, a, len, b, len);
+        return true;
+    }
+    const size_t low = len / 2;
+    const size_t high = len - low;
+    const size_t tmp_size = sizeof(TXC_INT_ARRAY_TYPE) * (4 * high + 2);
+    TXC_INT_ARRAY_TYPE *const tmp = malloc(tmp_size);
+    if (tmp == NULL) {
+        TXC_ERROR_ALLOC(tmp_size, "karatsuba");
+        return false;
+    }
+    TXC_INT_ARRAY_TYPE *const prod = tmp;
+    TXC_INT_ARRAY_TYPE *const a_diff = tmp + 2 * high + 1;
+    TXC_INT_ARRAY_TYPE *const b_diff = square ? a_diff : tmp + 3 * high + 1;
+    TXC_INT_ARRAY_TYPE *const mid = a_diff;
+    bool neg = limbs_diff(a_diff, a + low, high, a, low);
+    neg = square ? false : neg != limbs_diff(b_diff, b + low, high, b, low);
+    // the three sub products are independent, so they may run on the pool
+    struct mul_task high_task = { .r = r + 2 * low, .a = a + low, .b = b + low, .len = high, .success = false };
+    struct mul_task diff_task = { .r = prod, .a = a_diff, .b = b_diff, .len = high, .success = false };
+    const bool parallel = len >= TXC_INT_PARALLEL_THRESHOLD;
+    if (parallel) {
+        txc_pool_submit(&high_task.task, &mul_task_run, &high_task);
+        txc_pool_submit(&diff_task.task, &mul_task_run, &diff_task);
+    } else {
+        mul_task_run(&high_task);
+        mul_task_run(&diff_task);
+    }
+    const bool low_success = limbs_mul_n(r, a, b, low);
+    if (parallel) {
+        txc_pool_wait(&high_task.task);
+        txc_pool_wait(&diff_task.task);
+    }
+    if (!low_success || !high_task.success || !diff_task.success) {
+        free(tmp);
+        return false;
+    }
+    // mid = a_low * b_high + a_high * b_low = low + high - (a_high - a_low) * (b_high - b_low)
+    mid[2 * high] = limbs_add(mid, r + 2 * low, 2 * high, r, 2 * low);
+    TXC_INT_ARRAY_TYPE carry;
+    if (neg)
+        carry = limbs_add(mid, mid, 2 * high + 1, prod, 2 * high);
+    else
+        carry = limbs_sub(mid, mid, 2 * high + 1, prod, 2 * high);
+    assert(carry == 0);
+    carry = limbs_add(r + low, r + low, 2 * len - low, mid, 2 * high + 1);
+    assert(carry == 0);
+    (void)carry;
+    free(tmp);
+    return true;
+}
+
+// r has a_len + b_len elements and must not overlap with a or b
+static bool limbs_mul(TXC_INT_ARRAY_TYPE *const r, const TXC_INT_ARRAY_TYPE *const a, const size_t a_len, const TXC_INT_ARRAY_TYPE *const b, const size_t b_len)
+{
+    if (a_len < b_len)
+        return limbs_mul(r, b, b_len, a, a_len);
+    if (a == b && a_len == b_len)
+        return limbs_mul_n(r, a, a, a_len);
+    if (b_len < TXC_INT_KARATSUBA_THRESHOLD) {
+        limbs_mul_basecase(r, a, a_len, b, b_len);
+        return true;
+    }
+    if (a_len == b_len)
+        return limbs_mul_n(r, a, b, a_len);
+    const size_t tmp_size = sizeof(TXC_INT_ARRAY_TYPE) * 2 * b_len;
+    TXC_INT_ARRAY_TYPE *const tmp = malloc(tmp_size);
+    if (tmp == NULL) {
+        TXC_ERROR_ALLOC(tmp_size, "unbalanced multiplication");
+        return false;
+    }
+    for (size_t i = 0; i < a_len + b_len; i++)
+        r[i] = 0;
+    for (size_t offset = 0; offset < a_len; offset += b_len) {
+        const size_t chunk = txc_min(b_len, a_len - offset);
+        if (!limbs_mul(tmp, b, b_len, a + offset, chunk)) {
+            free(tmp);
+            return false;
+        }
+        limbs_add(r + offset, r + offset, a_len + b_len - offset, tmp, b_len + chunk);
+    }
+    free(tmp);
+    return true;
+}
+
+// r = r * b + c, returns the carry
+static TXC_INT_ARRAY_TYPE limbs_muladd_1(TXC_INT_ARRAY_TYPE *const r, const size_t len, const TXC_INT_ARRAY_TYPE b, const TXC_INT_ARRAY_TYPE c)
+{
+    TXC_INT_DOUBLE_ARRAY_TYPE carry = c;
+    for (size_t i = 0; i < len; i++) {
+        carry += (TXC_INT_DOUBLE_ARRAY_TYPE)r[i] * b;
+        r[i] = (TXC_INT_ARRAY_TYPE)carry;
+        carry >>= TXC_INT_ARRAY_TYPE_WIDTH;
+    }
+    return (TXC_INT_ARRAY_TYPE)carry;
+}
+
+// q = a / d, returns a % d, q may be a
+static TXC_INT_ARRAY_TYPE limbs_divrem_1(TXC_INT_ARRAY_TYPE *const q, const TXC_INT_ARRAY_TYPE *const a, const size_t len, const TXC_INT_ARRAY_TYPE d)
+{
+    assert(d != 0);
+    TXC_INT_DOUBLE_ARRAY_TYPE rem = 0;
+    for (size_t i = len; i > 0; i--) {
+        rem = (rem << TXC_INT_ARRAY_TYPE_WIDTH) | a[i - 1];
+        q[i - 1] = (TXC_INT_ARRAY_TYPE)(rem / d);
+        rem %= d;
+    }
+    return (TXC_INT_ARRAY_TYPE)rem;
+}
+
+// Knuth's algorithm D, q has a_len - d_len + 1 elements, r has d_len elements
+static bool limbs_divrem(TXC_INT_ARRAY_TYPE *const q, TXC_INT_ARRAY_TYPE *const r, const TXC_INT_ARRAY_TYPE *const a, const size_t a_len, const TXC_INT_ARRAY_TYPE *const d, const size_t d_len)
+{
+    assert(a_len >= d_len);
+    assert(d_len >= 2);
+    assert(d[d_len - 1] != 0);
+    const size_t tmp_size = sizeof(TXC_INT_ARRAY_TYPE) * (a_len + 1 + d_len);
+    TXC_INT_ARRAY_TYPE *const tmp = malloc(tmp_size);
+    if (tmp == NULL) {
+        TXC_ERROR_ALLOC(tmp_size, "division");
+        return false;
+    }
+    // normalize so the highest bit of the divisor is set
+    const uint_fast8_t shift = limb_clz(d[d_len - 1]);
+    TXC_INT_ARRAY_TYPE *const rem = tmp;
+    TXC_INT_ARRAY_TYPE *const div = tmp + a_len + 1;
+    rem[a_len] = limbs_lshift(rem, a, a_len, shift);
+    limbs_lshift(div, d, d_len, shift);
+    const TXC_INT_DOUBLE_ARRAY_TYPE top = div[d_len - 1];
+    const TXC_INT_DOUBLE_ARRAY_TYPE second = div[d_len - 2];
+    for (size_t j = a_len - d_len + 1; j > 0; j--) {
+        TXC_INT_ARRAY_TYPE *const window = rem + j - 1;
+        const TXC_INT_DOUBLE_ARRAY_TYPE num = ((TXC_INT_DOUBLE_ARRAY_TYPE)window[d_len] << TXC_INT_ARRAY_TYPE_WIDTH) | window[d_len - 1];
+        TXC_INT_DOUBLE_ARRAY_TYPE q_hat = num / top;
+        TXC_INT_DOUBLE_ARRAY_TYPE r_hat = num % top;
+        while (q_hat > TXC_INT_ARRAY_TYPE_MAX || q_hat * second > ((r_hat << TXC_INT_ARRAY_TYPE_WIDTH) | window[d_len - 2])) {
+            q_hat--;
+            r_hat += top;
+            if (r_hat > TXC_INT_ARRAY_TYPE_MAX)
+                break;
+        }
+        TXC_INT_DOUBLE_ARRAY_TYPE carry = 0;
+        TXC_INT_ARRAY_TYPE borrow = 0;
+        for (size_t i = 0; i < d_len; i++) {
+            carry += q_hat * div[i];
+            const TXC_INT_DOUBLE_ARRAY_TYPE sub = (TXC_INT_DOUBLE_ARRAY_TYPE)(TXC_INT_ARRAY_TYPE)carry + borrow;
+            carry >>= TXC_INT_ARRAY_TYPE_WIDTH;
+            borrow = window[i] < sub;
+            window[i] = (TXC_INT_ARRAY_TYPE)(window[i] - sub);
+        }
+        const TXC_INT_DOUBLE_ARRAY_TYPE sub = carry + borrow;
+        borrow = window[d_len] < sub;
+        window[d_len] = (TXC_INT_ARRAY_TYPE)(window[d_len] - sub);
+        if (borrow) {
+            q_hat--;
+            limbs_add(window, window, d_len + 1, div, d_len);
+        }
+        q[j - 1] = (TXC_INT_ARRAY_TYPE)q_hat;
+    }
+    limbs_rshift(r, rem, d_len, shift);
+    free(tmp);
+    return true;
+}
+
+static struct txc_int *trim(struct txc_int *const integer)
+{
+    while (integer->used > 0 && integer->data[integer->used - 1] == 0)
+        integer->used--;
+    if (integer->used == 0)
+        integer->neg = false;
+    assert(txc_int_test_valid(integer));
+    return integer;
+}
+
+// |dividend| = quotient * |divisor| + remainder, either of quotient and remainder may be NULL
+static bool divrem_abs(const struct txc_int *const dividend, const struct txc_int *const divisor, struct txc_int **const quotient, struct txc_int **const remainder)
+{
+    assert(txc_int_test_valid(dividend));
+    assert(txc_int_test_valid(divisor));
+    assert(!txc_int_is_zero(divisor));
+    const size_t q_used = dividend->used >= divisor->used ? dividend->used - divisor->used + 1 : 0;
+    struct txc_int *const q = init(q_used);
+    struct txc_int *const r = init(divisor->used);
+    if (q == NULL || r == NULL) {
+        txc_int_free(q);
+        txc_int_free(r);
+        return false;
+    }
+    q->used = q_used;
+    if (q_used == 0) {
+        r->used = dividend->used;
+        memcpy(r->data, dividend->data, sizeof *r->data * r->used);
+    } else if (divisor->used == 1) {
+        r->used = 1;
+        r->data[0] = limbs_divrem_1(q->data, dividend->data, dividend->used, divisor->data[0]);
+    } else {
+        r->used = divisor->used;
+        if (!limbs_divrem(q->data, r->data, dividend->data, dividend->used, divisor->data, divisor->used)) {
+            txc_int_free(q);
+            txc_int_free(r);
+            return false;
+        }
+    }
+    if (quotient != NULL)
+        *quotient = trim(q);
+    else
+        txc_int_free(trim(q));
+    if (remainder != NULL)
+        *remainder = trim(r);
+    else
+        txc_int_free(trim(r));
+    return true;
+}
+
 static struct txc_int *from_bin_str(struct txc_int *const integer, const char *const str, const size_t len)
 {
     if (integer == NULL)
@@ -166,47 +748,133 @@ static struct txc_int *from_bin_str(struct txc_int *const integer, const char *c
     return integer;
 }
 
-static struct txc_int *from_dec_str(struct txc_int *const integer, const char *const str, const size_t len)
+static size_t dec_chunk_len(const size_t power_i)
 {
-    if (integer == NULL)
+    return (size_t)TXC_INT_DEC_BASECASE << power_i;
+}
+
+static size_t dec_powers_amount(const size_t digits)
+{
+    size_t amount = 0;
+    while (dec_chunk_len(amount) < digits)
+        amount++;
+    return amount;
+}
+
+static void dec_powers_free(struct txc_int **const powers, const size_t amount)
+{
+    if (powers == NULL)
+        return;
+    for (size_t i = 0; i < amount; i++)
+        txc_int_free(powers[i]);
+    free(powers);
+}
+
+// powers[i] = 10^(TXC_INT_DEC_BASECASE * 2^i)
+static struct txc_int **dec_powers(const size_t amount)
+{
+    struct txc_int **const powers = calloc(amount + 1, sizeof *powers);
+    if (powers == NULL) {
+        TXC_ERROR_ALLOC(sizeof *powers * (amount + 1), "powers of ten");
         return NULL;
-    assert(txc_int_test_valid(integer));
-    for (size_t i = 0; i < len; i++)
-        assert('0' <= str[i] && str[i] <= '9');
-    const size_t dec_width = 4;
-    unsigned char buf[len];
-    for (size_t i = 0; i < len; i++)
-        buf[i] = str[len - i - 1] - 48;
-    integer->data[0] = 0;
-    integer->used = 1;
-    uint_fast8_t bit_i = 0;
-    size_t buf_len = len;
-    while (buf_len > 0) {
-        if (buf[buf_len - 1] == 0) {
-            buf_len--;
-            continue;
+    }
+    if (amount == 0)
+        return powers;
+    powers[0] = init(TXC_INT_DEC_BASECASE / 2 + 1);
+    if (powers[0] == NULL) {
+        free(powers);
+        return NULL;
+    }
+    powers[0]->data[0] = 1;
+    powers[0]->used = 1;
+    for (size_t i = 0; i < TXC_INT_DEC_BASECASE; i++) {
+        const TXC_INT_ARRAY_TYPE carry = limbs_muladd_1(powers[0]->data, powers[0]->used, 10, 0);
+        if (carry != 0)
+            powers[0]->data[powers[0]->used++] = carry;
+    }
+    for (size_t i = 1; i < amount; i++) {
+        const struct txc_int *const factors[2] = { powers[i - 1], powers[i - 1] };
+        powers[i] = txc_int_mul(factors, 2);
+        if (powers[i] == NULL) {
+            dec_powers_free(powers, i);
+            return NULL;
         }
-        bool carry = false;
-        for (size_t ii = 0; ii < buf_len; ii++) {
-            size_t i = buf_len - ii - 1;
-            bool new_carry = buf[i] % 2 == 1;
-            buf[i] >>= 1;
-            if (carry)
-                buf[i] += 1 << (dec_width - 1);
-            if (buf[i] >= 8)
-                buf[i] -= 3;
-            carry = new_carry;
+    }
+    return powers;
+}
+
+struct dec_task {
+    struct txc_pool_task task;
+    const char *str;
+    size_t len;
+    struct txc_int *const *powers;
+    struct txc_int *result;
+};
+
+static struct txc_int *from_dec_chunk(const char *const str, const size_t len, struct txc_int *const *const powers);
+
+static void from_dec_task_run(void *const arg)
+{
+    struct dec_task *const task = arg;
+    task->result = from_dec_chunk(task->str, task->len, task->powers);
+}
+
+// high * 10^low_len + low, where low_len is the largest power of ten in powers below len
+static struct txc_int *from_dec_chunk(const char *const str, const size_t len, struct txc_int *const *const powers)
+{
+    if (len <= TXC_INT_DEC_BASECASE) {
+        struct txc_int *const integer = init(len * 4 / TXC_INT_ARRAY_TYPE_WIDTH + 1);
+        if (integer == NULL)
+            return NULL;
+        for (size_t i = 0; i < len; i++) {
+            const TXC_INT_ARRAY_TYPE carry = limbs_muladd_1(integer->data, integer->used, 10, str[i] - '0');
+            if (carry != 0)
+                integer->data[integer->used++] = carry;
         }
-        if (carry)
-            integer->data[integer->used - 1] += 1 << bit_i;
-        if (bit_i >= TXC_INT_ARRAY_TYPE_WIDTH - 1) {
-            integer->data[integer->used] = 0;
-            integer->used++;
-            bit_i = 0;
+        return integer;
+    }
+    const size_t power_i = dec_powers_amount(len) - 1;
+    const size_t low_len = dec_chunk_len(power_i);
+    struct dec_task low = { .str = str + len - low_len, .len = low_len, .powers = powers, .result = NULL };
+    const bool parallel = len >= TXC_INT_DEC_PARALLEL_THRESHOLD;
+    if (parallel)
+        txc_pool_submit(&low.task, &from_dec_task_run, &low);
+    else
+        from_dec_task_run(&low);
+    struct txc_int *const high = from_dec_chunk(str, len - low_len, powers);
+    if (parallel)
+        txc_pool_wait(&low.task);
+    const struct txc_int *const power = powers[power_i];
+    struct txc_int *const integer = high == NULL || low.result == NULL ? NULL : init(high->used + power->used);
+    if (integer != NULL) {
+        integer->used = integer->size;
+        if (limbs_mul(integer->data, power->data, power->used, high->data, high->used)) {
+            const TXC_INT_ARRAY_TYPE carry = limbs_add(integer->data, integer->data, integer->used, low.result->data, low.result->used);
+            assert(carry == 0);
+            (void)carry;
+            trim(integer);
         } else {
-            bit_i++;
+            txc_int_free(integer);
+            txc_int_free(high);
+            txc_int_free(low.result);
+            return NULL;
         }
     }
+    txc_int_free(high);
+    txc_int_free(low.result);
+    return integer;
+}
+
+static struct txc_int *from_dec_str(const char *const str, const size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+        assert('0' <= str[i] && str[i] <= '9');
+    const size_t powers_amount = dec_powers_amount(len);
+    struct txc_int **const powers = dec_powers(powers_amount);
+    if (powers == NULL)
+        return NULL;
+    struct txc_int *const integer = from_dec_chunk(str, len, powers);
+    dec_powers_free(powers, powers_amount);
     return integer;
 }
 
@@ -244,6 +912,8 @@ txc_node *txc_int_create_int_node(const char *const str, size_t len, const uint_
         cur++;
     if (len <= 0)
         return txc_int_to_node(txc_int_create_zero());
+    if (base == 10)
+        return txc_int_to_node(fit(from_dec_str(cur, len)));
     size_t chars_per_elem = TXC_INT_ARRAY_TYPE_WIDTH / width;
     txc_int *integer = init(len / chars_per_elem + 1);
     if (integer == NULL)
@@ -253,9 +923,6 @@ txc_node *txc_int_create_int_node(const char *const str, size_t len, const uint_
         integer = from_bin_str(integer, cur, len);
         break;
     default: /* FALLTHROUGH */
-    case 10:
-        integer = from_dec_str(integer, cur, len);
-        break;
     case 16:
         integer = from_hex_str(integer, cur, len);
         break;
@@ -286,15 +953,11 @@ struct txc_int *txc_int_copy(const struct txc_int *const from)
     if (from == NULL)
         return NULL;
     assert(txc_int_test_valid(from));
-    struct txc_int *copy = init(from->used);
-    if (copy == NULL)
-        return NULL;
-    copy->used = from->used;
-    copy->size = from->used;
-    copy->neg = from->neg;
-    for (size_t i = 0; i < copy->used; i++)
-        copy->data[i] = from->data[i];
-    return copy;
+    struct txc_int *const shared = (struct txc_int *)from;
+    if (shared->refs == SIZE_MAX)
+        return clone(from);
+    shared->refs++;
+    return shared;
 }
 
 void txc_int_free(const struct txc_int *const integer)
@@ -302,7 +965,10 @@ void txc_int_free(const struct txc_int *const integer)
     if (integer == NULL)
         return;
     assert(txc_int_test_valid(integer));
-    free((struct txc_int *)integer);
+    struct txc_int *const owned = (struct txc_int *)integer;
+    if (--owned->refs > 0)
+        return;
+    free(owned);
 }
 
 /* INTEGER */
@@ -339,6 +1005,14 @@ bool txc_int_is_neg(const struct txc_int *const test)
     return test->neg == true && !txc_int_is_zero(test);
 }
 
+bool txc_int_is_odd(const struct txc_int *const test)
+{
+    if (test == NULL)
+        return false;
+    assert(txc_int_test_valid(test));
+    return test->used > 0 && test->data[0] % 2 == 1;
+}
+
 static struct txc_int *shift_bigger(struct txc_int *integer)
 {
     if (integer == NULL)
@@ -439,6 +1113,8 @@ int_fast8_t txc_int_cmp_abs(const struct txc_int *const a, const struct txc_int
     if (a->used > b->used)
         return 1;
     const size_t used = a->used;
+    if (fixed_len(used))
+        return TXC_INT_FIXED_DISPATCH(used, limbs_cmp, a->data, b->data);
     for (size_t i = 0; i < used; i++) {
         if (a->data[used - i - 1] < b->data[used - i - 1])
             return -1;
@@ -461,13 +1137,38 @@ int_fast8_t txc_int_cmp(const struct txc_int *const a, const struct txc_int *con
     return txc_int_cmp_abs(a, b) * (a->neg && b->neg ? -1 : 1);
 }
 
+size_t txc_int_bytes(const struct txc_int *const integer)
+{
+    assert(txc_int_test_valid(integer));
+    return sizeof *integer + sizeof *integer->data * integer->size;
+}
+
+uint32_t txc_int_fingerprint(const struct txc_int *const integer)
+{
+    assert(txc_int_test_valid(integer));
+    // FNV-1a over the length, the sign and the outer limbs
+    uint64_t hash = 0xcbf29ce484222325u;
+    hash = (hash ^ integer->used) * 0x100000001b3u;
+    hash = (hash ^ (integer->used != 0 && integer->neg)) * 0x100000001b3u;
+    const size_t low = integer->used < 2 * TXC_INT_FINGERPRINT_LIMBS ? integer->used : TXC_INT_FINGERPRINT_LIMBS;
+    for (size_t i = 0; i < low; i++)
+        hash = (hash ^ integer->data[i]) * 0x100000001b3u;
+    for (size_t i = low < integer->used ? integer->used - TXC_INT_FINGERPRINT_LIMBS : integer->used; i < integer->used; i++)
+        hash = (hash ^ integer->data[i]) * 0x100000001b3u;
+    return (uint32_t)(hash ^ hash >> 32);
+}
+
 struct txc_int *txc_int_neg(struct txc_int *const integer)
 {
     if (integer == NULL)
         return NULL;
     assert(txc_int_test_valid(integer));
-    integer->neg = !integer->neg;
-    return integer;
+    struct txc_int *const owned = unshare(integer);
+    if (owned == NULL)
+        return NULL;
+    // there is no -0
+    owned->neg = !owned->neg && owned->used != 0;
+    return owned;
 }
 
 static struct txc_int *add_acc(struct txc_int *acc, const struct txc_int *const summand)
@@ -489,7 +1190,7 @@ static struct txc_int *add_acc(struct txc_int *acc, const struct txc_int *const
         }
         struct txc_int *smaller = acc;
         if (abs_cmp < 0)
-            acc = txc_int_copy(summand);
+            acc = clone(summand);
         else
             smaller = txc_int_copy(summand);
         if (acc == NULL || smaller == NULL) {
@@ -538,6 +1239,26 @@ static struct txc_int *add_acc(struct txc_int *acc, const struct txc_int *const
     return acc;
 }
 
+// Sum of two operands of the same fixed length, without the growing accumulator of add_acc and the realloc of fit.
+static struct txc_int *fixed_add(const struct txc_int *const a, const struct txc_int *const b)
+{
+    const size_t len = a->used;
+    struct txc_int *const sum = init(len + 1);
+    if (sum == NULL)
+        return NULL;
+    if (a->neg == b->neg) {
+        sum->data[len] = TXC_INT_FIXED_DISPATCH(len, limbs_add, sum->data, a->data, b->data);
+        sum->neg = a->neg;
+    } else {
+        const bool a_bigger = TXC_INT_FIXED_DISPATCH(len, limbs_cmp, a->data, b->data) >= 0;
+        TXC_INT_FIXED_DISPATCH(len, limbs_sub, sum->data, a_bigger ? a->data : b->data, a_bigger ? b->data : a->data);
+        sum->data[len] = 0;
+        sum->neg = a_bigger ? a->neg : b->neg;
+    }
+    sum->used = len + 1;
+    return trim(sum);
+}
+
 struct txc_int *txc_int_add(const struct txc_int *const *const summands, const size_t len)
 {
     if (len <= 0)
@@ -550,6 +1271,8 @@ struct txc_int *txc_int_add(const struct txc_int *const *const summands, const s
             return NULL;
         assert(txc_int_test_valid(summands[i]));
     }
+    if (len == 2 && summands[0]->used == summands[1]->used && fixed_len(summands[0]->used))
+        return fixed_add(summands[0], summands[1]);
     struct txc_int *acc = txc_int_create_zero();
     for (size_t i = 0; i < len; i++) {
         if (!txc_int_is_zero(summands[i]))
@@ -574,46 +1297,123 @@ struct txc_int *txc_int_mul(const struct txc_int *const *const factors, const si
             return txc_int_create_zero();
     }
     bool neg = factors[0]->neg;
-    struct txc_int *acc = txc_int_copy(factors[0]);
-    if (acc == NULL)
-        return NULL;
+    if (len == 1)
+        return txc_int_copy(factors[0]);
+    // the first factor is not copied, so { x, x } takes the squaring path of limbs_mul
+    const struct txc_int *acc = factors[0];
+    struct txc_int *owned = NULL;
     for (size_t i = 1; i < len; i++) {
         if (factors[i]->neg)
             neg = !neg;
-        size_t result_size = acc->used + factors[i]->used;
-        acc = inc_size(acc, result_size);
-        if (acc == NULL)
+        struct txc_int *const product = init(acc->used + factors[i]->used);
+        if (product == NULL) {
+            txc_int_free(owned);
             return NULL;
-        size_t summand_i = 0;
-        for (size_t j = 0; j < factors[i]->used; j++)
-            for (size_t k = 0; k < TXC_INT_ARRAY_TYPE_WIDTH; k++)
-                if (((factors[i]->data[j] >> k) & 1) != 0)
-                    summand_i++;
-        struct txc_int *summands[summand_i];
-        summand_i = 0;
-        for (size_t j = 0; j < factors[i]->used; j++) {
-            for (size_t k = 0; k < TXC_INT_ARRAY_TYPE_WIDTH; k++) {
-                if (((factors[i]->data[j] >> k) & 1) == 0)
-                    continue;
-                summands[summand_i] = shift_bigger_wide_amount(txc_int_copy(acc), j, k);
-                summand_i++;
-            }
         }
-        txc_int_free(acc);
-        acc = txc_int_add((const struct txc_int **)summands, summand_i);
-        for (size_t j = 0; j < summand_i; j++)
-            txc_int_free(summands[j]);
+        const bool fixed = acc->used == factors[i]->used && fixed_len(acc->used);
+        if (fixed)
+            TXC_INT_FIXED_DISPATCH(acc->used, limbs_mul, product->data, acc->data, factors[i]->data);
+        const bool success = fixed || limbs_mul(product->data, acc->data, acc->used, factors[i]->data, factors[i]->used);
+        txc_int_free(owned);
+        product->used = product->size;
+        if (!success) {
+            txc_int_free(product);
+            return NULL;
+        }
+        owned = trim(product);
+        acc = owned;
     }
-    if (acc == NULL)
-        return NULL;
-    acc->neg = neg;
-    return fit(acc);
+    owned->neg = neg;
+    // products are at most one limb shorter than their buffer, not worth a realloc
+    return owned;
 }
 
-static struct txc_size_t_tuple int_ffs(const struct txc_int *const integer)
+// acc += a * b or acc -= a * b directly in acc. Small factors are added row by row with the single limb kernels,
+// larger ones only need a buffer for the product but no int. A result of the other sign is the two's complement of the borrow.
+static bool aorsmul(struct txc_int **const acc, const struct txc_int *const a, const struct txc_int *const b, const bool sub)
 {
-    if (integer == NULL) {
-        const struct txc_size_t_tuple result = { .a = 0, .b = 0 };
+    if (*acc == NULL || a == NULL || b == NULL) {
+        txc_int_free(*acc);
+        *acc = NULL;
+        return false;
+    }
+    *acc = unshare(*acc);
+    if (*acc == NULL)
+        return false;
+    assert(txc_int_test_valid(*acc));
+    assert(txc_int_test_valid(a));
+    assert(txc_int_test_valid(b));
+    assert(*acc != a && *acc != b);
+    if (txc_int_is_zero(a) || txc_int_is_zero(b))
+        return true;
+    const struct txc_int *const longer = a->used >= b->used ? a : b;
+    const struct txc_int *const shorter = a->used >= b->used ? b : a;
+    const bool product_neg = (a->neg != b->neg) != sub;
+    if ((*acc)->used == 0)
+        (*acc)->neg = product_neg;
+    const bool subtract = product_neg != (*acc)->neg;
+    const size_t product_len = a->used + b->used;
+    const size_t len = ((*acc)->used > product_len ? (*acc)->used : product_len) + 1;
+    struct txc_int *const r = inc_size(*acc, len);
+    *acc = r;
+    if (r == NULL)
+        return false;
+    memset(r->data + r->used, 0, sizeof *r->data * (len - r->used));
+    r->used = len;
+    TXC_INT_ARRAY_TYPE borrow = 0;
+    if (shorter->used < TXC_INT_KARATSUBA_THRESHOLD) {
+        for (size_t i = 0; i < shorter->used; i++) {
+            TXC_INT_ARRAY_TYPE *const row = r->data + i;
+            const size_t rest = len - i - longer->used;
+            if (subtract) {
+                const TXC_INT_ARRAY_TYPE row_borrow = limbs_submul_1(row, longer->data, longer->used, shorter->data[i]);
+                borrow |= limbs_sub(row + longer->used, row + longer->used, rest, &row_borrow, 1);
+            } else {
+                const TXC_INT_ARRAY_TYPE carry = limbs_addmul_1(row, longer->data, longer->used, shorter->data[i]);
+                limbs_add(row + longer->used, row + longer->used, rest, &carry, 1);
+            }
+        }
+    } else {
+        TXC_INT_ARRAY_TYPE *const product = malloc(sizeof *product * product_len);
+        if (product == NULL || !limbs_mul(product, longer->data, longer->used, shorter->data, shorter->used)) {
+            if (product == NULL)
+                TXC_ERROR_ALLOC(sizeof *product * product_len, "product to accumulate");
+            free(product);
+            txc_int_free(trim(r));
+            *acc = NULL;
+            return false;
+        }
+        if (subtract)
+            borrow = limbs_sub(r->data, r->data, len, product, product_len);
+        else
+            limbs_add(r->data, r->data, len, product, product_len);
+        free(product);
+    }
+    // |acc| < |a * b| wrapped around once
+    if (borrow) {
+        limbs_neg(r->data, len);
+        r->neg = !r->neg;
+    }
+    trim(r);
+    return true;
+}
+
+// Frees acc and sets it to NULL if it fails.
+bool txc_int_addmul(struct txc_int **const acc, const struct txc_int *const a, const struct txc_int *const b)
+{
+    return aorsmul(acc, a, b, false);
+}
+
+// Frees acc and sets it to NULL if it fails.
+bool txc_int_submul(struct txc_int **const acc, const struct txc_int *const a, const struct txc_int *const b)
+{
+    return aorsmul(acc, a, b, true);
+}
+
+static struct txc_size_t_tuple int_ffs(const struct txc_int *const integer)
+{
+    if (integer == NULL) {
+        const struct txc_size_t_tuple result = { .a = 0, .b = 0 };
         return result;
     }
     assert(txc_int_test_valid(integer));
@@ -642,10 +1442,20 @@ struct txc_int *txc_int_gcd(const struct txc_int *const aa, const struct txc_int
         return txc_int_copy(bb);
     if (txc_int_is_zero(bb))
         return txc_int_copy(aa);
+    // a power of two only shares the trailing zeros of the other operand, which Stein's algorithm would subtract away bit by bit
+    size_t bits;
+    const struct txc_int *const other = txc_int_is_pow2(aa, &bits) ? bb : txc_int_is_pow2(bb, &bits) ? aa : NULL;
+    if (other != NULL) {
+        const size_t zeros = txc_int_trailing_zeros(other);
+        struct txc_int *const one = txc_int_create_one();
+        struct txc_int *const gcd = txc_int_shift_left(one, zeros < bits ? zeros : bits);
+        txc_int_free(one);
+        return gcd;
+    }
     const size_t large_used = bb->used > aa->used ? bb->used : aa->used;
-    struct txc_int *const large = txc_int_copy(bb->used > aa->used ? bb : aa);
-    struct txc_int *a = inc_size(txc_int_copy(aa), large_used);
-    struct txc_int *b = inc_size(txc_int_copy(bb), large_used);
+    struct txc_int *const large = clone(bb->used > aa->used ? bb : aa);
+    struct txc_int *a = inc_size(clone(aa), large_used);
+    struct txc_int *b = inc_size(clone(bb), large_used);
     if (large == NULL || a == NULL || b == NULL) {
         txc_int_free(large);
         txc_int_free(a);
@@ -678,51 +1488,1303 @@ struct txc_int *txc_int_gcd(const struct txc_int *const aa, const struct txc_int
     return fit(a);
 }
 
-// FIXME calculates remainder instead of mod
-static struct txc_int *div_mod(const struct txc_int *const dividend, const struct txc_int *const divisor, const bool do_mod)
+static size_t bit_length(const struct txc_int *const integer)
 {
-    if (dividend == NULL || divisor == NULL)
+    assert(txc_int_test_valid(integer));
+    if (integer->used == 0)
+        return 0;
+    return integer->used * TXC_INT_ARRAY_TYPE_WIDTH - limb_clz(integer->data[integer->used - 1]);
+}
+
+size_t txc_int_bit_length(const struct txc_int *const integer)
+{
+    return bit_length(integer);
+}
+
+size_t txc_int_trailing_zeros(const struct txc_int *const integer)
+{
+    assert(txc_int_test_valid(integer));
+    const struct txc_size_t_tuple zeros = int_ffs(integer);
+    return zeros.a * TXC_INT_ARRAY_TYPE_WIDTH + zeros.b;
+}
+
+bool txc_int_is_pow2(const struct txc_int *const test, size_t *const exponent)
+{
+    if (test == NULL || test->used == 0)
+        return false;
+    assert(txc_int_test_valid(test));
+    const TXC_INT_ARRAY_TYPE top = test->data[test->used - 1];
+    if ((top & (top - 1)) != 0)
+        return false;
+    // most integers already fail at their lowest limb
+    for (size_t i = 0; i + 1 < test->used; i++) {
+        if (test->data[i] != 0)
+            return false;
+    }
+    *exponent = bit_length(test) - 1;
+    return true;
+}
+
+struct txc_int *txc_int_shift_left(const struct txc_int *const integer, const size_t bits)
+{
+    if (integer == NULL)
         return NULL;
-    assert(txc_int_test_valid(dividend));
-    assert(txc_int_test_valid(divisor));
-    assert(!txc_int_is_zero(divisor));
-    struct txc_int *div = txc_int_create_zero();
-    struct txc_int *mod = txc_int_copy(dividend);
-    const struct txc_int *const one = txc_int_create_one();
-    div->neg = false;
-    mod->neg = false;
-    while (txc_int_cmp_abs(mod, divisor) >= 0) {
-        div = add_acc(div, one);
-        if (div == NULL)
+    assert(txc_int_test_valid(integer));
+    if (bits == 0 || integer->used == 0)
+        return txc_int_copy(integer);
+    const size_t offset = bits / TXC_INT_ARRAY_TYPE_WIDTH;
+    if (offset > SIZE_MAX / sizeof *integer->data - sizeof *integer - integer->used - 1) {
+        TXC_ERROR_OVERFLOW("shift");
+        return NULL;
+    }
+    struct txc_int *const result = init(offset + integer->used + 1);
+    if (result == NULL)
+        return NULL;
+    memset(result->data, 0, sizeof *result->data * offset);
+    result->data[offset + integer->used] = limbs_lshift(result->data + offset, integer->data, integer->used, bits % TXC_INT_ARRAY_TYPE_WIDTH);
+    result->used = offset + integer->used + 1;
+    result->neg = integer->neg;
+    return trim(result);
+}
+
+struct txc_int *txc_int_shift_right(const struct txc_int *const integer, const size_t bits, const enum txc_int_div_mode mode)
+{
+    if (integer == NULL)
+        return NULL;
+    assert(txc_int_test_valid(integer));
+    if (bits == 0)
+        return txc_int_copy(integer);
+    const size_t offset = bits / TXC_INT_ARRAY_TYPE_WIDTH;
+    const uint_fast8_t shift = bits % TXC_INT_ARRAY_TYPE_WIDTH;
+    // negative quotients move one further away from 0 if any bit shifted out is set, as the divisor is positive
+    bool away = false;
+    if (integer->neg && mode != TXC_INT_DIV_TRUNC) {
+        const size_t low = offset < integer->used ? offset : integer->used;
+        for (size_t i = 0; i < low && !away; i++)
+            away = integer->data[i] != 0;
+        if (!away && offset < integer->used)
+            away = (integer->data[offset] & ((1u << shift) - 1)) != 0;
+    }
+    struct txc_int *result;
+    if (offset >= integer->used) {
+        result = txc_int_create_zero();
+    } else {
+        const size_t used = integer->used - offset;
+        result = init(used);
+        if (result == NULL)
+            return NULL;
+        // limbs_rshift reads one limb past its length
+        limbs_rshift(result->data, integer->data + offset, used - 1, shift);
+        result->data[used - 1] = integer->data[integer->used - 1] >> shift;
+        result->used = used;
+        result->neg = integer->neg;
+        result = trim(result);
+    }
+    if (!away)
+        return result;
+    struct txc_int *const minus_one = txc_int_neg(txc_int_create_one());
+    result = add_acc(result, minus_one);
+    txc_int_free(minus_one);
+    return result;
+}
+
+static size_t limbs_trim(const TXC_INT_ARRAY_TYPE *const a, size_t len)
+{
+    while (len > 0 && a[len - 1] == 0)
+        len--;
+    return len;
+}
+
+static uint_fast8_t pow_window(const size_t exponent_bits)
+{
+    if (exponent_bits < 8)
+        return 1;
+    if (exponent_bits < 24)
+        return 2;
+    if (exponent_bits < 80)
+        return 3;
+    if (exponent_bits < 240)
+        return 4;
+    return 5;
+}
+
+// Left to right sliding window, r and the scratch space both have size elements, which must hold a^exponent
+// even when the final product has up to two unused limbs. Returns the used length or 0 on failure.
+static size_t limbs_pow(TXC_INT_ARRAY_TYPE *const r, const TXC_INT_ARRAY_TYPE *const a, const size_t a_len, const size_t exponent, const size_t size)
+{
+    assert(a_len > 0 && a[a_len - 1] != 0);
+    assert(exponent > 0);
+    if (a_len == 1 && a[0] == 1) {
+        r[0] = 1;
+        return 1;
+    }
+    size_t exponent_bits = 0;
+    while (exponent_bits < sizeof exponent * CHAR_BIT && exponent >> exponent_bits != 0)
+        exponent_bits++;
+    const uint_fast8_t window = pow_window(exponent_bits);
+    const size_t table_amount = (size_t)1 << (window - 1);
+    // table[i] = a^(2 * i + 1)
+    TXC_INT_ARRAY_TYPE *table[16] = { NULL };
+    size_t table_len[16];
+    TXC_INT_ARRAY_TYPE *const tmp = malloc(sizeof *tmp * size);
+    TXC_INT_ARRAY_TYPE *square = NULL;
+    size_t used = 0;
+    if (tmp == NULL) {
+        TXC_ERROR_ALLOC(sizeof *tmp * size, "power scratch space");
+        goto clean;
+    }
+    table[0] = malloc(sizeof *table[0] * a_len);
+    if (table[0] == NULL) {
+        TXC_ERROR_ALLOC(sizeof *table[0] * a_len, "power table");
+        goto clean;
+    }
+    memcpy(table[0], a, sizeof *a * a_len);
+    table_len[0] = a_len;
+    if (table_amount > 1) {
+        square = malloc(sizeof *square * 2 * a_len);
+        if (square == NULL) {
+            TXC_ERROR_ALLOC(sizeof *square * 2 * a_len, "power table");
             goto clean;
-        mod->neg = !divisor->neg;
-        mod = add_acc(mod, divisor);
-        if (mod == NULL)
+        }
+        if (!limbs_mul(square, a, a_len, a, a_len))
             goto clean;
+        const size_t square_len = limbs_trim(square, 2 * a_len);
+        for (size_t i = 1; i < table_amount; i++) {
+            table[i] = malloc(sizeof *table[i] * (table_len[i - 1] + square_len));
+            if (table[i] == NULL) {
+                TXC_ERROR_ALLOC(sizeof *table[i] * (table_len[i - 1] + square_len), "power table");
+                goto clean;
+            }
+            if (!limbs_mul(table[i], table[i - 1], table_len[i - 1], square, square_len))
+                goto clean;
+            table_len[i] = limbs_trim(table[i], table_len[i - 1] + square_len);
+        }
     }
-    txc_int_free(one);
-    div->neg = dividend->neg ^ divisor->neg;
-    mod->neg = false;
-    return do_mod ? mod : div;
+    TXC_INT_ARRAY_TYPE *cur = r;
+    TXC_INT_ARRAY_TYPE *other = tmp;
+    size_t cur_len = 0;
+    for (size_t i = exponent_bits; i > 0;) {
+        size_t squarings;
+        size_t value = 0;
+        if ((exponent >> (i - 1) & 1) == 0) {
+            squarings = 1;
+        } else {
+            size_t j = i > window ? i - window : 0;
+            while ((exponent >> j & 1) == 0)
+                j++;
+            squarings = i - j;
+            value = exponent >> j & (((size_t)1 << squarings) - 1);
+        }
+        i -= squarings;
+        for (size_t k = 0; k < squarings && cur_len > 0; k++) {
+            assert(2 * cur_len <= size);
+            if (!limbs_mul(other, cur, cur_len, cur, cur_len))
+                goto clean;
+            cur_len = limbs_trim(other, 2 * cur_len);
+            TXC_INT_ARRAY_TYPE *const swap = cur;
+            cur = other;
+            other = swap;
+        }
+        if (value == 0)
+            continue;
+        const size_t index = value / 2;
+        if (cur_len == 0) {
+            memcpy(cur, table[index], sizeof *cur * table_len[index]);
+            cur_len = table_len[index];
+            continue;
+        }
+        assert(cur_len + table_len[index] <= size);
+        if (!limbs_mul(other, cur, cur_len, table[index], table_len[index]))
+            goto clean;
+        cur_len = limbs_trim(other, cur_len + table_len[index]);
+        TXC_INT_ARRAY_TYPE *const swap = cur;
+        cur = other;
+        other = swap;
+    }
+    if (cur != r)
+        memcpy(r, cur, sizeof *r * cur_len);
+    used = cur_len;
 clean:
+    for (size_t i = 0; i < table_amount; i++)
+        free(table[i]);
+    free(square);
+    free(tmp);
+    return used;
+}
+
+// Converts the absolute value, returns false if it does not fit.
+bool txc_int_abs_to_size(const struct txc_int *const integer, size_t *const out)
+{
+    assert(txc_int_test_valid(integer));
+    assert(out != NULL);
+    size_t result = 0;
+    for (size_t i = integer->used; i > 0; i--) {
+        if (result > SIZE_MAX >> TXC_INT_ARRAY_TYPE_WIDTH)
+            return false;
+        result = result << TXC_INT_ARRAY_TYPE_WIDTH | integer->data[i - 1];
+    }
+    *out = result;
+    return true;
+}
+
+// The factor 2^k of the base is applied as a single shift, so powers of two never multiply.
+struct txc_int *txc_int_pow(const struct txc_int *const base, const size_t exponent)
+{
+    if (base == NULL)
+        return NULL;
+    assert(txc_int_test_valid(base));
+    if (exponent == 0)
+        return txc_int_create_one();
+    if (txc_int_is_zero(base))
+        return txc_int_create_zero();
+    if (base->used == 1 && base->data[0] == 1)
+        return base->neg && exponent % 2 == 1 ? txc_int_neg(txc_int_create_one()) : txc_int_create_one();
+    const struct txc_size_t_tuple zeros = int_ffs(base);
+    struct txc_int *odd = clone(base);
+    if (odd == NULL)
+        return NULL;
+    odd = shift_smaller_wide_amount(odd, zeros.a, zeros.b);
+    const size_t odd_bits = bit_length(odd);
+    const size_t zero_bits = zeros.a * TXC_INT_ARRAY_TYPE_WIDTH + zeros.b;
+    if (odd_bits > SIZE_MAX / 2 / exponent || zero_bits > SIZE_MAX / 2 / exponent) {
+        txc_int_free(odd);
+        TXC_ERROR_OVERFLOW("power");
+        return NULL;
+    }
+    const size_t shift = zero_bits * exponent;
+    const size_t offset = shift / TXC_INT_ARRAY_TYPE_WIDTH;
+    const size_t odd_size = odd_bits * exponent / TXC_INT_ARRAY_TYPE_WIDTH + 3;
+    struct txc_int *const result = init(offset + odd_size + 1);
+    if (result == NULL) {
+        txc_int_free(odd);
+        return NULL;
+    }
+    for (size_t i = 0; i < offset; i++)
+        result->data[i] = 0;
+    const size_t odd_used = limbs_pow(result->data + offset, odd->data, odd->used, exponent, odd_size);
+    txc_int_free(odd);
+    if (odd_used == 0) {
+        txc_int_free(result);
+        return NULL;
+    }
+    result->data[offset + odd_used] = limbs_lshift(result->data + offset, result->data + offset, odd_used, shift % TXC_INT_ARRAY_TYPE_WIDTH);
+    result->used = offset + odd_used + 1;
+    result->neg = base->neg && exponent % 2 == 1;
+    return fit(result);
+}
+
+static struct txc_int *from_size(size_t value)
+{
+    size_t len = 0;
+    for (size_t rest = value; rest > 0; rest >>= TXC_INT_ARRAY_TYPE_WIDTH)
+        len++;
+    struct txc_int *const integer = init(len);
+    if (integer == NULL)
+        return NULL;
+    for (size_t i = 0; i < len; i++, value >>= TXC_INT_ARRAY_TYPE_WIDTH)
+        integer->data[i] = (TXC_INT_ARRAY_TYPE)value;
+    integer->used = len;
+    return integer;
+}
+
+// x -> ((n - 1) * x + a / x^(n - 1)) / n, decreases monotonically towards the floor root if started above it
+static struct txc_int *root_step(const struct txc_int *const a, const struct txc_int *const x, const size_t degree, const struct txc_int *const n, const struct txc_int *const n_minus_one)
+{
+    struct txc_int *const power = txc_int_pow(x, degree - 1);
+    struct txc_int *quotient = NULL;
+    struct txc_int *next = NULL;
+    if (power == NULL || !divrem_abs(a, power, &quotient, NULL)) {
+        txc_int_free(power);
+        return NULL;
+    }
+    txc_int_free(power);
+    const struct txc_int *const factors[2] = { x, n_minus_one };
+    struct txc_int *const scaled = txc_int_mul(factors, 2);
+    const struct txc_int *const summands[2] = { scaled, quotient };
+    struct txc_int *const sum = txc_int_add(summands, 2);
+    if (sum != NULL && !divrem_abs(sum, n, &next, NULL))
+        next = NULL;
+    txc_int_free(quotient);
+    txc_int_free(scaled);
+    txc_int_free(sum);
+    return next;
+}
+
+// The root of a shifted by half of its bits is a starting point already correct to half of the bits,
+// so the sizes double with every level and each level only needs a step or two.
+static struct txc_int *root_newton(const struct txc_int *const a, const size_t degree, const struct txc_int *const n, const struct txc_int *const n_minus_one)
+{
+    const size_t bits = bit_length(a);
+    const size_t shift = bits / (2 * degree);
+    struct txc_int *x;
+    if (shift == 0) {
+        // 2^ceil(bits / degree) is above the root
+        x = shift_bigger_wide_amount(txc_int_create_one(), 0, (bits + degree - 1) / degree);
+    } else {
+        struct txc_int *high = clone(a);
+        if (high == NULL)
+            return NULL;
+        high = shift_smaller_wide_amount(high, shift * degree / TXC_INT_ARRAY_TYPE_WIDTH, shift * degree % TXC_INT_ARRAY_TYPE_WIDTH);
+        struct txc_int *const high_root = root_newton(high, degree, n, n_minus_one);
+        txc_int_free(high);
+        if (high_root == NULL)
+            return NULL;
+        // high < (high_root + 1)^degree, so (high_root + 1) << shift is above the root
+        struct txc_int *const one = txc_int_create_one();
+        x = add_acc(high_root, one);
+        txc_int_free(one);
+        x = shift_bigger_wide_amount(x, shift / TXC_INT_ARRAY_TYPE_WIDTH, shift % TXC_INT_ARRAY_TYPE_WIDTH);
+    }
+    while (x != NULL) {
+        struct txc_int *const next = root_step(a, x, degree, n, n_minus_one);
+        if (next == NULL || txc_int_cmp_abs(next, x) >= 0) {
+            if (next == NULL) {
+                txc_int_free(x);
+                x = NULL;
+            }
+            txc_int_free(next);
+            break;
+        }
+        txc_int_free(x);
+        x = next;
+    }
+    return x;
+}
+
+// Floor of the degree-th root of |radicand|, exact tells whether the root is an integer.
+struct txc_int *txc_int_root(const struct txc_int *const radicand, const size_t degree, bool *const exact)
+{
+    if (radicand == NULL)
+        return NULL;
+    assert(txc_int_test_valid(radicand));
+    assert(degree > 0);
+    assert(exact != NULL);
+    struct txc_int *a = clone(radicand);
+    if (a == NULL)
+        return NULL;
+    a->neg = false;
+    if (degree == 1 || a->used == 0 || txc_int_is_pos_one(a)) {
+        *exact = true;
+        return a;
+    }
+    struct txc_int *const n = from_size(degree);
+    struct txc_int *const n_minus_one = from_size(degree - 1);
+    struct txc_int *root = NULL;
+    if (n != NULL && n_minus_one != NULL) {
+        if (degree >= bit_length(a))
+            root = txc_int_create_one();
+        else
+            root = root_newton(a, degree, n, n_minus_one);
+    }
+    txc_int_free(n);
+    txc_int_free(n_minus_one);
+    if (root == NULL) {
+        txc_int_free(a);
+        return NULL;
+    }
+    struct txc_int *const power = txc_int_pow(root, degree);
+    if (power == NULL) {
+        txc_int_free(a);
+        txc_int_free(root);
+        return NULL;
+    }
+    *exact = txc_int_cmp_abs(power, a) == 0;
+    txc_int_free(power);
+    txc_int_free(a);
+    return fit(root);
+}
+
+static bool mul_assign(struct txc_int **const acc, const struct txc_int *const factor)
+{
+    const struct txc_int *const factors[2] = { *acc, factor };
+    struct txc_int *const product = txc_int_mul(factors, 2);
+    txc_int_free(*acc);
+    *acc = product;
+    return product != NULL;
+}
+
+// |radicand| = outside^degree * inside, with every small prime power and a perfect power cofactor moved outside.
+bool txc_int_root_split(const struct txc_int *const radicand, const size_t degree, struct txc_int **const outside, struct txc_int **const inside)
+{
+    assert(txc_int_test_valid(radicand));
+    assert(degree > 0);
+    assert(outside != NULL && inside != NULL);
+    struct txc_int *rest = clone(radicand);
+    struct txc_int *out = txc_int_create_one();
+    struct txc_int *in = txc_int_create_one();
+    struct txc_int *const divisor = init(1);
+    struct txc_int *quotient = NULL;
+    if (rest == NULL || out == NULL || in == NULL || divisor == NULL)
+        goto error;
+    rest->neg = false;
+    for (unsigned int d = 2; d <= TXC_INT_ROOT_TRIAL_LIMIT && rest->used > 0 && !txc_int_is_pos_one(rest); d += d == 2 ? 1 : 2) {
+        size_t multiplicity = 0;
+        quotient = init(rest->used);
+        if (quotient == NULL)
+            goto error;
+        // composite d never divide, their prime factors are gone already
+        while (limbs_divrem_1(quotient->data, rest->data, rest->used, (TXC_INT_ARRAY_TYPE)d) == 0) {
+            quotient->used = rest->used;
+            struct txc_int *const tmp = rest;
+            rest = trim(quotient);
+            quotient = tmp;
+            multiplicity++;
+        }
+        // discard the last attempt
+        quotient->used = 0;
+        txc_int_free(quotient);
+        quotient = NULL;
+        if (multiplicity == 0)
+            continue;
+        divisor->data[0] = (TXC_INT_ARRAY_TYPE)d;
+        divisor->used = 1;
+        struct txc_int *const out_power = txc_int_pow(divisor, multiplicity / degree);
+        struct txc_int *const in_power = txc_int_pow(divisor, multiplicity % degree);
+        const bool success = out_power != NULL && in_power != NULL && mul_assign(&out, out_power) && mul_assign(&in, in_power);
+        txc_int_free(out_power);
+        txc_int_free(in_power);
+        if (!success)
+            goto error;
+    }
+    if (!txc_int_is_pos_one(rest)) {
+        bool exact;
+        struct txc_int *const root = txc_int_root(rest, degree, &exact);
+        if (root == NULL)
+            goto error;
+        const bool success = exact ? mul_assign(&out, root) : mul_assign(&in, rest);
+        txc_int_free(root);
+        if (!success)
+            goto error;
+    }
+    txc_int_free(rest);
+    txc_int_free(divisor);
+    *outside = out;
+    *inside = in;
+    return true;
+error:
+    txc_int_free(rest);
+    txc_int_free(out);
+    txc_int_free(in);
+    txc_int_free(divisor);
+    txc_int_free(quotient);
+    return false;
+}
+
+// Balanced, so both factors of every multiplication have about the same size and Karatsuba pays off.
+static struct txc_int *product_tree(const size_t *const values, const size_t len)
+{
+    size_t packed = 1;
+    size_t i = 0;
+    for (; i < len && values[i] <= SIZE_MAX / packed; i++)
+        packed *= values[i];
+    if (i == len)
+        return from_size(packed);
+    struct txc_int *const low = product_tree(values, len / 2);
+    struct txc_int *const high = product_tree(values + len / 2, len - len / 2);
+    struct txc_int *product = NULL;
+    if (low != NULL && high != NULL) {
+        const struct txc_int *const factors[2] = { low, high };
+        product = txc_int_mul(factors, 2);
+    }
+    txc_int_free(low);
+    txc_int_free(high);
+    return product;
+}
+
+// Odd primes up to n by a sieve over the odd numbers, index i stands for 2 * i + 1.
+static size_t *odd_primes(const size_t n, size_t *const amount)
+{
+    const size_t odd = n / 2 + n % 2;
+    bool *const composite = calloc(odd + 1, sizeof *composite);
+    if (composite == NULL) {
+        TXC_ERROR_ALLOC((odd + 1) * sizeof *composite, "prime sieve");
+        return NULL;
+    }
+    size_t count = 0;
+    for (size_t i = 1; i < odd; i++) {
+        if (composite[i])
+            continue;
+        count++;
+        const size_t p = 2 * i + 1;
+        if (p > n / p)
+            continue;
+        for (size_t j = p * p / 2; j < odd; j += p)
+            composite[j] = true;
+    }
+    size_t *const primes = malloc(sizeof *primes * (count + 1));
+    if (primes == NULL) {
+        TXC_ERROR_ALLOC(sizeof *primes * (count + 1), "primes");
+        free(composite);
+        return NULL;
+    }
+    *amount = 0;
+    for (size_t i = 1; i < odd; i++)
+        if (!composite[i])
+            primes[(*amount)++] = 2 * i + 1;
+    free(composite);
+    return primes;
+}
+
+// exponent of p in n! by Legendre's formula
+static size_t legendre(size_t n, const size_t p)
+{
+    size_t exponent = 0;
+    while (n >= p) {
+        n /= p;
+        exponent += n;
+    }
+    return exponent;
+}
+
+// Product of primes[i]^exponents[i] by Horner's scheme over the exponent bits, so every step is one squaring
+// of the accumulator and one product tree over the primes whose exponent has the current bit set.
+static struct txc_int *prime_power_product(const size_t *const primes, const size_t *const exponents, const size_t amount)
+{
+    size_t max = 0;
+    for (size_t i = 0; i < amount; i++)
+        if (exponents[i] > max)
+            max = exponents[i];
+    size_t bits = 0;
+    for (size_t rest = max; rest > 0; rest >>= 1)
+        bits++;
+    struct txc_int *acc = txc_int_create_one();
+    size_t *const selected = malloc(sizeof *selected * (amount + 1));
+    if (acc == NULL || selected == NULL) {
+        if (selected == NULL)
+            TXC_ERROR_ALLOC(sizeof *selected * (amount + 1), "selected primes");
+        txc_int_free(acc);
+        free(selected);
+        return NULL;
+    }
+    while (bits-- > 0) {
+        if (!txc_int_is_pos_one(acc) && !mul_assign(&acc, acc))
+            break;
+        size_t len = 0;
+        for (size_t i = 0; i < amount; i++)
+            if (exponents[i] >> bits & 1)
+                selected[len++] = primes[i];
+        struct txc_int *const product = product_tree(selected, len);
+        const bool success = product != NULL && mul_assign(&acc, product);
+        txc_int_free(product);
+        if (!success) {
+            txc_int_free(acc);
+            acc = NULL;
+            break;
+        }
+    }
+    free(selected);
+    return acc;
+}
+
+// n! / (k! * m!) for k + m <= n, the power of two is left out of the prime factorization and applied as a shift.
+static struct txc_int *prime_factorization_product(const size_t n, const size_t k, const size_t m)
+{
+    size_t amount = 0;
+    size_t *const primes = odd_primes(n, &amount);
+    if (primes == NULL)
+        return NULL;
+    size_t *const exponents = malloc(sizeof *exponents * (amount + 1));
+    if (exponents == NULL) {
+        TXC_ERROR_ALLOC(sizeof *exponents * (amount + 1), "prime exponents");
+        free(primes);
+        return NULL;
+    }
+    for (size_t i = 0; i < amount; i++)
+        exponents[i] = legendre(n, primes[i]) - legendre(k, primes[i]) - legendre(m, primes[i]);
+    struct txc_int *const product = prime_power_product(primes, exponents, amount);
+    free(primes);
+    free(exponents);
+    const size_t twos = legendre(n, 2) - legendre(k, 2) - legendre(m, 2);
+    return fit(shift_bigger_wide_amount(product, twos / TXC_INT_ARRAY_TYPE_WIDTH, twos % TXC_INT_ARRAY_TYPE_WIDTH));
+}
+
+struct txc_int *txc_int_factorial(const size_t n)
+{
+    return prime_factorization_product(n, 0, 0);
+}
+
+struct txc_int *txc_int_binomial(const size_t n, size_t k)
+{
+    if (k > n)
+        return txc_int_create_zero();
+    if (k > n - k)
+        k = n - k;
+    if (k > TXC_INT_BINOM_DIRECT_LIMIT)
+        return prime_factorization_product(n, k, n - k);
+    // (n - k + 1) * ... * n / k! without sieving up to a possibly huge n
+    size_t numerators[TXC_INT_BINOM_DIRECT_LIMIT + 1];
+    size_t denominators[TXC_INT_BINOM_DIRECT_LIMIT + 1];
+    for (size_t i = 0; i < k; i++) {
+        numerators[i] = n - i;
+        denominators[i] = i + 1;
+    }
+    struct txc_int *const numerator = product_tree(numerators, k);
+    struct txc_int *const denominator = product_tree(denominators, k);
+    struct txc_int *quotient = NULL;
+    if (numerator != NULL && denominator != NULL && !divrem_abs(numerator, denominator, &quotient, NULL))
+        quotient = NULL;
+    txc_int_free(numerator);
+    txc_int_free(denominator);
+    return quotient == NULL ? NULL : fit(quotient);
+}
+
+// B^limbs
+static struct txc_int *limb_power(const size_t limbs)
+{
+    struct txc_int *const power = init(limbs + 1);
+    if (power == NULL)
+        return NULL;
+    memset(power->data, 0, sizeof *power->data * limbs);
+    power->data[limbs] = 1;
+    power->used = limbs + 1;
+    return power;
+}
+
+// for k limbs of the modulus: 2k + 3 for q1 * mu, 2k + 2 for q3 * m and 2k for products of residues
+static size_t mod_scratch_size(const size_t k)
+{
+    return 6 * k + 5;
+}
+
+void txc_int_mod_ctx_free(const struct txc_int_mod_ctx *const ctx)
+{
+    if (ctx == NULL)
+        return;
+    txc_int_free(ctx->modulus);
+    txc_int_free(ctx->mu);
+    free(ctx->scratch);
+    free((struct txc_int_mod_ctx *)ctx);
+}
+
+// Barrett reduction modulo |modulus| with mu = B^(2k) / |modulus| for a modulus of k limbs, computed once per context.
+struct txc_int_mod_ctx *txc_int_mod_ctx_create(const struct txc_int *const modulus)
+{
+    assert(txc_int_test_valid(modulus));
+    assert(!txc_int_is_zero(modulus));
+    struct txc_int_mod_ctx *const ctx = malloc(sizeof *ctx);
+    if (ctx == NULL) {
+        TXC_ERROR_ALLOC(sizeof *ctx, "modular context");
+        return NULL;
+    }
+    const size_t k = modulus->used;
+    ctx->modulus = clone(modulus);
+    ctx->mu = NULL;
+    ctx->scratch = malloc(sizeof *ctx->scratch * mod_scratch_size(k));
+    if (ctx->scratch == NULL)
+        TXC_ERROR_ALLOC(sizeof *ctx->scratch * mod_scratch_size(k), "modular scratch space");
+    struct txc_int *const power = limb_power(2 * k);
+    if (ctx->modulus != NULL && power != NULL) {
+        ctx->modulus->neg = false;
+        if (!divrem_abs(power, ctx->modulus, &ctx->mu, NULL))
+            ctx->mu = NULL;
+    }
+    txc_int_free(power);
+    if (ctx->modulus == NULL || ctx->mu == NULL || ctx->scratch == NULL) {
+        txc_int_mod_ctx_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+// Reduces x with x_len <= 2k limbs in place, afterwards its lowest k limbs are x mod m.
+static bool barrett(const struct txc_int_mod_ctx *const ctx, TXC_INT_ARRAY_TYPE *const x, size_t x_len)
+{
+    const size_t k = ctx->modulus->used;
+    const TXC_INT_ARRAY_TYPE *const m = ctx->modulus->data;
+    assert(x_len <= 2 * k);
+    x_len = limbs_trim(x, x_len);
+    if (x_len >= k) {
+        TXC_INT_ARRAY_TYPE *const q2 = ctx->scratch;
+        TXC_INT_ARRAY_TYPE *const qm = q2 + 2 * k + 3;
+        // q3 = (x / B^(k - 1)) * mu / B^(k + 1) is at most 2 below x / m
+        const size_t q2_len = x_len - (k - 1) + ctx->mu->used;
+        if (!limbs_mul(q2, x + k - 1, x_len - (k - 1), ctx->mu->data, ctx->mu->used))
+            return false;
+        if (q2_len > k + 1) {
+            const size_t q3_len = q2_len - (k + 1);
+            if (!limbs_mul(qm, q2 + k + 1, q3_len, m, k))
+                return false;
+            limbs_sub(x, x, x_len, qm, limbs_trim(qm, q3_len + k));
+            x_len = limbs_trim(x, x_len);
+        }
+        while (x_len > k || (x_len == k && limbs_cmp(x, m, k) >= 0)) {
+            limbs_sub(x, x, x_len, m, k);
+            x_len = limbs_trim(x, x_len);
+        }
+    }
+    for (size_t i = x_len; i < k; i++)
+        x[i] = 0;
+    return true;
+}
+
+// r = a * b mod m for residues of k limbs, r may be a or b
+static bool mod_mul_limbs(const struct txc_int_mod_ctx *const ctx, TXC_INT_ARRAY_TYPE *const r, const TXC_INT_ARRAY_TYPE *const a, const TXC_INT_ARRAY_TYPE *const b)
+{
+    const size_t k = ctx->modulus->used;
+    TXC_INT_ARRAY_TYPE *const product = ctx->scratch + 4 * k + 5;
+    if (!limbs_mul(product, a, k, b, k) || !barrett(ctx, product, 2 * k))
+        return false;
+    memcpy(r, product, sizeof *r * k);
+    return true;
+}
+
+// residue of k limbs as int
+static struct txc_int *mod_result(struct txc_int *const r, const size_t k)
+{
+    r->used = k;
+    r->neg = false;
+    return fit(r);
+}
+
+// a mod |m| in [0, |m|) for any a
+struct txc_int *txc_int_mod_reduce(const struct txc_int_mod_ctx *const ctx, const struct txc_int *const a)
+{
+    if (ctx == NULL || a == NULL)
+        return NULL;
+    assert(txc_int_test_valid(a));
+    const size_t k = ctx->modulus->used;
+    struct txc_int *r = NULL;
+    if (a->used <= 2 * k) {
+        r = init(2 * k);
+        if (r == NULL)
+            return NULL;
+        memcpy(r->data, a->data, sizeof *r->data * a->used);
+        if (!barrett(ctx, r->data, a->used)) {
+            txc_int_free(r);
+            return NULL;
+        }
+    } else {
+        if (!divrem_abs(a, ctx->modulus, NULL, &r))
+            return NULL;
+        for (size_t i = r->used; i < k; i++)
+            r->data[i] = 0;
+    }
+    // m - r for negative a, unless r is 0
+    if (a->neg && limbs_trim(r->data, k) > 0)
+        limbs_sub(r->data, ctx->modulus->data, k, r->data, k);
+    return mod_result(r, k);
+}
+
+struct txc_int *txc_int_mod_add(const struct txc_int_mod_ctx *const ctx, const struct txc_int *const a, const struct txc_int *const b)
+{
+    if (ctx == NULL || a == NULL || b == NULL)
+        return NULL;
+    const struct txc_int *const longer = a->used >= b->used ? a : b;
+    const struct txc_int *const shorter = a->used >= b->used ? b : a;
+    const size_t k = ctx->modulus->used;
+    assert(longer->used <= k && !longer->neg && !shorter->neg);
+    struct txc_int *const r = init(2 * k);
+    if (r == NULL)
+        return NULL;
+    r->data[longer->used] = limbs_add(r->data, longer->data, longer->used, shorter->data, shorter->used);
+    if (!barrett(ctx, r->data, longer->used + 1)) {
+        txc_int_free(r);
+        return NULL;
+    }
+    return mod_result(r, k);
+}
+
+struct txc_int *txc_int_mod_mul(const struct txc_int_mod_ctx *const ctx, const struct txc_int *const a, const struct txc_int *const b)
+{
+    if (ctx == NULL || a == NULL || b == NULL)
+        return NULL;
+    const size_t k = ctx->modulus->used;
+    assert(a->used <= k && b->used <= k && !a->neg && !b->neg);
+    struct txc_int *const r = init(2 * k);
+    if (r == NULL)
+        return NULL;
+    memset(r->data, 0, sizeof *r->data * 2 * k);
+    if (a->used > 0 && b->used > 0 && (!limbs_mul(r->data, a->data, a->used, b->data, b->used) || !barrett(ctx, r->data, a->used + b->used))) {
+        txc_int_free(r);
+        return NULL;
+    }
+    return mod_result(r, k);
+}
+
+// base^exponent mod m with a fixed window of 4 bits, every product is reduced right away
+struct txc_int *txc_int_mod_pow(const struct txc_int_mod_ctx *const ctx, const struct txc_int *const base, const struct txc_int *const exponent)
+{
+    if (ctx == NULL || base == NULL || exponent == NULL)
+        return NULL;
+    assert(txc_int_test_valid(exponent) && !exponent->neg);
+    const size_t k = ctx->modulus->used;
+    struct txc_int *const reduced = txc_int_mod_reduce(ctx, base);
+    struct txc_int *const r = init(2 * k);
+    TXC_INT_ARRAY_TYPE *const table = malloc(sizeof *table * 16 * k);
+    if (reduced == NULL || r == NULL || table == NULL) {
+        if (table == NULL)
+            TXC_ERROR_ALLOC(sizeof *table * 16 * k, "modular power table");
+        txc_int_free(reduced);
+        txc_int_free(r);
+        free(table);
+        return NULL;
+    }
+    // table[i] = base^i, table[0] is 1 reduced, so 0 for m = 1
+    memset(table, 0, sizeof *table * 2 * k);
+    table[0] = 1;
+    bool success = barrett(ctx, table, 1);
+    memcpy(table + k, reduced->data, sizeof *table * reduced->used);
+    for (size_t i = 2; i < 16 && success; i++)
+        success = mod_mul_limbs(ctx, table + i * k, table + (i - 1) * k, table + k);
+    memcpy(r->data, table, sizeof *r->data * k);
+    bool started = false;
+    for (size_t i = 2 * exponent->used; i > 0 && success; i--) {
+        const uint_fast8_t nibble = exponent->data[(i - 1) / 2] >> ((i - 1) % 2 * 4) & 0xF;
+        for (uint_fast8_t j = 0; j < 4 && started && success; j++)
+            success = mod_mul_limbs(ctx, r->data, r->data, r->data);
+        if (nibble != 0 && success) {
+            success = mod_mul_limbs(ctx, r->data, r->data, table + nibble * k);
+            started = true;
+        }
+    }
+    txc_int_free(reduced);
+    free(table);
+    if (!success) {
+        r->used = 0;
+        txc_int_free(r);
+        return NULL;
+    }
+    return mod_result(r, k);
+}
+
+// Möller and Granlund: (u1 * B + u0) / d for a normalized d > u1 and v = (B^2 - 1) / d - B, stores the remainder in r
+static TXC_INT_ARRAY_TYPE limb_div_preinv(const TXC_INT_ARRAY_TYPE u1, const TXC_INT_ARRAY_TYPE u0, const TXC_INT_ARRAY_TYPE d, const TXC_INT_ARRAY_TYPE v, TXC_INT_ARRAY_TYPE *const r)
+{
+    const TXC_INT_DOUBLE_ARRAY_TYPE product = (TXC_INT_DOUBLE_ARRAY_TYPE)v * u1;
+    const TXC_INT_DOUBLE_ARRAY_TYPE low = (TXC_INT_DOUBLE_ARRAY_TYPE)(TXC_INT_ARRAY_TYPE)product + u0;
+    const TXC_INT_ARRAY_TYPE q0 = (TXC_INT_ARRAY_TYPE)low;
+    TXC_INT_ARRAY_TYPE q1 = (TXC_INT_ARRAY_TYPE)((product >> TXC_INT_ARRAY_TYPE_WIDTH) + u1 + (low >> TXC_INT_ARRAY_TYPE_WIDTH) + 1);
+    TXC_INT_ARRAY_TYPE rem = (TXC_INT_ARRAY_TYPE)(u0 - (TXC_INT_DOUBLE_ARRAY_TYPE)q1 * d);
+    if (rem > q0) {
+        q1--;
+        rem = (TXC_INT_ARRAY_TYPE)(rem + d);
+    }
+    if (rem >= d) {
+        q1++;
+        rem -= d;
+    }
+    *r = rem;
+    return q1;
+}
+
+// q = a / d for a single limb divisor, returns a % d, q may be a
+static TXC_INT_ARRAY_TYPE limbs_divrem_1_preinv(TXC_INT_ARRAY_TYPE *const q, const TXC_INT_ARRAY_TYPE *const a, const size_t len, const struct txc_int_divisor *const divisor)
+{
+    assert(len > 0);
+    const TXC_INT_ARRAY_TYPE d = divisor->norm->data[0];
+    const uint_fast8_t shift = divisor->shift;
+    // the bits shifted out of a are below d, so the quotient still has len limbs
+    TXC_INT_ARRAY_TYPE rem = shift == 0 ? 0 : (TXC_INT_ARRAY_TYPE)(a[len - 1] >> (TXC_INT_ARRAY_TYPE_WIDTH - shift));
+    for (size_t i = len; i > 0; i--) {
+        TXC_INT_ARRAY_TYPE u0 = (TXC_INT_ARRAY_TYPE)(a[i - 1] << shift);
+        if (shift > 0 && i > 1)
+            u0 = (TXC_INT_ARRAY_TYPE)(u0 | (a[i - 2] >> (TXC_INT_ARRAY_TYPE_WIDTH - shift)));
+        q[i - 1] = limb_div_preinv(rem, u0, d, divisor->inv, &rem);
+    }
+    return (TXC_INT_ARRAY_TYPE)(rem >> shift);
+}
+
+// B^(2n) / d for a normalized d of n limbs. The reciprocal of the upper half of d is correct to about half of the limbs,
+// so a single Newton step x + x * (B^(2n) - d * x) / B^(2n) leaves only a few units to correct.
+static struct txc_int *reciprocal(const struct txc_int *const d)
+{
+    const size_t n = d->used;
+    struct txc_int *const power = limb_power(2 * n);
+    if (power == NULL)
+        return NULL;
+    struct txc_int *x = NULL;
+    if (n < TXC_INT_RECIPROCAL_THRESHOLD) {
+        if (!divrem_abs(power, d, &x, NULL))
+            x = NULL;
+        txc_int_free(power);
+        return x;
+    }
+    const size_t low = n / 2;
+    struct txc_int *const high = init(n - low);
+    if (high != NULL) {
+        memcpy(high->data, d->data + low, sizeof *high->data * (n - low));
+        high->used = n - low;
+        x = shift_bigger_wide_amount(reciprocal(high), low, 0);
+        txc_int_free(high);
+    }
+    struct txc_int *const neg_d = txc_int_neg(txc_int_copy(d));
+    struct txc_int *const one = txc_int_create_one();
+    struct txc_int *const neg_one = txc_int_neg(txc_int_create_one());
+    struct txc_int *e = NULL;
+    if (x != NULL && neg_d != NULL && one != NULL && neg_one != NULL) {
+        // e = B^(2n) - d * x may be negative
+        const struct txc_int *factors[2] = { neg_d, x };
+        e = add_acc(txc_int_mul(factors, 2), power);
+        factors[1] = e;
+        factors[0] = x;
+        struct txc_int *const step = e == NULL ? NULL : txc_int_mul(factors, 2);
+        if (step != NULL)
+            trim(shift_smaller_wide_amount(step, 2 * n, 0));
+        x = add_acc(x, step);
+        txc_int_free(step);
+        txc_int_free(e);
+        factors[1] = x;
+        factors[0] = neg_d;
+        e = x == NULL ? NULL : add_acc(txc_int_mul(factors, 2), power);
+    }
+    while (x != NULL && e != NULL && e->neg) {
+        x = add_acc(x, neg_one);
+        e = add_acc(e, d);
+    }
+    while (x != NULL && e != NULL && txc_int_cmp_abs(e, d) >= 0) {
+        x = add_acc(x, one);
+        e = add_acc(e, neg_d);
+    }
+    if (e == NULL) {
+        txc_int_free(x);
+        x = NULL;
+    }
+    txc_int_free(e);
+    txc_int_free(power);
+    txc_int_free(neg_d);
     txc_int_free(one);
-    txc_int_free(div);
-    txc_int_free(mod);
-    return NULL;
+    txc_int_free(neg_one);
+    return x;
+}
+
+// Divides blocks of up to n limbs from the top by the reciprocal, estimating every block of the quotient from a product like Barrett reduction.
+static bool limbs_divrem_preinv(TXC_INT_ARRAY_TYPE *const q, TXC_INT_ARRAY_TYPE *const r, const TXC_INT_ARRAY_TYPE *const a, const size_t a_len, const struct txc_int_divisor *const divisor)
+{
+    const TXC_INT_ARRAY_TYPE *const d = divisor->norm->data;
+    const size_t n = divisor->norm->used;
+    const struct txc_int *const recip = divisor->recip;
+    assert(recip->used == n + 1);
+    // the normalized dividend with n zero limbs on top, the quotient, one block of it and two products
+    const size_t len = a_len + 1;
+    const size_t tmp_size = sizeof(TXC_INT_ARRAY_TYPE) * ((len + n) + len + (n + 1) + (2 * n + 2) + (2 * n + 1));
+    TXC_INT_ARRAY_TYPE *const tmp = malloc(tmp_size);
+    if (tmp == NULL) {
+        TXC_ERROR_ALLOC(tmp_size, "division by reciprocal");
+        return false;
+    }
+    TXC_INT_ARRAY_TYPE *const rem = tmp;
+    TXC_INT_ARRAY_TYPE *const quot = rem + len + n;
+    TXC_INT_ARRAY_TYPE *const block = quot + len;
+    TXC_INT_ARRAY_TYPE *const estimate = block + n + 1;
+    TXC_INT_ARRAY_TYPE *const product = estimate + 2 * n + 2;
+    rem[a_len] = limbs_lshift(rem, a, a_len, divisor->shift);
+    memset(rem + len, 0, sizeof *rem * n);
+    const TXC_INT_ARRAY_TYPE one = 1;
+    for (size_t j = len; j > 0;) {
+        const size_t k = txc_min(n, j);
+        j -= k;
+        // x = rem[j, j + k + n) is below d * B^k as its upper n limbs are the last remainder
+        TXC_INT_ARRAY_TYPE *const x = rem + j;
+        // (x / B^(n - 1)) * recip / B^(n + 1) is at most 2 below x / d
+        if (!limbs_mul(estimate, x + n - 1, k + 1, recip->data, n + 1)) {
+            free(tmp);
+            return false;
+        }
+        memcpy(block, estimate + n + 1, sizeof *block * (k + 1));
+        const size_t block_len = limbs_trim(block, k + 1);
+        if (block_len > 0) {
+            if (!limbs_mul(product, d, n, block, block_len)) {
+                free(tmp);
+                return false;
+            }
+            limbs_sub(x, x, k + n, product, limbs_trim(product, n + block_len));
+        }
+        for (size_t x_len = limbs_trim(x, k + n); x_len > n || (x_len == n && limbs_cmp(x, d, n) >= 0); x_len = limbs_trim(x, k + n)) {
+            limbs_sub(x, x, k + n, d, n);
+            limbs_add(block, block, k + 1, &one, 1);
+        }
+        assert(block[k] == 0);
+        memcpy(quot + j, block, sizeof *block * k);
+    }
+    memcpy(q, quot, sizeof *q * (a_len - n + 1));
+    limbs_rshift(r, rem, n, divisor->shift);
+    free(tmp);
+    return true;
+}
+
+void txc_int_divisor_free(const struct txc_int_divisor *const divisor)
+{
+    if (divisor == NULL)
+        return;
+    txc_int_free(divisor->divisor);
+    txc_int_free(divisor->norm);
+    txc_int_free(divisor->recip);
+    free((struct txc_int_divisor *)divisor);
+}
+
+// Normalizes the divisor and computes its reciprocal once, so repeated divisions by it get cheaper.
+struct txc_int_divisor *txc_int_divisor_create(const struct txc_int *const divisor)
+{
+    if (divisor == NULL)
+        return NULL;
+    assert(txc_int_test_valid(divisor));
+    assert(!txc_int_is_zero(divisor));
+    struct txc_int_divisor *const obj = malloc(sizeof *obj);
+    if (obj == NULL) {
+        TXC_ERROR_ALLOC(sizeof *obj, "divisor");
+        return NULL;
+    }
+    const size_t n = divisor->used;
+    obj->divisor = txc_int_copy(divisor);
+    obj->norm = init(n);
+    obj->shift = limb_clz(divisor->data[n - 1]);
+    obj->inv = 0;
+    obj->recip = NULL;
+    if (obj->divisor == NULL || obj->norm == NULL) {
+        txc_int_divisor_free(obj);
+        return NULL;
+    }
+    limbs_lshift(obj->norm->data, divisor->data, n, obj->shift);
+    obj->norm->used = n;
+    if (n == 1) {
+        const TXC_INT_DOUBLE_ARRAY_TYPE max = ((TXC_INT_DOUBLE_ARRAY_TYPE)TXC_INT_ARRAY_TYPE_MAX << TXC_INT_ARRAY_TYPE_WIDTH) | TXC_INT_ARRAY_TYPE_MAX;
+        obj->inv = (TXC_INT_ARRAY_TYPE)(max / obj->norm->data[0] - ((TXC_INT_DOUBLE_ARRAY_TYPE)TXC_INT_ARRAY_TYPE_MAX + 1));
+    } else if (n >= TXC_INT_RECIPROCAL_THRESHOLD) {
+        obj->recip = reciprocal(obj->norm);
+        if (obj->recip == NULL) {
+            txc_int_divisor_free(obj);
+            return NULL;
+        }
+    }
+    return obj;
+}
+
+const struct txc_int *txc_int_divisor_value(const struct txc_int_divisor *const divisor)
+{
+    assert(divisor != NULL);
+    return divisor->divisor;
+}
+
+// divrem_abs using the precomputations of the divisor
+static bool divisor_divrem_abs(const struct txc_int *const dividend, const struct txc_int_divisor *const divisor, struct txc_int **const quotient, struct txc_int **const remainder)
+{
+    assert(txc_int_test_valid(dividend));
+    const size_t n = divisor->norm->used;
+    if ((n > 1 && divisor->recip == NULL) || dividend->used < n)
+        return divrem_abs(dividend, divisor->divisor, quotient, remainder);
+    const size_t q_used = dividend->used - n + 1;
+    struct txc_int *const q = init(q_used);
+    struct txc_int *const r = init(n);
+    if (q == NULL || r == NULL) {
+        txc_int_free(q);
+        txc_int_free(r);
+        return false;
+    }
+    q->used = q_used;
+    r->used = n;
+    if (n == 1) {
+        r->data[0] = limbs_divrem_1_preinv(q->data, dividend->data, dividend->used, divisor);
+    } else if (!limbs_divrem_preinv(q->data, r->data, dividend->data, dividend->used, divisor)) {
+        txc_int_free(q);
+        txc_int_free(r);
+        return false;
+    }
+    if (quotient != NULL)
+        *quotient = trim(q);
+    else
+        txc_int_free(trim(q));
+    if (remainder != NULL)
+        *remainder = trim(r);
+    else
+        txc_int_free(trim(r));
+    return true;
+}
+
+// Applies the mode to the results of dividing the absolute values and consumes them.
+static bool divmod_signs(const struct txc_int *const dividend, const struct txc_int *const divisor, const enum txc_int_div_mode mode, struct txc_int *q, struct txc_int *r, struct txc_int **const quotient, struct txc_int **const remainder)
+{
+    bool adjust = false;
+    if (r->used > 0) {
+        switch (mode) {
+        case TXC_INT_DIV_TRUNC:
+            break;
+        case TXC_INT_DIV_FLOOR:
+            adjust = dividend->neg != divisor->neg;
+            break;
+        case TXC_INT_DIV_EUCLID:
+            adjust = dividend->neg;
+            break;
+        }
+    }
+    // the quotient moves one further away from 0 and the remainder becomes |divisor| - remainder
+    if (adjust) {
+        struct txc_int *const one = txc_int_create_one();
+        q = add_acc(q, one);
+        txc_int_free(one);
+        struct txc_int *const complement = init(divisor->used);
+        if (complement != NULL) {
+            limbs_sub(complement->data, divisor->data, divisor->used, r->data, r->used);
+            complement->used = divisor->used;
+            trim(complement);
+        }
+        txc_int_free(r);
+        r = complement;
+        if (q == NULL || r == NULL) {
+            txc_int_free(q);
+            txc_int_free(r);
+            return false;
+        }
+    }
+    q->neg = q->used > 0 && dividend->neg != divisor->neg;
+    switch (mode) {
+    case TXC_INT_DIV_TRUNC:
+        r->neg = r->used > 0 && dividend->neg;
+        break;
+    case TXC_INT_DIV_FLOOR:
+        r->neg = r->used > 0 && divisor->neg;
+        break;
+    case TXC_INT_DIV_EUCLID:
+        r->neg = false;
+        break;
+    }
+    if (quotient != NULL)
+        *quotient = fit(q);
+    else
+        txc_int_free(q);
+    if (remainder != NULL)
+        *remainder = fit(r);
+    else
+        txc_int_free(r);
+    return true;
+}
+
+// dividend = quotient * divisor + remainder in one division, either of quotient and remainder may be NULL.
+// The remainder has the sign of the dividend when truncating, the sign of the divisor when flooring and is never negative for euclidean division.
+bool txc_int_divmod(const struct txc_int *const dividend, const struct txc_int *const divisor, const enum txc_int_div_mode mode, struct txc_int **const quotient, struct txc_int **const remainder)
+{
+    if (dividend == NULL || divisor == NULL)
+        return false;
+    assert(txc_int_test_valid(dividend));
+    assert(txc_int_test_valid(divisor));
+    assert(!txc_int_is_zero(divisor));
+    struct txc_int *q;
+    struct txc_int *r;
+    if (!divrem_abs(dividend, divisor, &q, &r))
+        return false;
+    return divmod_signs(dividend, divisor, mode, q, r, quotient, remainder);
+}
+
+// txc_int_divmod by a divisor object
+bool txc_int_divisor_divmod(const struct txc_int *const dividend, const struct txc_int_divisor *const divisor, const enum txc_int_div_mode mode, struct txc_int **const quotient, struct txc_int **const remainder)
+{
+    if (dividend == NULL || divisor == NULL)
+        return false;
+    struct txc_int *q;
+    struct txc_int *r;
+    if (!divisor_divrem_abs(dividend, divisor, &q, &r))
+        return false;
+    return divmod_signs(dividend, divisor->divisor, mode, q, r, quotient, remainder);
+}
+
+struct txc_int *txc_int_divisor_div(const struct txc_int *const dividend, const struct txc_int_divisor *const divisor)
+{
+    struct txc_int *quotient;
+    if (!txc_int_divisor_divmod(dividend, divisor, TXC_INT_DIV_TRUNC, &quotient, NULL))
+        return NULL;
+    return quotient;
 }
 
 struct txc_int *txc_int_div(const struct txc_int *const dividend, const struct txc_int *const divisor)
 {
-    return div_mod(dividend, divisor, false);
+    struct txc_int *quotient;
+    if (!txc_int_divmod(dividend, divisor, TXC_INT_DIV_TRUNC, &quotient, NULL))
+        return NULL;
+    return quotient;
 }
 
 struct txc_int *txc_int_mod(const struct txc_int *const dividend, const struct txc_int *const divisor)
 {
-    return div_mod(dividend, divisor, true);
+    struct txc_int *remainder;
+    if (!txc_int_divmod(dividend, divisor, TXC_INT_DIV_EUCLID, NULL, &remainder))
+        return NULL;
+    return remainder;
 }
 
 /* PRINT */
 
+static void dec_divisors_free(struct txc_int_divisor **const divisors, const size_t amount)
+{
+    if (divisors == NULL)
+        return;
+    for (size_t i = 0; i < amount; i++)
+        txc_int_divisor_free(divisors[i]);
+    free(divisors);
+}
+
+// Every power of ten divides many chunks, so each gets its reciprocal once. Consumes powers.
+static struct txc_int_divisor **dec_divisors(struct txc_int **const powers, const size_t amount)
+{
+    if (powers == NULL)
+        return NULL;
+    struct txc_int_divisor **const divisors = calloc(amount + 1, sizeof *divisors);
+    if (divisors == NULL)
+        TXC_ERROR_ALLOC(sizeof *divisors * (amount + 1), "divisors of powers of ten");
+    for (size_t i = 0; i < amount && divisors != NULL; i++) {
+        divisors[i] = txc_int_divisor_create(powers[i]);
+        if (divisors[i] == NULL) {
+            dec_divisors_free(divisors, i);
+            dec_powers_free(powers, amount);
+            return NULL;
+        }
+    }
+    dec_powers_free(powers, amount);
+    return divisors;
+}
+
+struct str_task {
+    struct txc_pool_task task;
+    struct txc_int *integer;
+    size_t power_i;
+    char *out;
+    struct txc_int_divisor *const *divisors;
+    bool success;
+};
+
+// writes exactly len digits and consumes integer
+static void to_dec_basecase(struct txc_int *const integer, char *const out, const size_t len)
+{
+    for (size_t i = len; i > 0; i--) {
+        out[i - 1] = '0' + limbs_divrem_1(integer->data, integer->data, integer->used, 10);
+        trim(integer);
+    }
+    assert(txc_int_is_zero(integer));
+    txc_int_free(integer);
+}
+
+static bool to_dec_chunk(struct txc_int *const integer, const size_t power_i, char *const out, struct txc_int_divisor *const *const divisors);
+
+static void to_dec_task_run(void *const arg)
+{
+    struct str_task *const task = arg;
+    task->success = to_dec_chunk(task->integer, task->power_i, task->out, task->divisors);
+}
+
+// writes exactly TXC_INT_DEC_BASECASE * 2^power_i digits and consumes integer
+static bool to_dec_chunk(struct txc_int *const integer, const size_t power_i, char *const out, struct txc_int_divisor *const *const divisors)
+{
+    const size_t len = dec_chunk_len(power_i);
+    if (power_i == 0) {
+        to_dec_basecase(integer, out, len);
+        return true;
+    }
+    struct txc_int *high = NULL;
+    struct txc_int *low_int = NULL;
+    const bool split = divisor_divrem_abs(integer, divisors[power_i - 1], &high, &low_int);
+    txc_int_free(integer);
+    if (!split)
+        return false;
+    struct str_task low = { .integer = low_int, .power_i = power_i - 1, .out = out + len / 2, .divisors = divisors, .success = false };
+    const bool parallel = len >= TXC_INT_DEC_PARALLEL_THRESHOLD;
+    if (parallel)
+        txc_pool_submit(&low.task, &to_dec_task_run, &low);
+    else
+        to_dec_task_run(&low);
+    const bool success = to_dec_chunk(high, power_i - 1, out, divisors);
+    if (parallel)
+        txc_pool_wait(&low.task);
+    return success && low.success;
+}
+
 char *txc_int_to_str(const struct txc_int *const integer)
 {
     if (integer == NULL)
@@ -738,46 +2800,85 @@ char *txc_int_to_str(const struct txc_int *const integer)
         TXC_ERROR_OVERFLOW("integer decimal string buffer");
         return NULL;
     }
-    const size_t max_len = TXC_INT_ARRAY_TYPE_WIDTH / CHAR_BIT * 3 * integer->used + 1 + 3;
-    char *str = malloc(max_len);
+    // 28 / 93 > log10(2)
+    const size_t bits = integer->used * TXC_INT_ARRAY_TYPE_WIDTH;
+    const size_t powers_amount = dec_powers_amount(bits / 93 * 28 + bits % 93 * 28 / 93 + 1);
+    struct txc_int_divisor **const divisors = dec_divisors(dec_powers(powers_amount), powers_amount);
+    struct str_task *const chunks = malloc(sizeof *chunks * (powers_amount + 1));
+    struct txc_int *lead = clone(integer);
+    if (divisors == NULL || chunks == NULL || lead == NULL) {
+        if (chunks == NULL)
+            TXC_ERROR_ALLOC(sizeof *chunks * (powers_amount + 1), "decimal chunks");
+        dec_divisors_free(divisors, powers_amount);
+        free(chunks);
+        txc_int_free(lead);
+        return NULL;
+    }
+    lead->neg = false;
+    // split off the low chunks first, so the exact length and thus every final position is known
+    size_t chunk_amount = 0;
+    size_t chunks_len = 0;
+    bool success = true;
+    for (size_t i = powers_amount; i > 0 && success; i--) {
+        if (txc_int_cmp_abs(lead, divisors[i - 1]->divisor) < 0)
+            continue;
+        struct txc_int *high = NULL;
+        struct txc_int *low = NULL;
+        success = divisor_divrem_abs(lead, divisors[i - 1], &high, &low);
+        if (!success)
+            break;
+        txc_int_free(lead);
+        lead = high;
+        chunks[chunk_amount].integer = low;
+        chunks[chunk_amount].power_i = i - 1;
+        chunks[chunk_amount].divisors = divisors;
+        chunks[chunk_amount].success = false;
+        chunk_amount++;
+        chunks_len += dec_chunk_len(i - 1);
+    }
+    char lead_str[TXC_INT_DEC_BASECASE];
+    size_t lead_len = 0;
+    while (success && !txc_int_is_zero(lead)) {
+        lead_str[TXC_INT_DEC_BASECASE - lead_len - 1] = '0' + limbs_divrem_1(lead->data, lead->data, lead->used, 10);
+        trim(lead);
+        lead_len++;
+    }
+    txc_int_free(lead);
+    const size_t len = lead_len + chunks_len + (integer->neg ? 3 : 0);
+    char *const str = success ? malloc(len + 1) : NULL;
     if (str == NULL) {
-        TXC_ERROR_ALLOC(max_len, "integer decimal string");
-        return NULL;
-    }
-    size_t int_len = 0;
-    for (size_t array_i = integer->used; array_i > 0; array_i--) {
-        for (size_t bit_i = TXC_INT_ARRAY_TYPE_WIDTH; bit_i > 0; bit_i--) {
-            uint_fast8_t carry = (integer->data[array_i - 1] >> (bit_i - 1)) & 1;
-            for (size_t i = 0; i < int_len; i++) {
-                if (str[i] >= 5)
-                    str[i] += 3;
-                str[i] = (str[i] << 1) + carry;
-                carry = str[i] > 15 ? 1 : 0;
-                str[i] = str[i] & 15;
-            }
-            if (carry != 0) {
-                str[int_len] = 1;
-                int_len++;
-            }
-        }
+        if (success)
+            TXC_ERROR_ALLOC(len + 1, "integer decimal string");
+        for (size_t i = 0; i < chunk_amount; i++)
+            txc_int_free(chunks[i].integer);
+        dec_divisors_free(divisors, powers_amount);
+        free(chunks);
+        return NULL;
     }
-    const size_t len = integer->neg ? int_len + 3 : int_len;
-    char *tmp = realloc(str, len + 1);
-    if (tmp != NULL)
-        str = tmp;
-    str[len] = 0;
-    if (integer->neg) {
-        str[len - 1] = 0;
-        for (size_t i = 0; i < int_len; i++)
-            str[int_len - i - 1 + 2] = str[int_len - i - 1] + 48;
-        str = txc_strrev(str + 2) - 2;
-        str[0] = '(';
-        str[1] = '-';
-        str[len - 1] = ')';
-    } else {
-        for (size_t i = 0; i < int_len; i++)
-            str[i] += 48;
-        str = txc_strrev(str);
+    char *cur = integer->neg ? txc_stpcpy(str, "(-") : str;
+    memcpy(cur, lead_str + TXC_INT_DEC_BASECASE - lead_len, lead_len);
+    cur += lead_len;
+    for (size_t i = chunk_amount; i > 0; i--) {
+        chunks[i - 1].out = cur;
+        cur += dec_chunk_len(chunks[i - 1].power_i);
+        if (chunks_len >= TXC_INT_DEC_PARALLEL_THRESHOLD)
+            txc_pool_submit(&chunks[i - 1].task, &to_dec_task_run, &chunks[i - 1]);
+        else
+            to_dec_task_run(&chunks[i - 1]);
+    }
+    if (integer->neg)
+        cur = txc_stpcpy(cur, ")");
+    *cur = 0;
+    for (size_t i = chunk_amount; i > 0; i--) {
+        if (chunks_len >= TXC_INT_DEC_PARALLEL_THRESHOLD)
+            txc_pool_wait(&chunks[i - 1].task);
+        success = success && chunks[i - 1].success;
+    }
+    dec_divisors_free(divisors, powers_amount);
+    free(chunks);
+    if (!success) {
+        free(str);
+        return NULL;
     }
     return str;
 }
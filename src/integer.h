@@ -30,6 +30,16 @@
 
 typedef struct txc_int txc_int;
 
+typedef struct txc_int_mod_ctx txc_int_mod_ctx;
+
+typedef struct txc_int_divisor txc_int_divisor;
+
+enum txc_int_div_mode {
+    TXC_INT_DIV_TRUNC,
+    TXC_INT_DIV_FLOOR,
+    TXC_INT_DIV_EUCLID
+};
+
 /* VALID */
 
 extern bool txc_int_test_valid(const txc_int *const integer);
@@ -44,6 +54,7 @@ extern txc_int *txc_int_create_zero(void);
 
 extern txc_int *txc_int_create_one(void);
 
+// Takes another reference instead of duplicating the limbs, mutations clone shared integers first.
 extern txc_int *txc_int_copy(const txc_int *const from);
 
 extern void txc_int_free(const txc_int *const integer);
@@ -58,21 +69,85 @@ bool txc_int_is_neg_one(const txc_int *const test);
 
 bool txc_int_is_neg(const txc_int *const test);
 
+bool txc_int_is_odd(const txc_int *const test);
+
+extern size_t txc_int_bit_length(const txc_int *const integer);
+
+// 0 for 0
+extern size_t txc_int_trailing_zeros(const txc_int *const integer);
+
+// Whether |test| is 2^exponent, which is only set if it is.
+extern bool txc_int_is_pow2(const txc_int *const test, size_t *const exponent);
+
+// integer * 2^bits without a multiplication
+extern txc_int *txc_int_shift_left(const txc_int *const integer, const size_t bits);
+
+// integer / 2^bits rounded like txc_int_divmod in mode, without a division
+extern txc_int *txc_int_shift_right(const txc_int *const integer, const size_t bits, const enum txc_int_div_mode mode);
+
 extern int_fast8_t txc_int_cmp_abs(const txc_int *const a, const txc_int *const b);
 
 extern int_fast8_t txc_int_cmp(const txc_int *const a, const txc_int *const b);
 
+// Memory held by the integer, including references shared with others.
+extern size_t txc_int_bytes(const txc_int *const integer);
+
+// Equal integers have equal fingerprints. Only the length, the sign and the outermost limbs are read, so this is O(1).
+extern uint32_t txc_int_fingerprint(const txc_int *const integer);
+
+// Negates in place unless shared, then this reference is swapped for a negated clone. Always use the result.
 extern txc_int *txc_int_neg(txc_int *const integer);
 
 extern txc_int *txc_int_add(const txc_int *const *const summands, const size_t len);
 
 extern txc_int *txc_int_mul(const txc_int *const *const factors, const size_t len);
 
+// *acc is unshared before it is updated.
+extern bool txc_int_addmul(txc_int **const acc, const txc_int *const a, const txc_int *const b);
+
+extern bool txc_int_submul(txc_int **const acc, const txc_int *const a, const txc_int *const b);
+
+extern bool txc_int_abs_to_size(const txc_int *const integer, size_t *const out);
+
+extern txc_int *txc_int_pow(const txc_int *const base, const size_t exponent);
+
+extern txc_int *txc_int_root(const txc_int *const radicand, const size_t degree, bool *const exact);
+
+extern bool txc_int_root_split(const txc_int *const radicand, const size_t degree, txc_int **const outside, txc_int **const inside);
+
+extern txc_int *txc_int_factorial(const size_t n);
+
+extern txc_int *txc_int_binomial(const size_t n, size_t k);
+
+extern txc_int_mod_ctx *txc_int_mod_ctx_create(const txc_int *const modulus);
+
+extern void txc_int_mod_ctx_free(const txc_int_mod_ctx *const ctx);
+
+extern txc_int *txc_int_mod_reduce(const txc_int_mod_ctx *const ctx, const txc_int *const a);
+
+extern txc_int *txc_int_mod_add(const txc_int_mod_ctx *const ctx, const txc_int *const a, const txc_int *const b);
+
+extern txc_int *txc_int_mod_mul(const txc_int_mod_ctx *const ctx, const txc_int *const a, const txc_int *const b);
+
+extern txc_int *txc_int_mod_pow(const txc_int_mod_ctx *const ctx, const txc_int *const base, const txc_int *const exponent);
+
 extern txc_int *txc_int_gcd(const txc_int *const aa, const txc_int *const bb);
 
+extern bool txc_int_divmod(const txc_int *const dividend, const txc_int *const divisor, const enum txc_int_div_mode mode, txc_int **const quotient, txc_int **const remainder);
+
 extern txc_int *txc_int_div(const txc_int *const dividend, const txc_int *const divisor);
 
-// extern txc_int *txc_int_mod(const txc_int *const dividend, const txc_int *const divisor);
+extern txc_int_divisor *txc_int_divisor_create(const txc_int *const divisor);
+
+extern void txc_int_divisor_free(const txc_int_divisor *const divisor);
+
+extern const txc_int *txc_int_divisor_value(const txc_int_divisor *const divisor);
+
+extern bool txc_int_divisor_divmod(const txc_int *const dividend, const txc_int_divisor *const divisor, const enum txc_int_div_mode mode, txc_int **const quotient, txc_int **const remainder);
+
+extern txc_int *txc_int_divisor_div(const txc_int *const dividend, const txc_int_divisor *const divisor);
+
+extern txc_int *txc_int_mod(const txc_int *const dividend, const txc_int *const divisor);
 
 /* PRINT */
 
@@ -16,36 +16,178 @@
  */
 
 #include <assert.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 
 #include "node.h"
 #include "integer.h"
+#include "rational.h"
 #include "util.h"
+#include "var.h"
 
 #define TXC_NAN_REASON "\\text{NAN(%s)}"
 #define TXC_NAN_REASON_ERROR_ALLOC "Could not allocate enough memory. Please see stderr for more information."
 #define TXC_NAN_REASON_ERROR_INVALID_NODE_TYPE "Node type is invalid. Please see stderr for more information."
 #define TXC_NAN_REASON_ERROR_NYI "Not yet implemented. Please see stderr for more information."
+#define TXC_NAN_REASON_ERROR_NOT_REAL "Result is not a real number."
 #define TXC_NAN_REASON_ERROR_OVERFLOW "Overflow occured. Please see stderr for more information."
+#define TXC_NAN_REASON_ERROR_UNDEFINED "Result is undefined."
 #define TXC_NAN_REASON_ERROR_ZERO_DIVISION "Divided by 0."
 #define TXC_NAN_REASON_UNSPECIFIED "unspecified"
+#define TXC_NAN_REASON_ERROR_UNKNOWN_VARIABLE "Variable is not defined."
+#define TXC_NAN_REASON_ERROR_CYCLIC_DEFINITION "Definition depends on itself."
 
 #define TXC_PRINT_FORMAT "= %s \\\\\n"
 #define TXC_PRINT_FORMAT_NEWLINE "= %s \\\\\n\n"
 #define TXC_PRINT_ERROR "\\text{PRINT(Unable to print. Please see stderr for more information.)}"
 
+// distinct divisors of \bmod and floors kept while simplifying a line
+#ifndef TXC_NODE_DIVISOR_CACHE
+#define TXC_NODE_DIVISOR_CACHE 8
+#endif /* TXC_NODE_DIVISOR_CACHE */
+
+// bytes of the first arena chunk, later chunks double until a line fits
+#ifndef TXC_NODE_ARENA_CHUNK
+#define TXC_NODE_ARENA_CHUNK 65536
+#endif /* TXC_NODE_ARENA_CHUNK */
+
+// bits of the largest powers folded while parsing, larger ones are left to the whole line, whose \bmod may reduce them
+#ifndef TXC_NODE_FOLD_BITS
+#define TXC_NODE_FOLD_BITS 65536
+#endif /* TXC_NODE_FOLD_BITS */
+
+// slots of the first table of shared subtrees, it doubles while at least half full
+#ifndef TXC_NODE_CONS_SIZE
+#define TXC_NODE_CONS_SIZE 256
+#endif /* TXC_NODE_CONS_SIZE */
+#if TXC_NODE_CONS_SIZE < 2 || (TXC_NODE_CONS_SIZE & (TXC_NODE_CONS_SIZE - 1)) != 0
+#error "TXC_NODE_CONS_SIZE has to be a power of 2 of at least 2"
+#endif /* TXC_NODE_CONS_SIZE < 2 || (TXC_NODE_CONS_SIZE & (TXC_NODE_CONS_SIZE - 1)) != 0 */
+
+// nodes of the largest operations whose results are kept across lines, copying larger keys would be quadratic in deeply nested ones
+#ifndef TXC_NODE_MEMO_NODES
+#define TXC_NODE_MEMO_NODES 4096
+#endif /* TXC_NODE_MEMO_NODES */
+
+// buckets of the first table of results kept across lines, it doubles once there are more entries than buckets
+#ifndef TXC_NODE_MEMO_BUCKETS
+#define TXC_NODE_MEMO_BUCKETS 64
+#endif /* TXC_NODE_MEMO_BUCKETS */
+#if TXC_NODE_MEMO_BUCKETS < 1 || (TXC_NODE_MEMO_BUCKETS & (TXC_NODE_MEMO_BUCKETS - 1)) != 0
+#error "TXC_NODE_MEMO_BUCKETS has to be a power of 2"
+#endif /* TXC_NODE_MEMO_BUCKETS < 1 || (TXC_NODE_MEMO_BUCKETS & (TXC_NODE_MEMO_BUCKETS - 1)) != 0 */
+
 /* DEFINITIONS */
 
+static txc_int_divisor *divisor_cache[TXC_NODE_DIVISOR_CACHE];
+static size_t divisor_cache_next = 0;
+
 struct txc_node {
     union impl impl;
     size_t children_amount;
     enum txc_node_type type;
     bool read_only;
+    bool in_arena;
+    // set on operations occurring more than once in the line being simplified
+    bool repeated;
+    // set on the tree of the line being simplified, whose hashes are valid
+    bool hashed;
+    // valid along with hash, set on subtrees that always evaluate to an integer and never to a NAN
+    bool pure;
+    // valid along with hash, set on subtrees referring to a variable, whose results are not kept past the line as it might be redefined
+    bool refers;
+    uint32_t hash;
+    // nodes of the subtree up to UINT32_MAX, valid along with hash
+    uint32_t nodes;
     struct txc_node *children[];
 };
 
+union arena_align {
+    void *pointer;
+    size_t size;
+    double real;
+};
+
+// The newest chunk is the largest one and the only one kept when the arena is released.
+struct arena_chunk {
+    struct arena_chunk *older;
+    size_t size;
+    size_t used;
+    union arena_align data[];
+};
+
+// Nodes are only built on the main thread, so the arena is not locked.
+static bool arena_active = false;
+static struct arena_chunk *arena = NULL;
+// INT nodes in the arena, whose integer references are dropped on release
+static struct txc_node **arena_ints = NULL;
+static size_t arena_ints_used = 0;
+static size_t arena_ints_size = 0;
+
+// One slot per distinct operation of the line being simplified, the first occurrence stands for all equal ones.
+struct cons_entry {
+    struct txc_node *node;
+    struct txc_node *simple;
+};
+
+static struct cons_entry *cons_table = NULL;
+static size_t cons_size = 0;
+static size_t cons_used = 0;
+// set while a line is simplified, the variables it asks for are simplified within it and leave its tables alone
+static bool in_line = false;
+
+// Simplified subtrees of earlier lines on the heap, keyed by a copy of the subtree with its hashes.
+struct memo_entry {
+    struct memo_entry *older;
+    struct memo_entry *newer;
+    struct memo_entry *next_in_bucket;
+    struct txc_node *key;
+    struct txc_node *simple;
+    // rendered result, only set for whole lines
+    char *str;
+    size_t bytes;
+    uint32_t hash;
+};
+
+static bool fold_enabled = false;
+
+static size_t memo_budget = 0;
+static struct memo_entry **memo_buckets = NULL;
+static size_t memo_bucket_amount = 0;
+static struct memo_entry *memo_newest = NULL;
+static struct memo_entry *memo_oldest = NULL;
+static struct txc_node_memo_stats memo_stats = { 0 };
+
+static struct txc_node_rewrite_stats rewrite_stats = { 0 };
+
+// Operands simplified by drive before the operation asking for them, so simplify does not recurse into the tree.
+struct prepared {
+    const struct txc_node *node;
+    struct txc_node *simple;
+};
+
+// A node of the tree being simplified by drive, whose operands before next are prepared.
+struct drive_frame {
+    const struct txc_node *node;
+    // the children of node or an allocated list, such as the summands of nested sums
+    const struct txc_node *const *operands;
+    size_t amount;
+    size_t next;
+    // the first operand prepared for node
+    size_t base;
+    bool owned;
+};
+
+static struct prepared *prepared = NULL;
+static size_t prepared_used = 0;
+static size_t prepared_size = 0;
+// the operands of the node simplify is working on
+static size_t prepared_base = 0;
+static size_t prepared_end = 0;
+static size_t prepared_next = 0;
+
 /* CONSTANTS */
 
 const struct txc_node TXC_NAN_ERROR_ALLOC = { .impl.reason = TXC_NAN_REASON_ERROR_ALLOC,
@@ -60,10 +202,18 @@ const struct txc_node TXC_NAN_ERROR_NYI = { .impl.reason = TXC_NAN_REASON_ERROR_
                                             .children_amount = 0,
                                             .type = TXC_NAN,
                                             .read_only = true };
+const struct txc_node TXC_NAN_ERROR_NOT_REAL = { .impl.reason = TXC_NAN_REASON_ERROR_NOT_REAL,
+                                                 .children_amount = 0,
+                                                 .type = TXC_NAN,
+                                                 .read_only = true };
 const struct txc_node TXC_NAN_ERROR_OVERFLOW = { .impl.reason = TXC_NAN_REASON_ERROR_OVERFLOW,
                                                  .children_amount = 0,
                                                  .type = TXC_NAN,
                                                  .read_only = true };
+const struct txc_node TXC_NAN_ERROR_UNDEFINED = { .impl.reason = TXC_NAN_REASON_ERROR_UNDEFINED,
+                                                  .children_amount = 0,
+                                                  .type = TXC_NAN,
+                                                  .read_only = true };
 const struct txc_node TXC_NAN_ERROR_ZERO_DIVISION = { .impl.reason = TXC_NAN_REASON_ERROR_ZERO_DIVISION,
                                                       .children_amount = 0,
                                                       .type = TXC_NAN,
@@ -72,19 +222,23 @@ const struct txc_node TXC_NAN_UNSPECIFIED = { .impl.reason = TXC_NAN_REASON_UNSP
                                               .children_amount = 0,
                                               .type = TXC_NAN,
                                               .read_only = true };
+const struct txc_node TXC_NAN_ERROR_UNKNOWN_VARIABLE = { .impl.reason = TXC_NAN_REASON_ERROR_UNKNOWN_VARIABLE,
+                                                         .children_amount = 0,
+                                                         .type = TXC_NAN,
+                                                         .read_only = true };
+const struct txc_node TXC_NAN_ERROR_CYCLIC_DEFINITION = { .impl.reason = TXC_NAN_REASON_ERROR_CYCLIC_DEFINITION,
+                                                          .children_amount = 0,
+                                                          .type = TXC_NAN,
+                                                          .read_only = true };
 
 /* VALID */
 
-bool txc_node_test_valid(const struct txc_node *const node, const bool recursive)
+static bool test_valid_node(const struct txc_node *const node)
 {
     if (node == NULL) {
         TXC_ERROR_NULL("node");
         return false;
     }
-    for (size_t i = 0; recursive && i < node->children_amount; i++) {
-        if (!txc_node_test_valid(node->children[i], recursive))
-            return false;
-    }
     switch (node->type) {
     case TXC_INT:
         if (node->children_amount != 0) {
@@ -106,6 +260,37 @@ bool txc_node_test_valid(const struct txc_node *const node, const bool recursive
             return false;
         }
         return true;
+    case TXC_ROOT:
+        if (node->children_amount < 1 || node->children_amount > 2) {
+            TXC_ERROR_INVALID_CHILD_AMOUNT(node->type, node->children_amount);
+            return false;
+        }
+        return true;
+    case TXC_FACT: /* FALLTHROUGH */
+    case TXC_FLOOR:
+        if (node->children_amount != 1) {
+            TXC_ERROR_INVALID_CHILD_AMOUNT(node->type, node->children_amount);
+            return false;
+        }
+        return true;
+    case TXC_POW: /* FALLTHROUGH */
+    case TXC_BINOM: /* FALLTHROUGH */
+    case TXC_MOD:
+        if (node->children_amount != 2) {
+            TXC_ERROR_INVALID_CHILD_AMOUNT(node->type, node->children_amount);
+            return false;
+        }
+        return true;
+    case TXC_VARIABLE:
+        if (node->children_amount != 0) {
+            TXC_ERROR_INVALID_CHILD_AMOUNT(node->type, node->children_amount);
+            return false;
+        }
+        if (node->impl.name == NULL) {
+            TXC_ERROR_NULL("variable name");
+            return false;
+        }
+        return true;
     case TXC_NAN: /* FALLTHROUGH */
     case TXC_ADD: /* FALLTHROUGH */
     case TXC_MUL:
@@ -116,6 +301,47 @@ bool txc_node_test_valid(const struct txc_node *const node, const bool recursive
     }
 }
 
+bool txc_node_test_valid(const struct txc_node *const node, const bool recursive)
+{
+    if (!test_valid_node(node))
+        return false;
+    if (!recursive || node->children_amount == 0)
+        return true;
+    const struct txc_node **stack = NULL;
+    size_t used = 0;
+    size_t size = 0;
+    const struct txc_node *cur = node;
+    bool valid = true;
+    while (valid) {
+        for (size_t i = 0; valid && i < cur->children_amount; i++) {
+            const struct txc_node *const child = cur->children[i];
+            valid = test_valid_node(child);
+            if (!valid || child->children_amount == 0)
+                continue;
+            if (used == size) {
+                const struct txc_node **const tmp = txc_grow(stack, &size, sizeof *stack, "validation stack");
+                if (tmp == NULL) {
+                    valid = false;
+                    break;
+                }
+                stack = tmp;
+            }
+            stack[used++] = child;
+        }
+        if (used == 0)
+            break;
+        cur = stack[--used];
+    }
+    free(stack);
+    return valid;
+}
+
+bool txc_node_is_nan(const struct txc_node *const node)
+{
+    assert(txc_node_test_valid(node, false));
+    return node->type == TXC_NAN;
+}
+
 /* MEMORY */
 
 txc_int *txc_node_to_int(struct txc_node *const node)
@@ -124,45 +350,219 @@ txc_int *txc_node_to_int(struct txc_node *const node)
     return node->type == TXC_INT ? node->impl.integer : NULL;
 }
 
-static struct txc_node *copy(const struct txc_node *const from)
+enum txc_node_type txc_node_get_type(const struct txc_node *const node)
+{
+    assert(txc_node_test_valid(node, false));
+    return node->type;
+}
+
+size_t txc_node_children_amount(const struct txc_node *const node)
+{
+    assert(txc_node_test_valid(node, false));
+    return node->children_amount;
+}
+
+const struct txc_node *txc_node_child(const struct txc_node *const node, const size_t i)
+{
+    assert(txc_node_test_valid(node, false));
+    assert(i < node->children_amount);
+    return node->children[i];
+}
+
+const char *txc_node_nan_reason(const struct txc_node *const node)
+{
+    assert(txc_node_test_valid(node, false));
+    return node->type == TXC_NAN ? node->impl.reason : NULL;
+}
+
+const char *txc_node_variable_name(const struct txc_node *const node)
+{
+    assert(txc_node_test_valid(node, false));
+    return node->type == TXC_VARIABLE ? node->impl.name : NULL;
+}
+
+static void *arena_alloc(const size_t bytes)
+{
+    const size_t units = (bytes + sizeof(union arena_align) - 1) / sizeof(union arena_align);
+    if (arena == NULL || arena->size - arena->used < units) {
+        size_t size = arena == NULL ? TXC_NODE_ARENA_CHUNK / sizeof(union arena_align) : arena->size * 2;
+        while (size < units && size <= (SIZE_MAX - sizeof(struct arena_chunk)) / sizeof(union arena_align) / 2)
+            size *= 2;
+        if (size < units) {
+            TXC_ERROR_OVERFLOW("node arena");
+            return NULL;
+        }
+        struct arena_chunk *const chunk = malloc(sizeof *chunk + sizeof *chunk->data * size);
+        if (chunk == NULL) {
+            TXC_ERROR_ALLOC(sizeof *chunk + sizeof *chunk->data * size, "node arena");
+            return NULL;
+        }
+        chunk->older = arena;
+        chunk->size = size;
+        chunk->used = 0;
+        arena = chunk;
+    }
+    void *const ptr = arena->data + arena->used;
+    arena->used += units;
+    return ptr;
+}
+
+static struct txc_node *node_alloc(const size_t children_amount, const char *const purpose)
+{
+    struct txc_node *node;
+    const size_t bytes = sizeof *node + sizeof *node->children * children_amount;
+    node = arena_active ? arena_alloc(bytes) : malloc(bytes);
+    if (node == NULL) {
+        TXC_ERROR_ALLOC(bytes, purpose);
+        return NULL;
+    }
+    node->children_amount = children_amount;
+    node->read_only = false;
+    node->in_arena = arena_active;
+    node->repeated = false;
+    node->hashed = false;
+    node->pure = false;
+    node->refers = false;
+    return node;
+}
+
+// Frees node on failure. Arena nodes shrink in place, their space is reclaimed on release anyway.
+static struct txc_node *node_resize(struct txc_node *const node, const size_t children_amount, const char *const purpose)
+{
+    const size_t bytes = sizeof *node + sizeof *node->children * children_amount;
+    struct txc_node *resized;
+    if (!node->in_arena) {
+        resized = realloc(node, bytes);
+    } else if (children_amount <= node->children_amount) {
+        resized = node;
+    } else {
+        resized = arena_alloc(bytes);
+        if (resized != NULL)
+            memcpy(resized, node, sizeof *node + sizeof *node->children * node->children_amount);
+    }
+    if (resized == NULL) {
+        TXC_ERROR_ALLOC(bytes, purpose);
+        txc_node_free(node);
+        return NULL;
+    }
+    return resized;
+}
+
+// Releases the memory of a node whose children and impl are owned elsewhere.
+static void node_dealloc(struct txc_node *const node)
+{
+    if (!node->in_arena)
+        free(node);
+}
+
+static char *node_strdup(const char *const str)
+{
+    if (!arena_active)
+        return txc_strdup(str);
+    char *const dup = arena_alloc(strlen(str) + 1);
+    if (dup != NULL)
+        strcpy(dup, str);
+    return dup;
+}
+
+// The integer of an INT node in the arena is freed with the arena, so the node itself never has to be visited.
+static bool arena_track(struct txc_node *const node)
+{
+    if (!node->in_arena)
+        return true;
+    if (arena_ints_used == arena_ints_size) {
+        const size_t size = arena_ints_size == 0 ? 64 : arena_ints_size * 2;
+        struct txc_node **const ints = realloc(arena_ints, sizeof *ints * size);
+        if (ints == NULL) {
+            TXC_ERROR_ALLOC(sizeof *ints * size, "arena integers");
+            return false;
+        }
+        arena_ints = ints;
+        arena_ints_size = size;
+    }
+    arena_ints[arena_ints_used++] = node;
+    return true;
+}
+
+void txc_node_arena_init(void)
+{
+    txc_node_arena_free();
+    arena_active = true;
+}
+
+void txc_node_arena_release(void)
+{
+    for (size_t i = 0; i < arena_ints_used; i++)
+        txc_int_free(arena_ints[i]->impl.integer);
+    arena_ints_used = 0;
+    if (arena == NULL)
+        return;
+    while (arena->older != NULL) {
+        struct arena_chunk *const older = arena->older;
+        arena->older = older->older;
+        free(older);
+    }
+    arena->used = 0;
+}
+
+void txc_node_arena_free(void)
+{
+    txc_node_arena_release();
+    free(arena);
+    free(arena_ints);
+    arena = NULL;
+    arena_ints = NULL;
+    arena_ints_size = 0;
+    arena_active = false;
+}
+
+// A copy of from without its children, whose slots are NULL.
+static struct txc_node *shell(const struct txc_node *const from)
 {
-    assert(txc_node_test_valid(from, true));
     if (from->read_only)
         return (struct txc_node *)from;
-    struct txc_node *cpy = malloc(sizeof *cpy + sizeof *cpy->children * from->children_amount);
-    if (cpy == NULL) {
-        TXC_ERROR_ALLOC(sizeof *cpy + sizeof *cpy->children * from->children_amount, "copy");
+    struct txc_node *cpy = node_alloc(from->children_amount, "copy");
+    if (cpy == NULL)
         return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
-    }
-    cpy->children_amount = from->children_amount;
     cpy->type = from->type;
-    cpy->read_only = false;
     for (size_t i = 0; i < cpy->children_amount; i++)
-        cpy->children[i] = copy(from->children[i]);
+        cpy->children[i] = NULL;
     switch (cpy->type) {
     case TXC_NAN:
-        cpy->impl.reason = txc_strdup(from->impl.reason);
+        cpy->impl.reason = node_strdup(from->impl.reason);
         if (cpy->impl.reason == NULL) {
             TXC_ERROR_ALLOC(strlen(from->impl.reason) + 1, "copy reason");
-            if (cpy->children_amount > 0) {
-                for (size_t i = 0; i < cpy->children_amount; i++)
-                    txc_node_free(cpy->children[i]);
-            }
-            free(cpy);
+            node_dealloc(cpy);
+            return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+        }
+        break;
+    case TXC_VARIABLE:
+        cpy->impl.name = node_strdup(from->impl.name);
+        if (cpy->impl.name == NULL) {
+            TXC_ERROR_ALLOC(strlen(from->impl.name) + 1, "copy name");
+            node_dealloc(cpy);
             return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
         }
         break;
     case TXC_INT:
         cpy->impl.integer = txc_int_copy(from->impl.integer);
-        if (cpy->impl.integer == NULL) {
-            free(cpy);
+        if (cpy->impl.integer == NULL || !arena_track(cpy)) {
+            txc_int_free(cpy->impl.integer);
+            node_dealloc(cpy);
             return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
         }
         break;
     case TXC_NEG: /* FALLTHROUGH */
     case TXC_ADD: /* FALLTHROUGH */
     case TXC_MUL: /* FALLTHROUGH */
-    case TXC_FRAC:
+    case TXC_FRAC: /* FALLTHROUGH */
+    case TXC_POW: /* FALLTHROUGH */
+    case TXC_ROOT: /* FALLTHROUGH */
+    case TXC_FACT: /* FALLTHROUGH */
+    case TXC_BINOM: /* FALLTHROUGH */
+    case TXC_MOD: /* FALLTHROUGH */
+    case TXC_FLOOR:
+        cpy->impl.integer = NULL;
         break;
     default:
         TXC_ERROR_INVALID_NODE_TYPE(cpy->type);
@@ -171,21 +571,75 @@ static struct txc_node *copy(const struct txc_node *const from)
     return cpy;
 }
 
+static struct txc_node *copy(const struct txc_node *const from);
+
+// Children which could not be copied are replaced by TXC_NAN_ERROR_ALLOC.
+// Unless value is NULL, VARIABLEs are replaced by a copy of their value, which is complete already.
+static struct txc_node *copy_substituted(const struct txc_node *const from, const struct txc_node *(*const value)(const char *const name))
+{
+    assert(txc_node_test_valid(from, true));
+    if (value != NULL && from->type == TXC_VARIABLE)
+        return copy(value(from->impl.name));
+    struct txc_node *const root = shell(from);
+    if (root->read_only || root->children_amount == 0)
+        return root;
+    // pairs of an original and its copy whose children are still to be copied
+    struct copy_pair {
+        const struct txc_node *from;
+        struct txc_node *to;
+    } *stack = NULL;
+    size_t used = 0;
+    size_t size = 0;
+    struct copy_pair cur = { from, root };
+    while (true) {
+        for (size_t i = 0; i < cur.to->children_amount; i++) {
+            const struct txc_node *const child = cur.from->children[i];
+            const bool substituted = value != NULL && child->type == TXC_VARIABLE;
+            struct txc_node *cpy = substituted ? copy(value(child->impl.name)) : shell(child);
+            if (!substituted && !cpy->read_only && cpy->children_amount > 0) {
+                if (used == size) {
+                    struct copy_pair *const tmp = txc_grow(stack, &size, sizeof *stack, "copy stack");
+                    if (tmp == NULL) {
+                        txc_node_free(cpy);
+                        cpy = (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+                    } else {
+                        stack = tmp;
+                    }
+                }
+                if (!cpy->read_only)
+                    stack[used++] = (struct copy_pair){ child, cpy };
+            }
+            cur.to->children[i] = cpy;
+        }
+        if (used == 0)
+            break;
+        cur = stack[--used];
+    }
+    free(stack);
+    return root;
+}
+
+static struct txc_node *copy(const struct txc_node *const from)
+{
+    return copy_substituted(from, NULL);
+}
+
 struct txc_node *txc_node_create(struct txc_node *const *const children, const union impl impl, const size_t children_amount, const enum txc_node_type type)
 {
+    // the children were validated when they were created
     for (size_t i = 0; i < children_amount; i++)
-        assert(txc_node_test_valid(children[i], true));
-    struct txc_node *const node = malloc(sizeof *node + sizeof *node->children * children_amount);
-    if (node == NULL) {
-        TXC_ERROR_ALLOC(sizeof *node + sizeof *node->children * children_amount, "node");
+        assert(txc_node_test_valid(children[i], false));
+    struct txc_node *const node = node_alloc(children_amount, "node");
+    if (node == NULL)
         return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
-    }
     node->impl = impl;
-    node->children_amount = children_amount;
     node->type = type;
-    node->read_only = false;
     for (size_t i = 0; i < children_amount; i++)
         node->children[i] = children[i];
+    if (type == TXC_INT && !arena_track(node)) {
+        node_dealloc(node);
+        return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+    }
     return node;
 }
 
@@ -194,47 +648,58 @@ struct txc_node *txc_node_create_nan(const char *const reason)
     // TODO create NULL NAN?
     if (reason == NULL)
         return (struct txc_node *)&TXC_NAN_UNSPECIFIED;
-    struct txc_node *nan = malloc(sizeof *nan);
-    if (nan == NULL) {
-        TXC_ERROR_ALLOC(sizeof *nan, "nan");
+    struct txc_node *nan = node_alloc(0, "nan");
+    if (nan == NULL)
         return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
-    }
-    nan->impl.reason = txc_strdup(reason);
+    nan->impl.reason = node_strdup(reason);
     if (nan->impl.reason == NULL) {
         TXC_ERROR_ALLOC(strlen(reason) + 1, "nan reason");
-        free(nan);
+        node_dealloc(nan);
         return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
     }
-    nan->children_amount = 0;
     nan->type = TXC_NAN;
-    nan->read_only = false;
     return nan;
 }
 
+struct txc_node *txc_node_create_variable(const char *const name)
+{
+    assert(name != NULL);
+    struct txc_node *const variable = node_alloc(0, "variable");
+    if (variable == NULL)
+        return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+    variable->impl.name = node_strdup(name);
+    if (variable->impl.name == NULL) {
+        TXC_ERROR_ALLOC(strlen(name) + 1, "variable name");
+        node_dealloc(variable);
+        return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+    }
+    variable->type = TXC_VARIABLE;
+    return variable;
+}
+
+// Takes ownership of the children, so building a tree never copies a subtree.
 static struct txc_node *init_op(const enum txc_node_type type, struct txc_node *const *const children, const size_t children_amount)
 {
-    for (size_t i = 0; i < children_amount; i++)
-        assert(txc_node_test_valid(children[i], true));
-    struct txc_node *const node = malloc(sizeof *node + sizeof *node->children * children_amount);
+    struct txc_node *const node = node_alloc(children_amount, "operation node");
     if (node == NULL) {
-        TXC_ERROR_ALLOC(sizeof *node, "operation node");
+        for (size_t i = 0; i < children_amount; i++)
+            txc_node_free(children[i]);
         return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
     }
-    node->children_amount = children_amount;
     node->type = type;
-    node->read_only = false;
     for (size_t i = 0; i < children_amount; i++)
-        node->children[i] = copy(children[i]);
+        node->children[i] = children[i];
     return node;
 }
 
 struct txc_node *txc_node_create_un_op(const enum txc_node_type type, struct txc_node *const operand)
 {
-    if (type != TXC_NEG && type != TXC_FRAC) {
+    if (type != TXC_NEG && type != TXC_FRAC && type != TXC_ROOT && type != TXC_FACT && type != TXC_FLOOR) {
         TXC_ERROR_INVALID_NODE_TYPE(type);
+        txc_node_free(operand);
         return (struct txc_node *)&TXC_NAN_ERROR_INVALID_NODE_TYPE;
     }
-    assert(txc_node_test_valid(operand, true));
+    assert(txc_node_test_valid(operand, false));
     const size_t arity = 1;
     struct txc_node *const children[] = { operand };
     return init_op(type, children, arity);
@@ -242,27 +707,48 @@ struct txc_node *txc_node_create_un_op(const enum txc_node_type type, struct txc
 
 struct txc_node *txc_node_create_bin_op(const enum txc_node_type type, struct txc_node *const operand_1, struct txc_node *const operand_2)
 {
-    if (type != TXC_ADD && type != TXC_MUL && type != TXC_FRAC) {
+    if (type != TXC_ADD && type != TXC_MUL && type != TXC_FRAC && type != TXC_POW && type != TXC_ROOT && type != TXC_BINOM && type != TXC_MOD) {
         TXC_ERROR_INVALID_NODE_TYPE(type);
+        txc_node_free(operand_1);
+        txc_node_free(operand_2);
         return (struct txc_node *)&TXC_NAN_ERROR_INVALID_NODE_TYPE;
     }
-    assert(txc_node_test_valid(operand_1, true));
-    assert(txc_node_test_valid(operand_2, true));
+    assert(txc_node_test_valid(operand_1, false));
+    assert(txc_node_test_valid(operand_2, false));
     const size_t arity = 2;
     struct txc_node *const children[] = { operand_1, operand_2 };
     return init_op(type, children, arity);
 }
 
-void txc_node_free(const struct txc_node *const node)
+struct txc_node *txc_node_append(const enum txc_node_type type, struct txc_node *chain, struct txc_node *const operand)
+{
+    if (chain->type != type || chain->read_only)
+        return txc_node_create_bin_op(type, chain, operand);
+    assert(type == TXC_ADD || type == TXC_MUL);
+    assert(txc_node_test_valid(operand, false));
+    const size_t amount = chain->children_amount;
+    // the children are allocated in powers of two, so they are full exactly when their amount is one
+    if (amount >= 2 && (amount & (amount - 1)) == 0) {
+        if (amount > (SIZE_MAX - sizeof *chain) / sizeof *chain->children / 2) {
+            TXC_ERROR_OVERFLOW("operation chain");
+            txc_node_free(chain);
+            txc_node_free(operand);
+            return (struct txc_node *)&TXC_NAN_ERROR_OVERFLOW;
+        }
+        chain = node_resize(chain, amount * 2, "operation chain");
+        if (chain == NULL) {
+            txc_node_free(operand);
+            return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+        }
+    }
+    chain->children[amount] = operand;
+    chain->children_amount = amount + 1;
+    return chain;
+}
+
+// Releases the impl of a node and the node itself, but not its children.
+static void free_one(struct txc_node *const node)
 {
-    if (node == NULL)
-        return;
-    // TODO change back to true?
-    assert(txc_node_test_valid(node, false));
-    if (node->read_only)
-        return;
-    for (size_t i = 0; i < node->children_amount; i++)
-        txc_node_free(node->children[i]);
     switch (node->type) {
     case TXC_NAN:
         free(node->impl.reason);
@@ -270,39 +756,1402 @@ void txc_node_free(const struct txc_node *const node)
     case TXC_INT:
         txc_int_free(node->impl.integer);
         break;
+    case TXC_VARIABLE:
+        free(node->impl.name);
+        break;
     case TXC_NEG: /* FALLTHROUGH */
     case TXC_ADD: /* FALLTHROUGH */
     case TXC_MUL: /* FALLTHROUGH */
-    case TXC_FRAC:
+    case TXC_FRAC: /* FALLTHROUGH */
+    case TXC_POW: /* FALLTHROUGH */
+    case TXC_ROOT: /* FALLTHROUGH */
+    case TXC_FACT: /* FALLTHROUGH */
+    case TXC_BINOM: /* FALLTHROUGH */
+    case TXC_MOD: /* FALLTHROUGH */
+    case TXC_FLOOR:
         break;
     default:
         TXC_ERROR_INVALID_NODE_TYPE(node->type);
         break;
     }
-    free((struct txc_node *)node);
+    free(node);
+}
+
+// Leaves are freed right away, operations below node wait on an explicit stack.
+// Subtrees are leaked if the stack can not grow.
+void txc_node_free(const struct txc_node *const node)
+{
+    if (node == NULL)
+        return;
+    // TODO change back to true?
+    assert(txc_node_test_valid(node, false));
+    if (node->read_only || node->in_arena)
+        return;
+    struct txc_node **stack = NULL;
+    size_t used = 0;
+    size_t size = 0;
+    struct txc_node *cur = (struct txc_node *)node;
+    while (true) {
+        for (size_t i = 0; i < cur->children_amount; i++) {
+            struct txc_node *const child = cur->children[i];
+            if (child == NULL || child->read_only || child->in_arena)
+                continue;
+            assert(txc_node_test_valid(child, false));
+            if (child->children_amount == 0) {
+                free_one(child);
+                continue;
+            }
+            if (used == size) {
+                struct txc_node **const tmp = txc_grow(stack, &size, sizeof *stack, "free stack");
+                if (tmp == NULL)
+                    continue;
+                stack = tmp;
+            }
+            stack[used++] = child;
+        }
+        free_one(cur);
+        if (used == 0)
+            break;
+        cur = stack[--used];
+    }
+    free(stack);
+}
+
+struct txc_node *txc_node_copy(const struct txc_node *const node)
+{
+    const bool active = arena_active;
+    arena_active = false;
+    struct txc_node *const cpy = copy(node);
+    arena_active = active;
+    return cpy;
+}
+
+struct txc_node *txc_node_substitute(const struct txc_node *const node, const struct txc_node *(*const value)(const char *const name))
+{
+    assert(value != NULL);
+    return copy_substituted(node, value);
+}
+
+/* NODE */
+
+// Integer and fraction bases with integer exponents are evaluated, everything else stays symbolic.
+static struct txc_node *simplify_pow(struct txc_node *const pow)
+{
+    const struct txc_node *base = pow->children[0];
+    const struct txc_node *const exponent = pow->children[1];
+    if (exponent->type != TXC_INT)
+        return pow;
+    bool neg = false;
+    if (base->type == TXC_NEG) {
+        neg = true;
+        base = base->children[0];
+    }
+    // NULL stands for 1
+    const txc_int *num = NULL;
+    const txc_int *den = NULL;
+    if (base->type == TXC_INT) {
+        num = base->impl.integer;
+    } else if (base->type == TXC_FRAC && base->children[0]->type == TXC_INT && (base->children_amount == 1 || base->children[1]->type == TXC_INT)) {
+        den = base->children[0]->impl.integer;
+        if (base->children_amount == 2)
+            num = base->children[1]->impl.integer;
+    } else {
+        return pow;
+    }
+    const bool reciprocal = txc_int_is_neg(exponent->impl.integer);
+    if (num != NULL && txc_int_is_zero(num) && reciprocal) {
+        txc_node_free(pow);
+        return (struct txc_node *)&TXC_NAN_ERROR_ZERO_DIVISION;
+    }
+    size_t power;
+    if (!txc_int_abs_to_size(exponent->impl.integer, &power)) {
+        // only the sign of 0 and 1 still depends on such exponents
+        if (den != NULL || num == NULL || !(txc_int_is_zero(num) || txc_int_is_pos_one(num) || txc_int_is_neg_one(num))) {
+            TXC_ERROR_OVERFLOW("exponent");
+            txc_node_free(pow);
+            return (struct txc_node *)&TXC_NAN_ERROR_OVERFLOW;
+        }
+        power = txc_int_is_odd(exponent->impl.integer) ? 1 : 2;
+    }
+    const bool neg_result = neg != (num != NULL && txc_int_is_neg(num)) && power % 2 == 1;
+    txc_int *num_pow = num == NULL ? txc_int_create_one() : txc_int_pow(num, power);
+    txc_int *den_pow = den == NULL ? txc_int_create_one() : txc_int_pow(den, power);
+    txc_node_free(pow);
+    if (num_pow != NULL && txc_int_is_neg(num_pow))
+        num_pow = txc_int_neg(num_pow);
+    if (num_pow == NULL || den_pow == NULL) {
+        txc_int_free(num_pow);
+        txc_int_free(den_pow);
+        return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+    }
+    if (reciprocal) {
+        txc_int *const tmp = num_pow;
+        num_pow = den_pow;
+        den_pow = tmp;
+    }
+    if (txc_int_is_pos_one(den_pow)) {
+        txc_int_free(den_pow);
+        return txc_int_to_node(neg_result ? txc_int_neg(num_pow) : num_pow);
+    }
+    // powers of coprime numbers stay coprime, so the fraction is already reduced
+    union impl impl;
+    impl.integer = NULL;
+    struct txc_node *children[] = { txc_int_to_node(den_pow), NULL };
+    size_t children_amount = 1;
+    if (txc_int_is_pos_one(num_pow)) {
+        txc_int_free(num_pow);
+    } else {
+        children[1] = txc_int_to_node(num_pow);
+        children_amount = 2;
+    }
+    if (children[0]->type == TXC_NAN || (children[1] != NULL && children[1]->type == TXC_NAN)) {
+        txc_node_free(children[0]);
+        txc_node_free(children[1]);
+        return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+    }
+    struct txc_node *result = txc_node_create(children, impl, children_amount, TXC_FRAC);
+    if (result->type == TXC_NAN) {
+        txc_node_free(children[0]);
+        txc_node_free(children[1]);
+        return result;
+    }
+    if (!neg_result)
+        return result;
+    struct txc_node *const neg_node = txc_node_create(&result, impl, 1, TXC_NEG);
+    if (neg_node->type == TXC_NAN)
+        txc_node_free(result);
+    return neg_node;
+}
+
+// Integer radicands with natural degrees are evaluated, roots that are not exact keep the radicand without its perfect powers.
+static struct txc_node *simplify_root(struct txc_node *const root)
+{
+    const struct txc_node *const radicand = root->children[0];
+    if (radicand->type != TXC_INT)
+        return root;
+    size_t degree = 2;
+    if (root->children_amount == 2) {
+        const struct txc_node *const degree_node = root->children[1];
+        if (degree_node->type != TXC_INT || txc_int_is_neg(degree_node->impl.integer))
+            return root;
+        if (txc_int_is_zero(degree_node->impl.integer)) {
+            txc_node_free(root);
+            return (struct txc_node *)&TXC_NAN_ERROR_ZERO_DIVISION;
+        }
+        // the floor root of anything fitting into memory is 1 for such degrees, only the parity matters
+        if (!txc_int_abs_to_size(degree_node->impl.integer, &degree))
+            degree = txc_int_is_odd(degree_node->impl.integer) ? SIZE_MAX : SIZE_MAX - 1;
+    }
+    const bool neg = txc_int_is_neg(radicand->impl.integer);
+    if (neg && degree % 2 == 0) {
+        txc_node_free(root);
+        return (struct txc_node *)&TXC_NAN_ERROR_NOT_REAL;
+    }
+    bool exact;
+    txc_int *const floor_root = txc_int_root(radicand->impl.integer, degree, &exact);
+    if (floor_root == NULL) {
+        txc_node_free(root);
+        return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+    }
+    if (exact) {
+        txc_node_free(root);
+        return txc_int_to_node(neg ? txc_int_neg(floor_root) : floor_root);
+    }
+    txc_int_free(floor_root);
+    txc_int *outside;
+    txc_int *inside;
+    if (!txc_int_root_split(radicand->impl.integer, degree, &outside, &inside)) {
+        txc_node_free(root);
+        return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+    }
+    struct txc_node *const inside_node = txc_int_to_node(inside);
+    if (inside_node->type == TXC_NAN) {
+        txc_int_free(outside);
+        txc_node_free(root);
+        return inside_node;
+    }
+    txc_node_free(root->children[0]);
+    root->children[0] = inside_node;
+    union impl impl;
+    impl.integer = NULL;
+    if (txc_int_is_pos_one(outside)) {
+        txc_int_free(outside);
+        if (!neg)
+            return root;
+        struct txc_node *const neg_node = txc_node_create(&root, impl, 1, TXC_NEG);
+        if (neg_node->type == TXC_NAN)
+            txc_node_free(root);
+        return neg_node;
+    }
+    struct txc_node *const children[] = { txc_int_to_node(neg ? txc_int_neg(outside) : outside), root };
+    if (children[0]->type == TXC_NAN) {
+        txc_node_free(root);
+        return children[0];
+    }
+    struct txc_node *const product = txc_node_create(children, impl, 2, TXC_MUL);
+    if (product->type == TXC_NAN) {
+        txc_node_free(children[0]);
+        txc_node_free(root);
+    }
+    return product;
+}
+
+// Natural integers are evaluated, the factorial of negative integers hits a pole of the gamma function.
+static struct txc_node *simplify_fact(struct txc_node *const fact)
+{
+    const struct txc_node *const operand = fact->children[0];
+    if (operand->type != TXC_INT)
+        return fact;
+    if (txc_int_is_neg(operand->impl.integer)) {
+        txc_node_free(fact);
+        return (struct txc_node *)&TXC_NAN_ERROR_UNDEFINED;
+    }
+    size_t n;
+    if (!txc_int_abs_to_size(operand->impl.integer, &n)) {
+        TXC_ERROR_OVERFLOW("factorial");
+        txc_node_free(fact);
+        return (struct txc_node *)&TXC_NAN_ERROR_OVERFLOW;
+    }
+    txc_node_free(fact);
+    txc_int *const result = txc_int_factorial(n);
+    if (result == NULL)
+        return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+    return txc_int_to_node(result);
+}
+
+// Integer arguments are evaluated, negative n by binom{n}{k} = (-1)^k * binom{k - n - 1}{k} and negative k are 0.
+static struct txc_node *simplify_binom(struct txc_node *const binom)
+{
+    const struct txc_node *const n_node = binom->children[0];
+    const struct txc_node *const k_node = binom->children[1];
+    if (n_node->type != TXC_INT || k_node->type != TXC_INT)
+        return binom;
+    const bool neg_n = txc_int_is_neg(n_node->impl.integer);
+    size_t n;
+    size_t k;
+    const bool n_fits = txc_int_abs_to_size(n_node->impl.integer, &n);
+    const bool k_fits = txc_int_abs_to_size(k_node->impl.integer, &k);
+    if (txc_int_is_neg(k_node->impl.integer) || (!neg_n && n_fits && (!k_fits || k > n))) {
+        txc_node_free(binom);
+        txc_int *const zero = txc_int_create_zero();
+        if (zero == NULL)
+            return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+        return txc_int_to_node(zero);
+    }
+    if (!n_fits || !k_fits || (neg_n && k - 1 > SIZE_MAX - n)) {
+        TXC_ERROR_OVERFLOW("binomial coefficient");
+        txc_node_free(binom);
+        return (struct txc_node *)&TXC_NAN_ERROR_OVERFLOW;
+    }
+    txc_node_free(binom);
+    const bool neg = neg_n && k % 2 == 1;
+    if (neg_n)
+        n = n + k - 1;
+    txc_int *const result = txc_int_binomial(n, k);
+    if (result == NULL)
+        return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+    return txc_int_to_node(neg ? txc_int_neg(result) : result);
+}
+
+// A node of the dividend being evaluated by mod_eval, sums and products accumulate the residues of their operands.
+struct mod_frame {
+    const struct txc_node *node;
+    txc_int *acc;
+    struct txc_node *exponent;
+    size_t next;
+};
+
+// Only sums, products, negations and powers are evaluated modulo the divisor, anything else is simplified on its own.
+static bool mod_arith(const enum txc_node_type type)
+{
+    return type == TXC_NEG || type == TXC_ADD || type == TXC_MUL || type == TXC_POW;
+}
+
+// Evaluates node modulo the context and reduces after every operation, so no intermediate outgrows the modulus.
+// Returns an INT node with the residue, a NAN or NULL if the node has no integer value.
+static struct txc_node *mod_eval(const struct txc_node *const node, const txc_int_mod_ctx *const ctx)
+{
+    struct mod_frame *stack = NULL;
+    size_t used = 0;
+    size_t size = 0;
+    // residue of the node finished last, for the node below it on the stack
+    txc_int *residue = NULL;
+    struct txc_node *failure = NULL;
+    const struct txc_node *push = node;
+    while (true) {
+        if (push != NULL) {
+            if (used == size) {
+                struct mod_frame *const tmp = txc_grow(stack, &size, sizeof *stack, "modular evaluation stack");
+                if (tmp == NULL) {
+                    failure = (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+                    break;
+                }
+                stack = tmp;
+            }
+            stack[used++] = (struct mod_frame){ push, NULL, NULL, 0 };
+            push = NULL;
+        }
+        struct mod_frame *const top = &stack[used - 1];
+        const struct txc_node *const cur = top->node;
+        txc_int *done = NULL;
+        bool failed = false;
+        switch (cur->type) {
+        case TXC_INT:
+            done = txc_int_mod_reduce(ctx, cur->impl.integer);
+            break;
+        case TXC_NEG:
+            if (residue == NULL) {
+                push = cur->children[0];
+                break;
+            }
+            txc_int *const negated = txc_int_neg(residue);
+            residue = NULL;
+            done = negated == NULL ? NULL : txc_int_mod_reduce(ctx, negated);
+            txc_int_free(negated);
+            break;
+        case TXC_ADD: /* FALLTHROUGH */
+        case TXC_MUL:
+            if (residue == NULL) {
+                txc_int *const one = txc_int_create_one();
+                top->acc = cur->type == TXC_ADD ? txc_int_create_zero() : txc_int_mod_reduce(ctx, one);
+                txc_int_free(one);
+            } else {
+                txc_int *const next = cur->type == TXC_ADD ? txc_int_mod_add(ctx, top->acc, residue) : txc_int_mod_mul(ctx, top->acc, residue);
+                txc_int_free(residue);
+                txc_int_free(top->acc);
+                residue = NULL;
+                top->acc = next;
+            }
+            if (top->acc != NULL && top->next < cur->children_amount) {
+                push = cur->children[top->next++];
+                break;
+            }
+            done = top->acc;
+            top->acc = NULL;
+            break;
+        case TXC_POW:
+            if (residue == NULL) {
+                // the exponent stays a plain integer, negative ones would need modular inverses
+                struct txc_node *const exponent = txc_node_simplify(cur->children[1]);
+                if (exponent->type == TXC_NAN) {
+                    failure = exponent;
+                    failed = true;
+                    break;
+                }
+                if (exponent->type != TXC_INT || txc_int_is_neg(exponent->impl.integer)) {
+                    txc_node_free(exponent);
+                    failed = true;
+                    break;
+                }
+                top->exponent = exponent;
+                push = cur->children[0];
+                break;
+            }
+            done = txc_int_mod_pow(ctx, residue, top->exponent->impl.integer);
+            txc_int_free(residue);
+            residue = NULL;
+            txc_node_free(top->exponent);
+            top->exponent = NULL;
+            break;
+        default: {
+            struct txc_node *const simple = txc_node_simplify(cur);
+            if (simple->type != TXC_INT) {
+                if (simple->type == TXC_NAN)
+                    failure = simple;
+                else
+                    txc_node_free(simple);
+                failed = true;
+                break;
+            }
+            done = txc_int_mod_reduce(ctx, simple->impl.integer);
+            txc_node_free(simple);
+            break;
+        }
+        }
+        if (failed)
+            break;
+        if (push != NULL)
+            continue;
+        if (done == NULL) {
+            failure = (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+            break;
+        }
+        used--;
+        if (used == 0) {
+            free(stack);
+            return txc_int_to_node(done);
+        }
+        residue = done;
+    }
+    txc_int_free(residue);
+    for (size_t i = 0; i < used; i++) {
+        txc_int_free(stack[i].acc);
+        txc_node_free(stack[i].exponent);
+    }
+    free(stack);
+    return failure;
+}
+
+// Repeated divisions by the same integer within a line share its precomputed reciprocal, the oldest entry is replaced first.
+static const txc_int_divisor *cached_divisor(const txc_int *const value)
+{
+    for (size_t i = 0; i < TXC_NODE_DIVISOR_CACHE; i++)
+        if (divisor_cache[i] != NULL && txc_int_cmp(txc_int_divisor_value(divisor_cache[i]), value) == 0)
+            return divisor_cache[i];
+    txc_int_divisor *const divisor = txc_int_divisor_create(value);
+    if (divisor == NULL)
+        return NULL;
+    txc_int_divisor_free(divisor_cache[divisor_cache_next]);
+    divisor_cache[divisor_cache_next] = divisor;
+    divisor_cache_next = (divisor_cache_next + 1) % TXC_NODE_DIVISOR_CACHE;
+    return divisor;
+}
+
+static void divisor_cache_clear(void)
+{
+    for (size_t i = 0; i < TXC_NODE_DIVISOR_CACHE; i++) {
+        txc_int_divisor_free(divisor_cache[i]);
+        divisor_cache[i] = NULL;
+    }
+    divisor_cache_next = 0;
+}
+
+// Integer moduli evaluate the dividend modulo them, instead of simplifying it on its own first.
+static struct txc_node *simplify_mod(const struct txc_node *const node)
+{
+    struct txc_node *const modulus = txc_node_simplify(node->children[1]);
+    if (modulus->type == TXC_NAN)
+        return modulus;
+    if (modulus->type == TXC_INT) {
+        if (txc_int_is_zero(modulus->impl.integer)) {
+            txc_node_free(modulus);
+            return (struct txc_node *)&TXC_NAN_ERROR_ZERO_DIVISION;
+        }
+        // a lone integer is cheaper to reduce by a single division than by setting up a context
+        if (node->children[0]->type == TXC_INT) {
+            txc_int *remainder;
+            if (!txc_int_divisor_divmod(node->children[0]->impl.integer, cached_divisor(modulus->impl.integer), TXC_INT_DIV_EUCLID, NULL, &remainder))
+                remainder = NULL;
+            txc_node_free(modulus);
+            if (remainder == NULL)
+                return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+            return txc_int_to_node(remainder);
+        }
+        if (mod_arith(node->children[0]->type)) {
+            txc_int_mod_ctx *const ctx = txc_int_mod_ctx_create(modulus->impl.integer);
+            if (ctx == NULL) {
+                txc_node_free(modulus);
+                return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+            }
+            struct txc_node *const residue = mod_eval(node->children[0], ctx);
+            txc_int_mod_ctx_free(ctx);
+            if (residue != NULL) {
+                txc_node_free(modulus);
+                return residue;
+            }
+        }
+    }
+    // other dividends would be simplified on their own by mod_eval as well, so that is only done once
+    struct txc_node *const dividend = txc_node_simplify(node->children[0]);
+    if (dividend->type == TXC_NAN) {
+        txc_node_free(modulus);
+        return dividend;
+    }
+    if (modulus->type == TXC_INT && dividend->type == TXC_INT) {
+        txc_int *remainder;
+        if (!txc_int_divisor_divmod(dividend->impl.integer, cached_divisor(modulus->impl.integer), TXC_INT_DIV_EUCLID, NULL, &remainder))
+            remainder = NULL;
+        txc_node_free(dividend);
+        txc_node_free(modulus);
+        if (remainder == NULL)
+            return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+        return txc_int_to_node(remainder);
+    }
+    union impl impl;
+    impl.integer = NULL;
+    struct txc_node *const children[] = { dividend, modulus };
+    struct txc_node *const mod = txc_node_create(children, impl, 2, TXC_MOD);
+    if (mod->type == TXC_NAN) {
+        txc_node_free(dividend);
+        txc_node_free(modulus);
+    }
+    return mod;
+}
+
+static struct txc_node *simplify_op(struct txc_node *cpy);
+
+static struct txc_node *floor_div(const txc_int *const num, const txc_int *const den, const bool neg)
+{
+    if (txc_int_is_zero(den))
+        return (struct txc_node *)&TXC_NAN_ERROR_ZERO_DIVISION;
+    size_t bits;
+    const bool pow2 = txc_int_is_pow2(den, &bits);
+    txc_int *dividend = txc_int_copy(num);
+    // flooring by -2^bits is flooring the negated dividend by 2^bits
+    if (neg != (pow2 && txc_int_is_neg(den)))
+        dividend = txc_int_neg(dividend);
+    if (dividend == NULL)
+        return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+    txc_int *quotient = NULL;
+    bool success;
+    if (pow2) {
+        quotient = txc_int_shift_right(dividend, bits, TXC_INT_DIV_FLOOR);
+        success = quotient != NULL;
+        rewrite_stats.shifts++;
+    } else {
+        success = txc_int_divisor_divmod(dividend, cached_divisor(den), TXC_INT_DIV_FLOOR, &quotient, NULL);
+    }
+    txc_int_free(dividend);
+    if (!success)
+        return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+    return txc_int_to_node(quotient);
+}
+
+// Fractions of integers take a single floor division, written out ones are not even reduced first.
+static struct txc_node *simplify_floor(const struct txc_node *const node)
+{
+    const struct txc_node *const operand = node->children[0];
+    struct txc_node *simple;
+    if (operand->type == TXC_FRAC && operand->children_amount == 2) {
+        struct txc_node *const den = txc_node_simplify(operand->children[0]);
+        struct txc_node *const num = txc_node_simplify(operand->children[1]);
+        if (den->type == TXC_INT && num->type == TXC_INT) {
+            struct txc_node *const result = floor_div(num->impl.integer, den->impl.integer, false);
+            txc_node_free(den);
+            txc_node_free(num);
+            return result;
+        }
+        // the fraction is finished from its simplified parts instead of simplifying them again
+        simple = shell(operand);
+        if (simple->type == TXC_NAN || operand->children[0]->type == TXC_NAN || operand->children[1]->type == TXC_NAN) {
+            struct txc_node *const nan = simple->type == TXC_NAN ? simple : operand->children[0]->type == TXC_NAN ? den : num;
+            if (nan != simple)
+                txc_node_free(simple);
+            if (nan != den)
+                txc_node_free(den);
+            if (nan != num)
+                txc_node_free(num);
+            return nan;
+        }
+        simple->children[0] = den;
+        simple->children[1] = num;
+        simple = simplify_op(simple);
+    } else {
+        simple = txc_node_simplify(operand);
+    }
+    if (simple->type == TXC_INT || simple->type == TXC_NAN)
+        return simple;
+    const bool neg = simple->type == TXC_NEG;
+    const struct txc_node *const frac = neg ? simple->children[0] : simple;
+    if (frac->type == TXC_FRAC && frac->children[0]->type == TXC_INT && (frac->children_amount == 1 || frac->children[1]->type == TXC_INT)) {
+        txc_int *const one = txc_int_create_one();
+        struct txc_node *const result = one == NULL ? (struct txc_node *)&TXC_NAN_ERROR_ALLOC : floor_div(frac->children_amount == 2 ? frac->children[1]->impl.integer : one, frac->children[0]->impl.integer, neg);
+        txc_int_free(one);
+        txc_node_free(simple);
+        return result;
+    }
+    union impl impl;
+    impl.integer = NULL;
+    struct txc_node *const floor_node = txc_node_create(&simple, impl, 1, TXC_FLOOR);
+    if (floor_node->type == TXC_NAN)
+        txc_node_free(simple);
+    return floor_node;
+}
+
+// INT, FRAC of INTs and negations of them
+static bool is_rational(const struct txc_node *node)
+{
+    while (node->type == TXC_NEG)
+        node = node->children[0];
+    switch (node->type) {
+    case TXC_INT:
+        return true;
+    case TXC_FRAC:
+        return node->children[0]->type == TXC_INT && !txc_int_is_zero(node->children[0]->impl.integer) && (node->children_amount == 1 || node->children[1]->type == TXC_INT);
+    default:
+        return false;
+    }
+}
+
+static txc_rat *to_rat(const struct txc_node *node)
+{
+    assert(is_rational(node));
+    bool neg = false;
+    for (; node->type == TXC_NEG; node = node->children[0])
+        neg = !neg;
+    txc_rat *rat;
+    switch (node->type) {
+    case TXC_INT:
+        rat = txc_rat_create(txc_int_copy(node->impl.integer), txc_int_create_one());
+        break;
+    case TXC_FRAC:
+        rat = txc_rat_create(node->children_amount == 2 ? txc_int_copy(node->children[1]->impl.integer) : txc_int_create_one(), txc_int_copy(node->children[0]->impl.integer));
+        break;
+    default:
+        TXC_ERROR_INVALID_NODE_TYPE(node->type);
+        return NULL;
+    }
+    return neg ? txc_rat_neg(rat) : rat;
+}
+
+// Collects the summands of nested sums in order into the allocated leaves.
+static bool add_leaves(const struct txc_node *const node, const struct txc_node ***const leaves_out, size_t *const amount)
+{
+    const struct txc_node **leaves = NULL;
+    size_t leaves_size = 0;
+    *amount = 0;
+    // sums whose summands after next are still to be visited
+    struct add_frame {
+        const struct txc_node *node;
+        size_t next;
+    } *stack = NULL;
+    size_t used = 0;
+    size_t size = 0;
+    struct add_frame cur = { node, 0 };
+    bool success = true;
+    while (success) {
+        if (cur.node->type != TXC_ADD || cur.next == cur.node->children_amount) {
+            if (cur.node->type != TXC_ADD) {
+                if (*amount == leaves_size) {
+                    const struct txc_node **const tmp = txc_grow(leaves, &leaves_size, sizeof *leaves, "flat sum leaves");
+                    success = tmp != NULL;
+                    if (!success)
+                        break;
+                    leaves = tmp;
+                }
+                leaves[(*amount)++] = cur.node;
+            }
+            if (used == 0)
+                break;
+            cur = stack[--used];
+            continue;
+        }
+        if (used == size) {
+            struct add_frame *const tmp = txc_grow(stack, &size, sizeof *stack, "flat sum stack");
+            success = tmp != NULL;
+            if (!success)
+                break;
+            stack = tmp;
+        }
+        const struct txc_node *const child = cur.node->children[cur.next++];
+        stack[used++] = cur;
+        cur = (struct add_frame){ child, 0 };
+    }
+    free(stack);
+    if (!success) {
+        free(leaves);
+        leaves = NULL;
+    }
+    *leaves_out = leaves;
+    return success;
+}
+
+// The parser nests sums, flattening them before the summands are simplified lets all rational summands be added at once.
+// Returns a sum without children yet, which are to be simplified from leaves.
+static struct txc_node *flat_add(const struct txc_node *const node, const struct txc_node ***const leaves)
+{
+    size_t amount;
+    if (!add_leaves(node, leaves, &amount))
+        return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+    struct txc_node *const flat = node_alloc(amount, "flat sum");
+    if (flat == NULL) {
+        free(*leaves);
+        *leaves = NULL;
+        return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+    }
+    flat->impl.integer = NULL;
+    flat->type = TXC_ADD;
+    for (size_t i = 0; i < amount; i++)
+        flat->children[i] = NULL;
+    return flat;
+}
+
+// An integer, possibly negated a few times.
+static const txc_int *signed_int(const struct txc_node *node, bool *const neg)
+{
+    *neg = false;
+    for (; node->type == TXC_NEG; node = node->children[0])
+        *neg = !*neg;
+    return node->type == TXC_INT ? node->impl.integer : NULL;
+}
+
+// Products of two integers in a sum are accumulated directly instead of being multiplied out into ints of their own.
+static bool fused_product(const struct txc_node *node, const txc_int **const a, const txc_int **const b, bool *const neg)
+{
+    bool neg_product = false;
+    for (; node->type == TXC_NEG; node = node->children[0])
+        neg_product = !neg_product;
+    if (node->type != TXC_MUL || node->children_amount != 2)
+        return false;
+    bool neg_a;
+    bool neg_b;
+    *a = signed_int(node->children[0], &neg_a);
+    *b = signed_int(node->children[1], &neg_b);
+    *neg = neg_product != (neg_a != neg_b);
+    return *a != NULL && *b != NULL;
+}
+
+static uint32_t hash_mix(uint32_t hash, const uint32_t value)
+{
+    hash ^= value + 0x9e3779b9u + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+// Spreads a child hash before it is summed up, so the sum does not depend on the order of the children.
+static uint32_t hash_spread(uint32_t hash)
+{
+    hash = (hash ^ hash >> 16) * 0x45d9f3bu;
+    hash = (hash ^ hash >> 16) * 0x45d9f3bu;
+    return hash ^ hash >> 16;
+}
+
+static bool is_commutative(const enum txc_node_type type)
+{
+    return type == TXC_ADD || type == TXC_MUL;
+}
+
+static uint32_t hash_leaf(const struct txc_node *const node)
+{
+    uint32_t hash = hash_mix(0, node->type);
+    if (node->type == TXC_INT)
+        return hash_mix(hash, txc_int_fingerprint(node->impl.integer));
+    for (const char *c = node->type == TXC_VARIABLE ? node->impl.name : node->impl.reason; *c != '\0'; c++)
+        hash = hash_mix(hash, (unsigned char)*c);
+    return hash;
+}
+
+// Read-only NAN constants are never stored to, so their hash is recomputed.
+static uint32_t cons_hash(const struct txc_node *const node)
+{
+    return node->read_only ? hash_leaf(node) : node->hash;
+}
+
+static bool structurally_equal(const struct txc_node *const a, const struct txc_node *const b);
+
+static int hash_order(const void *const x, const void *const y)
+{
+    const uint32_t hash_x = cons_hash(*(const struct txc_node *const *)x);
+    const uint32_t hash_y = cons_hash(*(const struct txc_node *const *)y);
+    return (hash_x > hash_y) - (hash_x < hash_y);
+}
+
+static size_t count_equal(const struct txc_node *const *const nodes, const size_t amount, const struct txc_node *const of)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < amount; i++)
+        count += structurally_equal(nodes[i], of);
+    return count;
+}
+
+struct equal_pair {
+    const struct txc_node *a;
+    const struct txc_node *b;
+};
+
+static bool push_pair(struct equal_pair **const stack, size_t *const used, size_t *const size, const struct txc_node *const a, const struct txc_node *const b)
+{
+    if (*used == *size) {
+        struct equal_pair *const tmp = txc_grow(*stack, size, sizeof **stack, "comparison stack");
+        if (tmp == NULL)
+            return false;
+        *stack = tmp;
+    }
+    (*stack)[(*used)++] = (struct equal_pair){ a, b };
+    return true;
+}
+
+// Summands and factors are paired up by sorting them by their hashes, only children sharing a hash are compared as multisets right away.
+// Those are equal themselves unless hashes collide, so comparing them nests about as deep as the tree has doublings.
+static bool push_commutative(struct equal_pair **const stack, size_t *const used, size_t *const size, const struct txc_node *const a, const struct txc_node *const b)
+{
+    const size_t amount = a->children_amount;
+    const struct txc_node *local[16];
+    const struct txc_node **sorted = local;
+    if (amount > sizeof local / sizeof *local / 2) {
+        sorted = malloc(sizeof *sorted * amount * 2);
+        if (sorted == NULL) {
+            TXC_ERROR_ALLOC(sizeof *sorted * amount * 2, "sorted children");
+            return false;
+        }
+    }
+    const struct txc_node **const sorted_a = sorted;
+    const struct txc_node **const sorted_b = sorted + amount;
+    memcpy(sorted_a, a->children, sizeof *sorted_a * amount);
+    memcpy(sorted_b, b->children, sizeof *sorted_b * amount);
+    qsort(sorted_a, amount, sizeof *sorted_a, &hash_order);
+    qsort(sorted_b, amount, sizeof *sorted_b, &hash_order);
+    bool equal = true;
+    for (size_t i = 0; equal && i < amount;) {
+        const uint32_t hash = cons_hash(sorted_a[i]);
+        size_t run = 1;
+        while (i + run < amount && cons_hash(sorted_a[i + run]) == hash)
+            run++;
+        for (size_t j = 0; equal && j < run; j++)
+            equal = cons_hash(sorted_b[i + j]) == hash;
+        equal = equal && (i + run == amount || cons_hash(sorted_b[i + run]) != hash);
+        if (equal && run == 1)
+            equal = push_pair(stack, used, size, sorted_a[i], sorted_b[i]);
+        // equal multisets, as every child of the run in a occurs in b as often as in a
+        for (size_t j = 0; equal && run > 1 && j < run; j++)
+            equal = count_equal(sorted_a + i, run, sorted_a[i + j]) == count_equal(sorted_b + i, run, sorted_a[i + j]);
+        i += run;
+    }
+    if (sorted != local)
+        free(sorted);
+    return equal;
+}
+
+// Summands and factors match in any order.
+static bool structurally_equal(const struct txc_node *const a, const struct txc_node *const b)
+{
+    struct equal_pair *stack = NULL;
+    size_t used = 0;
+    size_t size = 0;
+    struct equal_pair cur = { a, b };
+    bool equal = true;
+    while (true) {
+        if (cur.a != cur.b) {
+            equal = cur.a->type == cur.b->type && cur.a->children_amount == cur.b->children_amount && cons_hash(cur.a) == cons_hash(cur.b);
+            if (equal && cur.a->type == TXC_INT)
+                equal = txc_int_cmp(cur.a->impl.integer, cur.b->impl.integer) == 0;
+            else if (equal && cur.a->type == TXC_NAN)
+                equal = strcmp(cur.a->impl.reason, cur.b->impl.reason) == 0;
+            else if (equal && cur.a->type == TXC_VARIABLE)
+                equal = strcmp(cur.a->impl.name, cur.b->impl.name) == 0;
+            else if (equal && is_commutative(cur.a->type) && cur.a->children_amount > 1)
+                equal = push_commutative(&stack, &used, &size, cur.a, cur.b);
+            else
+                for (size_t i = cur.a->children_amount; equal && i > 0; i--)
+                    equal = push_pair(&stack, &used, &size, cur.a->children[i - 1], cur.b->children[i - 1]);
+        }
+        if (!equal || used == 0)
+            break;
+        cur = stack[--used];
+    }
+    free(stack);
+    return equal;
+}
+
+// Either the entry of an equal operation or the empty slot for node.
+static struct cons_entry *cons_find(const struct txc_node *const node)
+{
+    for (size_t i = node->hash & (cons_size - 1);; i = (i + 1) & (cons_size - 1)) {
+        struct cons_entry *const entry = &cons_table[i];
+        if (entry->node == NULL || (entry->node->hash == node->hash && structurally_equal(entry->node, node)))
+            return entry;
+    }
+}
+
+static bool cons_grow(void)
+{
+    if (cons_size > SIZE_MAX / sizeof *cons_table / 2) {
+        TXC_ERROR_OVERFLOW("shared subtrees");
+        return false;
+    }
+    const size_t size = cons_size == 0 ? TXC_NODE_CONS_SIZE : cons_size * 2;
+    struct cons_entry *const table = malloc(sizeof *table * size);
+    if (table == NULL) {
+        TXC_ERROR_ALLOC(sizeof *table * size, "shared subtrees");
+        return false;
+    }
+    for (size_t i = 0; i < size; i++)
+        table[i].node = NULL;
+    for (size_t i = 0; i < cons_size; i++) {
+        if (cons_table[i].node == NULL)
+            continue;
+        size_t j = cons_table[i].node->hash & (size - 1);
+        while (table[j].node != NULL)
+            j = (j + 1) & (size - 1);
+        table[j] = cons_table[i];
+    }
+    free(cons_table);
+    cons_table = table;
+    cons_size = size;
+    return true;
+}
+
+static void cons_clear(void)
+{
+    for (size_t i = 0; i < cons_size; i++) {
+        if (cons_table[i].node != NULL && cons_table[i].simple != NULL)
+            txc_node_free(cons_table[i].simple);
+    }
+    free(cons_table);
+    cons_table = NULL;
+    cons_size = 0;
+    cons_used = 0;
+}
+
+static bool natural(const struct txc_node *const node)
+{
+    size_t n;
+    return node->type == TXC_INT && !txc_int_is_neg(node->impl.integer) && txc_int_abs_to_size(node->impl.integer, &n);
+}
+
+// Sums, products and negations of pure operands, natural powers of them and factorials of natural integers, whose children are marked already.
+// Only running out of memory turns them into a NAN.
+static bool pure_op(const struct txc_node *const node)
+{
+    switch (node->type) {
+    case TXC_NEG: /* FALLTHROUGH */
+    case TXC_ADD: /* FALLTHROUGH */
+    case TXC_MUL:
+        for (size_t i = 0; i < node->children_amount; i++) {
+            if (!node->children[i]->pure)
+                return false;
+        }
+        return true;
+    case TXC_POW:
+        return node->children[0]->pure && natural(node->children[1]);
+    case TXC_FACT:
+        return natural(node->children[0]);
+    default:
+        return false;
+    }
+}
+
+bool txc_node_pure(const struct txc_node *const node, bool (*const pure)(const char *const name))
+{
+    assert(txc_node_test_valid(node, true));
+    const struct txc_node **stack = NULL;
+    size_t used = 0;
+    size_t size = 0;
+    const struct txc_node *cur = node;
+    bool result = true;
+    while (result) {
+        // the rules of pure_op, checked on every node as all of them have to hold
+        switch (cur->type) {
+        case TXC_INT: /* FALLTHROUGH */
+        case TXC_NEG: /* FALLTHROUGH */
+        case TXC_ADD: /* FALLTHROUGH */
+        case TXC_MUL:
+            break;
+        case TXC_VARIABLE:
+            result = pure(cur->impl.name);
+            break;
+        case TXC_POW:
+            result = natural(cur->children[1]);
+            break;
+        case TXC_FACT:
+            result = natural(cur->children[0]);
+            break;
+        default:
+            result = false;
+            break;
+        }
+        for (size_t i = 0; result && i < cur->children_amount; i++) {
+            if (used == size) {
+                const struct txc_node **const tmp = txc_grow(stack, &size, sizeof *stack, "purity stack");
+                result = tmp != NULL;
+                stack = result ? tmp : stack;
+            }
+            if (result)
+                stack[used++] = cur->children[i];
+        }
+        if (used == 0)
+            break;
+        cur = stack[--used];
+    }
+    free(stack);
+    return result;
+}
+
+// Hashes the tree bottom up and marks every operation equal to an earlier one and that earlier one as repeated.
+// Stops if the table can not grow, the marks are ignored without a table.
+// The hash of an operation is a bijection of the hash of a single changing child, so long chains would cycle through equal hashes without also hashing their size.
+static bool cons_build(struct txc_node *const node)
+{
+    // operations whose children after next are still to be hashed, with the amount of nodes below the hashed ones
+    struct cons_frame {
+        struct txc_node *node;
+        size_t next;
+        size_t nodes;
+    } *stack = NULL;
+    size_t used = 0;
+    size_t size = 0;
+    struct cons_frame cur = { node, 0, 0 };
+    bool success = true;
+    while (true) {
+        struct txc_node *const n = cur.node;
+        const bool leaf = n->read_only || n->type == TXC_INT || n->type == TXC_NAN || n->type == TXC_VARIABLE;
+        if (cur.next == 0 && !n->read_only) {
+            n->repeated = false;
+            n->hashed = false;
+            n->pure = false;
+            n->refers = false;
+            if (leaf) {
+                n->hash = hash_leaf(n);
+                n->nodes = 1;
+                n->hashed = true;
+                // a variable whose value can be no NAN does not stop a factor of 0 from skipping its evaluation
+                n->pure = n->type == TXC_INT || (n->type == TXC_VARIABLE && txc_var_pure(n->impl.name));
+                n->refers = n->type == TXC_VARIABLE;
+            }
+        }
+        if (!leaf && cur.next < n->children_amount) {
+            if (used == size) {
+                struct cons_frame *const tmp = txc_grow(stack, &size, sizeof *stack, "hashing stack");
+                if (tmp == NULL) {
+                    success = false;
+                    break;
+                }
+                stack = tmp;
+            }
+            stack[used++] = (struct cons_frame){ n, cur.next + 1, cur.nodes };
+            cur = (struct cons_frame){ n->children[cur.next], 0, 0 };
+            continue;
+        }
+        if (!leaf) {
+            uint32_t hash = hash_mix(0, n->type);
+            uint32_t sum = 0;
+            for (size_t i = 0; i < n->children_amount; i++) {
+                if (is_commutative(n->type))
+                    sum += hash_spread(cons_hash(n->children[i]));
+                else
+                    hash = hash_mix(hash, cons_hash(n->children[i]));
+            }
+            n->hash = hash_mix(hash_mix(hash_mix(hash, sum), (uint32_t)n->children_amount), (uint32_t)(cur.nodes + 1));
+            n->nodes = cur.nodes < UINT32_MAX ? (uint32_t)(cur.nodes + 1) : UINT32_MAX;
+            n->hashed = true;
+            n->pure = pure_op(n);
+            for (size_t i = 0; i < n->children_amount; i++)
+                n->refers = n->refers || n->children[i]->refers;
+            if (cons_used >= cons_size / 2 && !cons_grow()) {
+                success = false;
+                break;
+            }
+            struct cons_entry *const entry = cons_find(n);
+            if (entry->node == NULL) {
+                entry->node = n;
+                entry->simple = NULL;
+                cons_used++;
+            } else {
+                entry->node->repeated = true;
+                n->repeated = true;
+            }
+        }
+        if (used == 0)
+            break;
+        const size_t nodes = cur.nodes + 1;
+        cur = stack[--used];
+        cur.nodes += nodes;
+    }
+    free(stack);
+    return success;
+}
+
+static size_t node_bytes(const struct txc_node *const node)
+{
+    const struct txc_node **stack = NULL;
+    size_t used = 0;
+    size_t size = 0;
+    size_t bytes = 0;
+    const struct txc_node *cur = node;
+    while (true) {
+        if (!cur->read_only) {
+            bytes += sizeof *cur + sizeof *cur->children * cur->children_amount;
+            if (cur->type == TXC_INT)
+                bytes += txc_int_bytes(cur->impl.integer);
+            else if (cur->type == TXC_NAN)
+                bytes += strlen(cur->impl.reason) + 1;
+            else if (cur->type == TXC_VARIABLE)
+                bytes += strlen(cur->impl.name) + 1;
+            for (size_t i = 0; i < cur->children_amount; i++) {
+                if (used == size) {
+                    const struct txc_node **const tmp = txc_grow(stack, &size, sizeof *stack, "size stack");
+                    // the size only decides about evictions, so a missing subtree is not fatal
+                    if (tmp == NULL)
+                        break;
+                    stack = tmp;
+                }
+                stack[used++] = cur->children[i];
+            }
+        }
+        if (used == 0)
+            break;
+        cur = stack[--used];
+    }
+    free(stack);
+    return bytes;
+}
+
+// Fails if the stack can not grow, as the copy is only found by its hashes.
+static bool copy_hashes(struct txc_node *const to, const struct txc_node *const from)
+{
+    struct equal_pair *stack = NULL;
+    size_t used = 0;
+    size_t size = 0;
+    struct equal_pair cur = { to, from };
+    bool success = true;
+    while (true) {
+        if (!cur.a->read_only) {
+            ((struct txc_node *)cur.a)->hash = cur.b->hash;
+            for (size_t i = 0; success && i < cur.a->children_amount; i++)
+                success = push_pair(&stack, &used, &size, cur.a->children[i], cur.b->children[i]);
+        }
+        if (!success || used == 0)
+            break;
+        cur = stack[--used];
+    }
+    free(stack);
+    return success;
+}
+
+// Sums, products and negations of kept results are cheap to redo, so only the operations above them are kept.
+static bool memo_worth(const enum txc_node_type type)
+{
+    switch (type) {
+    case TXC_FRAC: /* FALLTHROUGH */
+    case TXC_POW: /* FALLTHROUGH */
+    case TXC_ROOT: /* FALLTHROUGH */
+    case TXC_FACT: /* FALLTHROUGH */
+    case TXC_BINOM: /* FALLTHROUGH */
+    case TXC_MOD: /* FALLTHROUGH */
+    case TXC_FLOOR:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool memo_keeps(const struct txc_node *const node)
+{
+    return memo_budget != 0 && node->hashed && !node->refers && memo_worth(node->type) && node->nodes <= TXC_NODE_MEMO_NODES;
+}
+
+static struct memo_entry *memo_find(const struct txc_node *const node)
+{
+    if (memo_buckets == NULL || !node->hashed || node->refers)
+        return NULL;
+    for (struct memo_entry *entry = memo_buckets[node->hash & (memo_bucket_amount - 1)]; entry != NULL; entry = entry->next_in_bucket) {
+        if (entry->hash == node->hash && structurally_equal(entry->key, node))
+            return entry;
+    }
+    return NULL;
+}
+
+static void memo_unlink(struct memo_entry *const entry)
+{
+    if (entry->older != NULL)
+        entry->older->newer = entry->newer;
+    else
+        memo_oldest = entry->newer;
+    if (entry->newer != NULL)
+        entry->newer->older = entry->older;
+    else
+        memo_newest = entry->older;
+}
+
+static void memo_push(struct memo_entry *const entry)
+{
+    entry->older = memo_newest;
+    entry->newer = NULL;
+    if (memo_newest != NULL)
+        memo_newest->newer = entry;
+    else
+        memo_oldest = entry;
+    memo_newest = entry;
+}
+
+static void memo_hit(struct memo_entry *const entry)
+{
+    memo_stats.hits++;
+    memo_unlink(entry);
+    memo_push(entry);
+}
+
+static void memo_evict(struct memo_entry *const entry)
+{
+    memo_unlink(entry);
+    struct memo_entry **link = &memo_buckets[entry->hash & (memo_bucket_amount - 1)];
+    while (*link != entry)
+        link = &(*link)->next_in_bucket;
+    *link = entry->next_in_bucket;
+    memo_stats.entries--;
+    memo_stats.bytes -= entry->bytes;
+    txc_node_free(entry->key);
+    txc_node_free(entry->simple);
+    free(entry->str);
+    free(entry);
+}
+
+// Evicts the least recently used entries other than keep until bytes more fit into the budget.
+static bool memo_reserve(const size_t bytes, const struct memo_entry *const keep)
+{
+    if (bytes > memo_budget)
+        return false;
+    while (memo_stats.bytes > memo_budget - bytes && memo_oldest != NULL && memo_oldest != keep) {
+        memo_evict(memo_oldest);
+        memo_stats.evictions++;
+    }
+    return memo_stats.bytes <= memo_budget - bytes;
+}
+
+static bool memo_grow(void)
+{
+    if (memo_bucket_amount > SIZE_MAX / sizeof *memo_buckets / 2) {
+        TXC_ERROR_OVERFLOW("memo buckets");
+        return false;
+    }
+    const size_t amount = memo_bucket_amount == 0 ? TXC_NODE_MEMO_BUCKETS : memo_bucket_amount * 2;
+    struct memo_entry **const buckets = malloc(sizeof *buckets * amount);
+    if (buckets == NULL) {
+        TXC_ERROR_ALLOC(sizeof *buckets * amount, "memo buckets");
+        return false;
+    }
+    for (size_t i = 0; i < amount; i++)
+        buckets[i] = NULL;
+    for (struct memo_entry *entry = memo_oldest; entry != NULL; entry = entry->newer) {
+        struct memo_entry **const bucket = &buckets[entry->hash & (amount - 1)];
+        entry->next_in_bucket = *bucket;
+        *bucket = entry;
+    }
+    free(memo_buckets);
+    memo_buckets = buckets;
+    memo_bucket_amount = amount;
+    return true;
+}
+
+// Failures only mean that the result is not kept. NANs are never kept, as they might stem from a lack of memory.
+static struct memo_entry *memo_insert(const struct txc_node *const node, const struct txc_node *const simple, const char *const str)
+{
+    if (!node->hashed || node->refers || simple->type == TXC_NAN)
+        return NULL;
+    const size_t bytes = sizeof(struct memo_entry) + node_bytes(node) + node_bytes(simple) + (str == NULL ? 0 : strlen(str) + 1);
+    if (!memo_reserve(bytes, NULL))
+        return NULL;
+    if (memo_stats.entries >= memo_bucket_amount && !memo_grow())
+        return NULL;
+    struct memo_entry *const entry = malloc(sizeof *entry);
+    if (entry == NULL) {
+        TXC_ERROR_ALLOC(sizeof *entry, "memo entry");
+        return NULL;
+    }
+    // entries outlive the arena of the line they were made in
+    entry->key = txc_node_copy(node);
+    entry->simple = txc_node_copy(simple);
+    entry->str = str == NULL ? NULL : txc_strdup(str);
+    if (entry->key->type == TXC_NAN || entry->simple->type == TXC_NAN || (str != NULL && entry->str == NULL) || !copy_hashes(entry->key, node)) {
+        txc_node_free(entry->key);
+        txc_node_free(entry->simple);
+        free(entry->str);
+        free(entry);
+        return NULL;
+    }
+    entry->bytes = bytes;
+    entry->hash = node->hash;
+    struct memo_entry **const bucket = &memo_buckets[entry->hash & (memo_bucket_amount - 1)];
+    entry->next_in_bucket = *bucket;
+    *bucket = entry;
+    memo_push(entry);
+    memo_stats.entries++;
+    memo_stats.bytes += bytes;
+    return entry;
+}
+
+// Whole lines also keep their rendered result, so repeating them costs a hash and a lookup.
+static void memo_keep_line(const struct txc_node *const node, const struct txc_node *const simple, const char *const str)
+{
+    struct memo_entry *const entry = memo_find(node);
+    if (entry == NULL) {
+        memo_insert(node, simple, str);
+        return;
+    }
+    const size_t bytes = strlen(str) + 1;
+    if (entry->str != NULL || !memo_reserve(bytes, entry))
+        return;
+    entry->str = txc_strdup(str);
+    if (entry->str == NULL)
+        return;
+    entry->bytes += bytes;
+    memo_stats.bytes += bytes;
+}
+
+void txc_node_memo_init(const size_t budget)
+{
+    txc_node_memo_free();
+    memo_budget = budget;
+}
+
+void txc_node_memo_free(void)
+{
+    while (memo_oldest != NULL)
+        memo_evict(memo_oldest);
+    free(memo_buckets);
+    memo_buckets = NULL;
+    memo_bucket_amount = 0;
+    memo_budget = 0;
+    memo_stats = (struct txc_node_memo_stats){ 0 };
+}
+
+struct txc_node_memo_stats txc_node_memo_stats(void)
+{
+    return memo_stats;
+}
+
+struct txc_node_rewrite_stats txc_node_rewrite_stats(void)
+{
+    return rewrite_stats;
+}
+
+// Factors of 1 and -1 only decide the sign and powers of two are shifted in afterwards, so the multiplication only gets the rest.
+static txc_int *mul_ints(const txc_int **const factors, const size_t amount)
+{
+    if (amount < 2)
+        return txc_int_mul(factors, amount);
+    bool neg = false;
+    size_t shift = 0;
+    size_t used = 0;
+    for (size_t i = 0; i < amount; i++) {
+        const txc_int *const factor = factors[i];
+        size_t bits;
+        if (txc_int_is_zero(factor))
+            return txc_int_create_zero();
+        if (!txc_int_is_pow2(factor, &bits)) {
+            factors[used++] = factor;
+            continue;
+        }
+        neg = neg != txc_int_is_neg(factor);
+        shift += bits;
+        if (bits == 0)
+            rewrite_stats.units++;
+        else
+            rewrite_stats.shifts++;
+    }
+    if (used == amount)
+        return txc_int_mul(factors, amount);
+    txc_int *product = used == 0 ? txc_int_create_one() : txc_int_mul(factors, used);
+    if (shift > 0) {
+        txc_int *const shifted = txc_int_shift_left(product, shift);
+        txc_int_free(product);
+        product = shifted;
+    }
+    return neg ? txc_int_neg(product) : product;
 }
 
-/* NODE */
+// A denominator of 2^bits only shares the trailing zeros of the numerator, which are shifted out instead of dividing both by their gcd.
+static struct txc_node *frac_pow2(struct txc_node *const frac, const size_t bits)
+{
+    const txc_int *const den = frac->children[0]->impl.integer;
+    const txc_int *const num = frac->children[1]->impl.integer;
+    const size_t zeros = txc_int_trailing_zeros(num);
+    const size_t shift = zeros < bits ? zeros : bits;
+    txc_int *const num_shifted = txc_int_shift_right(num, shift, TXC_INT_DIV_TRUNC);
+    txc_int *const den_shifted = txc_int_shift_right(den, shift, TXC_INT_DIV_TRUNC);
+    txc_node_free(frac);
+    rewrite_stats.shifts++;
+    // the gcd of the rest is found without dividing as well
+    return txc_rat_to_node(txc_rat_create(num_shifted, den_shifted));
+}
 
-struct txc_node *txc_node_simplify(const struct txc_node *const node)
+// Takes ownership of cpy, whose children are simplified already.
+static struct txc_node *simplify_op(struct txc_node *cpy)
 {
-    assert(txc_node_test_valid(node, true));
-    struct txc_node *cpy = copy(node);
-    for (size_t i = 0; i < node->children_amount; i++) {
-        txc_node_free(cpy->children[i]);
-        cpy->children[i] = txc_node_simplify(node->children[i]);
-        if (node->children[i]->type != TXC_NAN)
-            continue;
-        struct txc_node *const tmp = cpy->children[i];
-        cpy->children[i] = NULL;
-        txc_node_free(cpy);
-        return tmp;
-    }
     switch (cpy->type) {
     case TXC_NEG:
         switch (cpy->children[0]->type) {
         case TXC_INT: {
-            txc_int *const tmp = txc_int_copy(node->children[0]->impl.integer);
+            txc_int *const tmp = txc_int_copy(cpy->children[0]->impl.integer);
             txc_node_free(cpy);
             if (tmp == NULL)
                 return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
@@ -322,80 +2171,113 @@ struct txc_node *txc_node_simplify(const struct txc_node *const node)
     case TXC_MUL: {
         assert(cpy->read_only == false);
         // TODO handle empty sum/product
-        cpy->children_amount = 0;
-        for (size_t i = 0; i < node->children_amount; i++) {
+        const size_t simplified_amount = cpy->children_amount;
+        size_t total = 0;
+        for (size_t i = 0; i < simplified_amount; i++) {
             if (cpy->children[i]->type == cpy->type)
-                cpy->children_amount += node->children[i]->children_amount;
+                total += cpy->children[i]->children_amount;
             else
-                cpy->children_amount++;
+                total++;
         }
+        // integers and fractions of them are folded into a single rational
         size_t int_i = 0;
         size_t other_i = 0;
-        struct txc_node *int_nodes[cpy->children_amount];
-        struct txc_node *other_nodes[cpy->children_amount];
-        for (size_t i = 0; i < cpy->children_amount; i++) {
-            if (cpy->children[i]->type == TXC_INT) {
-                int_nodes[int_i] = cpy->children[i];
+        bool only_ints = true;
+        // one spare element, so nothing is allocated with a size of 0
+        struct txc_node **const int_nodes = malloc(sizeof *int_nodes * (total * 2 + 1));
+        if (int_nodes == NULL) {
+            TXC_ERROR_ALLOC(sizeof *int_nodes * (total * 2 + 1), "operands");
+            txc_node_free(cpy);
+            return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+        }
+        struct txc_node **const other_nodes = int_nodes + total;
+        cpy->children_amount = 0;
+        for (size_t i = 0; i < simplified_amount; i++) {
+            struct txc_node *const child = cpy->children[i];
+            if (is_rational(child)) {
+                only_ints = only_ints && child->type == TXC_INT;
+                int_nodes[int_i] = child;
                 int_i++;
                 continue;
             }
-            if (cpy->children[i]->type != cpy->type) {
-                other_nodes[other_i] = cpy->children[i];
+            if (child->type != cpy->type) {
+                other_nodes[other_i] = child;
                 other_i++;
                 continue;
             }
-            for (size_t j = 0; j < cpy->children[i]->children_amount; j++) {
-                if (cpy->children[i]->type == TXC_INT) {
-                    int_nodes[int_i] = cpy->children[i];
-                    cpy->children[i] = NULL;
+            // the child is simplified already, so its own children are not of the same type anymore
+            for (size_t j = 0; j < child->children_amount; j++) {
+                if (is_rational(child->children[j])) {
+                    only_ints = only_ints && child->children[j]->type == TXC_INT;
+                    int_nodes[int_i] = child->children[j];
                     int_i++;
                 } else {
-                    other_nodes[other_i] = cpy->children[i];
-                    cpy->children[i] = NULL;
+                    other_nodes[other_i] = child->children[j];
                     other_i++;
                 }
             }
-            txc_node_free(cpy->children[i]);
+            child->children_amount = 0;
+            txc_node_free(child);
         }
         cpy->children_amount = other_i + (int_i > 0 ? 1 : 0);
-        struct txc_node *const tmp = realloc(cpy, sizeof *tmp + sizeof *tmp->children * cpy->children_amount);
+        const size_t compact_amount = cpy->children_amount;
+        cpy->children_amount = 0;
+        struct txc_node *const tmp = node_resize(cpy, compact_amount, "compact copy");
         if (tmp == NULL) {
-            cpy->children_amount = 0;
             for (size_t i = 0; i < int_i; i++)
                 txc_node_free(int_nodes[i]);
             for (size_t i = 0; i < other_i; i++)
                 txc_node_free(other_nodes[i]);
-            TXC_ERROR_ALLOC(sizeof *tmp + sizeof *tmp->children * cpy->children_amount, "compact copy");
-            txc_node_free(cpy);
+            free(int_nodes);
             return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
         }
+        tmp->children_amount = compact_amount;
         cpy = tmp;
         for (size_t i = 0; i < other_i; i++)
             cpy->children[i] = other_nodes[i];
-        if (int_i == 0)
+        if (int_i == 0) {
+            free(int_nodes);
             return cpy;
-        const txc_int *ints[int_i];
-        for (size_t i = 0; i < int_i; i++)
-            ints[i] = txc_node_to_int(int_nodes[i]);
-        txc_int *integer;
-        switch (cpy->type) {
-        case TXC_ADD:
-            integer = txc_int_add(ints, int_i);
-            break;
-        case TXC_MUL:
-            integer = txc_int_mul(ints, int_i);
-            break;
-        default:
-            for (size_t i = 0; i < int_i; i++)
-                txc_node_free(int_nodes[i]);
-            cpy->children_amount--;
-            txc_node_free(cpy);
-            TXC_ERROR_INVALID_NODE_TYPE(cpy->type);
-            return (struct txc_node *)&TXC_NAN_ERROR_INVALID_NODE_TYPE;
+        }
+        struct txc_node *int_node;
+        if (only_ints) {
+            const txc_int **const ints = malloc(sizeof *ints * int_i);
+            if (ints == NULL) {
+                TXC_ERROR_ALLOC(sizeof *ints * int_i, "integer operands");
+                int_node = (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+            } else {
+                for (size_t i = 0; i < int_i; i++)
+                    ints[i] = txc_node_to_int(int_nodes[i]);
+                int_node = txc_int_to_node(cpy->type == TXC_ADD ? txc_int_add(ints, int_i) : mul_ints(ints, int_i));
+                free(ints);
+            }
+        } else if (cpy->type == TXC_ADD) {
+            txc_rat **const terms = malloc(sizeof *terms * int_i);
+            if (terms == NULL) {
+                TXC_ERROR_ALLOC(sizeof *terms * int_i, "rational summands");
+                int_node = (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+            } else {
+                for (size_t i = 0; i < int_i; i++)
+                    terms[i] = to_rat(int_nodes[i]);
+                int_node = txc_rat_to_node(txc_rat_sum((const txc_rat *const *)terms, int_i));
+                for (size_t i = 0; i < int_i; i++)
+                    txc_rat_free(terms[i]);
+                free(terms);
+            }
+        } else {
+            txc_rat *acc = to_rat(int_nodes[0]);
+            for (size_t i = 1; i < int_i && acc != NULL; i++) {
+                txc_rat *const operand = to_rat(int_nodes[i]);
+                txc_rat *const next = txc_rat_mul(acc, operand);
+                txc_rat_free(acc);
+                txc_rat_free(operand);
+                acc = next;
+            }
+            int_node = txc_rat_to_node(acc);
         }
         for (size_t i = 0; i < int_i; i++)
             txc_node_free(int_nodes[i]);
-        struct txc_node *const int_node = txc_int_to_node(integer);
+        free(int_nodes);
         if (int_node->type == TXC_NAN) {
             cpy->children_amount--;
             txc_node_free(cpy);
@@ -406,6 +2288,20 @@ struct txc_node *txc_node_simplify(const struct txc_node *const node)
             txc_node_free(cpy);
             return int_node;
         }
+        // a factor of 1 is dropped, one of -1 negates the other factors instead
+        if (cpy->type == TXC_MUL && int_node->type == TXC_INT && (txc_int_is_pos_one(int_node->impl.integer) || txc_int_is_neg_one(int_node->impl.integer))) {
+            const bool neg = txc_int_is_neg_one(int_node->impl.integer);
+            txc_node_free(int_node);
+            rewrite_stats.units++;
+            cpy->children_amount--;
+            struct txc_node *rest = cpy;
+            if (cpy->children_amount == 1) {
+                rest = cpy->children[0];
+                cpy->children_amount = 0;
+                txc_node_free(cpy);
+            }
+            return neg ? simplify_op(txc_node_create_un_op(TXC_NEG, rest)) : rest;
+        }
         cpy->children[cpy->children_amount - 1] = (struct txc_node *)int_node;
         return cpy;
     }
@@ -414,6 +2310,29 @@ struct txc_node *txc_node_simplify(const struct txc_node *const node)
             txc_node_free(cpy);
             return (struct txc_node *)&TXC_NAN_ERROR_ZERO_DIVISION;
         }
+        if (cpy->children_amount == 2 && cpy->children[0]->type == TXC_INT && cpy->children[1]->type == TXC_INT) {
+            const txc_int *const den = cpy->children[0]->impl.integer;
+            const txc_int *const num = cpy->children[1]->impl.integer;
+            // equal operands are often the same shared integer
+            if (num == den || txc_int_cmp(num, den) == 0) {
+                txc_node_free(cpy);
+                rewrite_stats.quotients++;
+                return txc_int_to_node(txc_int_create_one());
+            }
+            size_t bits;
+            if (txc_int_is_pow2(den, &bits))
+                return frac_pow2(cpy, bits);
+        }
+        // quotients of rational constants, fractions of fractions included
+        if (is_rational(cpy->children[0]) && (cpy->children_amount == 1 || is_rational(cpy->children[1]))) {
+            txc_rat *const den = txc_rat_inv(to_rat(cpy->children[0]));
+            txc_rat *const num = cpy->children_amount == 2 ? to_rat(cpy->children[1]) : txc_rat_create(txc_int_create_one(), txc_int_create_one());
+            txc_node_free(cpy);
+            txc_rat *const quotient = txc_rat_mul(num, den);
+            txc_rat_free(num);
+            txc_rat_free(den);
+            return txc_rat_to_node(quotient);
+        }
         bool neg = false;
         if ((cpy->children[0]->type == TXC_INT && txc_int_is_neg(cpy->children[0]->impl.integer)) || cpy->children[0]->type == TXC_NEG) {
             neg = true;
@@ -422,8 +2341,7 @@ struct txc_node *txc_node_simplify(const struct txc_node *const node)
                 tmp = cpy->children[0]->children[0];
                 cpy->children[0]->children[0] = NULL;
             } else {
-                tmp = txc_int_to_node(txc_int_neg(cpy->children[0]->impl.integer));
-                cpy->children[0] = NULL;
+                tmp = txc_int_to_node(txc_int_neg(txc_int_copy(cpy->children[0]->impl.integer)));
             }
             txc_node_free(cpy->children[0]);
             cpy->children[0] = tmp;
@@ -462,7 +2380,9 @@ struct txc_node *txc_node_simplify(const struct txc_node *const node)
             txc_node_free(cpy);
             if (neg)
                 tmp = txc_node_create_un_op(TXC_NEG, tmp);
-            return txc_node_simplify(tmp);
+            struct txc_node *const simple = txc_node_simplify(tmp);
+            txc_node_free(tmp);
+            return simple;
         }
         // TODO switch if frac
         if (cpy->children[0]->type == TXC_NAN || cpy->children[1]->type == TXC_NAN) {
@@ -482,6 +2402,14 @@ struct txc_node *txc_node_simplify(const struct txc_node *const node)
             num = txc_int_copy(cpy->children[1]->impl.integer);
         else if (cpy->children[1]->type == TXC_MUL && cpy->children[1]->children[cpy->children[1]->children_amount - 1]->type == TXC_INT)
             num = txc_int_copy(cpy->children[1]->children[cpy->children[1]->children_amount - 1]->impl.integer);
+        // nothing to cancel without integer factors on both sides
+        if (num == NULL || den == NULL) {
+            txc_int_free(num);
+            txc_int_free(den);
+            if (!neg)
+                return cpy;
+            return txc_node_create_un_op(TXC_NEG, cpy);
+        }
         const txc_int *const gcd = txc_int_gcd(num, den);
         struct txc_node *const num_node = txc_int_to_node(txc_int_div(num, gcd));
         if (num_node->type == TXC_NAN) {
@@ -534,28 +2462,32 @@ struct txc_node *txc_node_simplify(const struct txc_node *const node)
             struct txc_node *tmp = cpy->children[1];
             cpy->children[1] = NULL;
             txc_node_free(cpy);
-            if (neg)
-                tmp = txc_node_simplify(txc_node_create_un_op(TXC_NEG, tmp));
+            if (neg) {
+                struct txc_node *const neg_node = txc_node_create_un_op(TXC_NEG, tmp);
+                tmp = txc_node_simplify(neg_node);
+                txc_node_free(neg_node);
+            }
             return tmp;
         }
         if (cpy->children[1]->type == TXC_INT && txc_int_is_pos_one(cpy->children[1]->impl.integer)) {
             txc_node_free(cpy->children[1]);
             cpy->children_amount = 1;
-            struct txc_node *tmp = realloc(cpy, sizeof *cpy + sizeof *cpy->children * 1);
-            if (tmp == NULL) {
-                TXC_ERROR_ALLOC(sizeof *cpy + sizeof *cpy->children * 1, "unit fraction");
-                txc_node_free(cpy);
+            cpy = node_resize(cpy, 1, "unit fraction");
+            if (cpy == NULL)
                 return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
-            }
-            cpy = tmp;
-        }
-        if (neg) {
-            struct txc_node *const tmp = txc_node_create_un_op(TXC_NEG, cpy);
-            txc_node_free(cpy);
-            return tmp;
         }
+        if (neg)
+            return txc_node_create_un_op(TXC_NEG, cpy);
         return cpy;
     }
+    case TXC_POW:
+        return simplify_pow(cpy);
+    case TXC_ROOT:
+        return simplify_root(cpy);
+    case TXC_FACT:
+        return simplify_fact(cpy);
+    case TXC_BINOM:
+        return simplify_binom(cpy);
     case TXC_NAN: /* FALLTHROUGH */
     case TXC_INT: /* FALLTHROUGH */
     default:
@@ -563,76 +2495,590 @@ struct txc_node *txc_node_simplify(const struct txc_node *const node)
     }
 }
 
-/* PRINT */
+// A product with a factor of 0 is 0 without evaluating the other factors, as long as none of them could be a NAN.
+static bool annihilated(const struct txc_node *const node)
+{
+    if (node->type != TXC_MUL || !node->hashed || !node->pure)
+        return false;
+    for (size_t i = 0; i < node->children_amount; i++) {
+        if (node->children[i]->type == TXC_INT && txc_int_is_zero(node->children[i]->impl.integer))
+            return true;
+    }
+    return false;
+}
 
-static char *concat_children_in_paren(const struct txc_node *const *const children, const size_t amount, const bool reverse_children, const char *const pre, const char *const op, const char *const post)
+// Pairs of negations cancel before their operand is simplified, so no intermediate value is negated.
+static struct txc_node *cancel_negations(const struct txc_node *const node)
 {
-    for (size_t i = 0; i < amount; i++)
-        assert(txc_node_test_valid(children[i], true));
-    size_t size = strlen(pre) + strlen(op) * (amount - 1) + strlen(post);
-    char *child_strs[amount];
-    for (size_t i = 0; i < amount; i++) {
-        child_strs[i] = txc_node_to_str(children[reverse_children ? amount - i - 1 : i]);
-        if (child_strs[i] == NULL) {
-            for (size_t j = 0; j < i; j++)
-                free(child_strs[j]);
-            return NULL;
+    const struct txc_node *operand = node;
+    bool neg = false;
+    while (operand->type == TXC_NEG) {
+        operand = operand->children[0];
+        neg = !neg;
+    }
+    rewrite_stats.negations++;
+    struct txc_node *const simple = txc_node_simplify(operand);
+    if (!neg || simple->type == TXC_NAN)
+        return simple;
+    return simplify_op(txc_node_create_un_op(TXC_NEG, simple));
+}
+
+static struct txc_node *simplify(const struct txc_node *const node)
+{
+    // the children were validated when they were created
+    assert(txc_node_test_valid(node, false));
+    // variables are only evaluated once their value is asked for
+    if (node->type == TXC_VARIABLE)
+        return copy(txc_var_value(node->impl.name));
+    if (node->type == TXC_NEG && node->children[0]->type == TXC_NEG)
+        return cancel_negations(node);
+    if (annihilated(node)) {
+        rewrite_stats.zeros++;
+        return txc_int_to_node(txc_int_create_zero());
+    }
+    if (node->type == TXC_MOD)
+        return simplify_mod(node);
+    if (node->type == TXC_FLOOR)
+        return simplify_floor(node);
+    const struct txc_node **leaves = NULL;
+    // the children are filled in below, copying them first would copy whole subtrees at every level
+    struct txc_node *cpy = node->type == TXC_ADD ? flat_add(node, &leaves) : shell(node);
+    if (cpy->type == TXC_NAN)
+        return cpy;
+    txc_int *dot = NULL;
+    size_t dot_i = 0;
+    for (size_t i = 0; i < cpy->children_amount; i++) {
+        const struct txc_node *const source = leaves == NULL ? node->children[i] : leaves[i];
+        const txc_int *a;
+        const txc_int *b;
+        bool neg;
+        if (leaves != NULL && fused_product(source, &a, &b, &neg)) {
+            if (dot == NULL) {
+                dot = txc_int_create_zero();
+                dot_i = i;
+            }
+            if (!(neg ? txc_int_submul(&dot, a, b) : txc_int_addmul(&dot, a, b))) {
+                free(leaves);
+                txc_node_free(cpy);
+                return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+            }
+            continue;
         }
-        size += strlen(child_strs[i]);
+        cpy->children[i] = txc_node_simplify(source);
+        // variables only turn out to be NANs once their value is asked for
+        if (source->type != TXC_NAN && (source->type != TXC_VARIABLE || cpy->children[i]->type != TXC_NAN))
+            continue;
+        struct txc_node *const tmp = cpy->children[i];
+        cpy->children[i] = NULL;
+        free(leaves);
+        txc_int_free(dot);
+        txc_node_free(cpy);
+        return tmp;
     }
-    char *const buf = malloc(sizeof *buf * (size + 1));
-    if (buf == NULL) {
-        TXC_ERROR_ALLOC(sizeof *buf * (size + 1), "concatinated string");
-        for (size_t i = 0; i < amount; i++)
-            free(child_strs[i]);
-        return txc_node_to_str(&TXC_NAN_ERROR_ALLOC);
+    free(leaves);
+    if (dot != NULL) {
+        // the accumulated products take the place of the first of them
+        cpy->children[dot_i] = txc_int_to_node(dot);
+        if (cpy->children[dot_i]->type == TXC_NAN) {
+            cpy->children[dot_i] = NULL;
+            txc_int_free(dot);
+            txc_node_free(cpy);
+            return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+        }
+        size_t used = 0;
+        for (size_t i = 0; i < cpy->children_amount; i++)
+            if (cpy->children[i] != NULL)
+                cpy->children[used++] = cpy->children[i];
+        cpy->children_amount = used;
     }
-    char *cur = txc_stpcpy(buf, pre);
-    for (size_t i = 0; i < amount; i++) {
-        if (i > 0)
-            cur = txc_stpcpy(cur, op);
-        cur = txc_stpcpy(cur, child_strs[i]);
+    return simplify_op(cpy);
+}
+
+static struct txc_node *memo_simplify(const struct txc_node *const node)
+{
+    if (!memo_keeps(node))
+        return simplify(node);
+    struct memo_entry *const entry = memo_find(node);
+    if (entry != NULL) {
+        memo_hit(entry);
+        return copy(entry->simple);
     }
-    txc_stpcpy(cur, post);
-    for (size_t i = 0; i < amount; i++)
-        free(child_strs[i]);
-    return buf;
+    memo_stats.misses++;
+    struct txc_node *const simple = simplify(node);
+    memo_insert(node, simple, NULL);
+    return simple;
 }
 
-char *txc_node_to_str(const struct txc_node *const node)
+static struct txc_node *simplify_cached(const struct txc_node *const node)
 {
-    assert(txc_node_test_valid(node, true));
-    char *str = NULL;
+    if (!node->repeated || cons_table == NULL)
+        return memo_simplify(node);
+    struct cons_entry *const entry = cons_find(node);
+    if (entry->node == NULL)
+        return memo_simplify(node);
+    if (entry->simple == NULL)
+        entry->simple = memo_simplify(node);
+    return copy(entry->simple);
+}
+
+// Operations simplified in this line or kept from an earlier one are not expanded again.
+static bool answered(const struct txc_node *const node)
+{
+    if (node->repeated && cons_table != NULL) {
+        const struct cons_entry *const entry = cons_find(node);
+        if (entry->node != NULL && entry->simple != NULL)
+            return true;
+    }
+    return memo_keeps(node) && memo_find(node) != NULL;
+}
+
+static void prepare(const struct txc_node *const node, struct txc_node *const simple)
+{
+    if (prepared_used == prepared_size) {
+        struct prepared *const tmp = txc_grow(prepared, &prepared_size, sizeof *prepared, "prepared operands");
+        // the operand is simplified again once it is asked for
+        if (tmp == NULL) {
+            txc_node_free(simple);
+            return;
+        }
+        prepared = tmp;
+    }
+    prepared[prepared_used++] = (struct prepared){ node, simple };
+}
+
+static struct txc_node *take(const size_t i)
+{
+    struct txc_node *const simple = prepared[i].simple;
+    prepared[i].simple = NULL;
+    return simple;
+}
+
+// The operands mod_eval asks txc_node_simplify for, in the same order: exponents and whatever is no sum, product, negation or power.
+static void mod_operands(struct drive_frame *const frame, const struct txc_node *const dividend)
+{
+    const struct txc_node **operands = NULL;
+    size_t amount = 0;
+    size_t operands_size = 0;
+    struct mod_operand {
+        const struct txc_node *node;
+        bool whole;
+    } *stack = NULL;
+    size_t used = 0;
+    size_t size = 0;
+    struct mod_operand cur = { dividend, false };
+    bool success = true;
+    while (success) {
+        if (cur.whole || (!mod_arith(cur.node->type) && cur.node->type != TXC_INT)) {
+            if (cur.node->children_amount > 0) {
+                if (amount == operands_size) {
+                    const struct txc_node **const tmp = txc_grow(operands, &operands_size, sizeof *operands, "modular operands");
+                    success = tmp != NULL;
+                    if (!success)
+                        break;
+                    operands = tmp;
+                }
+                operands[amount++] = cur.node;
+            }
+        } else if (cur.node->type != TXC_INT) {
+            // the exponent of a power is asked for before its base is evaluated, so it is pushed last
+            const bool pow = cur.node->type == TXC_POW;
+            for (size_t i = 0; success && i < cur.node->children_amount; i++) {
+                if (used == size) {
+                    struct mod_operand *const tmp = txc_grow(stack, &size, sizeof *stack, "modular operand stack");
+                    success = tmp != NULL;
+                    if (!success)
+                        break;
+                    stack = tmp;
+                }
+                const size_t child = pow ? i : cur.node->children_amount - i - 1;
+                stack[used++] = (struct mod_operand){ cur.node->children[child], pow && child == 1 };
+            }
+        }
+        if (!success || used == 0)
+            break;
+        cur = stack[--used];
+    }
+    free(stack);
+    if (!success) {
+        // nothing is prepared, so mod_eval simplifies the operands itself
+        free(operands);
+        operands = NULL;
+        amount = 0;
+    }
+    frame->operands = operands;
+    frame->amount = amount;
+    frame->owned = true;
+}
+
+static struct drive_frame drive_frame(const struct txc_node *const node)
+{
+    struct drive_frame frame = { node, NULL, 0, 0, prepared_used, false };
+    if (answered(node))
+        return frame;
     switch (node->type) {
-    case TXC_NAN: {
-        size_t size = sizeof str * (strlen(TXC_NAN_REASON) + strlen(node->impl.reason) + 1);
-        str = malloc(size);
-        if (str == NULL)
-            TXC_ERROR_ALLOC(size, "nan string");
-        else
-            snprintf(str, size, TXC_NAN_REASON, node->impl.reason);
-        return str;
+    case TXC_INT: /* FALLTHROUGH */
+    case TXC_NAN:
+        break;
+    case TXC_MOD:
+        // the rest depends on the modulus, see drive_mod
+        frame.operands = (const struct txc_node *const *)&node->children[1];
+        frame.amount = 1;
+        break;
+    case TXC_FLOOR: {
+        const struct txc_node *const operand = node->children[0];
+        const bool frac = operand->type == TXC_FRAC && operand->children_amount == 2;
+        frame.operands = (const struct txc_node *const *)(frac ? operand->children : node->children);
+        frame.amount = frac ? 2 : 1;
+        break;
     }
-    case TXC_INT:
-        str = txc_int_to_str(node->impl.integer);
-        if (str == NULL)
-            return txc_node_to_str(&TXC_NAN_ERROR_ALLOC);
-        return str;
+    case TXC_ADD: {
+        const struct txc_node **leaves;
+        size_t amount;
+        if (!add_leaves(node, &leaves, &amount))
+            break;
+        size_t used = 0;
+        for (size_t i = 0; i < amount; i++) {
+            const txc_int *a;
+            const txc_int *b;
+            bool neg;
+            if (!fused_product(leaves[i], &a, &b, &neg))
+                leaves[used++] = leaves[i];
+        }
+        frame.operands = leaves;
+        frame.amount = used;
+        frame.owned = true;
+        break;
+    }
+    case TXC_NEG: {
+        // only the operand below all negations, see cancel_negations
+        const struct txc_node *const *operand = (const struct txc_node *const *)node->children;
+        while ((*operand)->type == TXC_NEG)
+            operand = (const struct txc_node *const *)(*operand)->children;
+        frame.operands = operand;
+        frame.amount = 1;
+        break;
+    }
+    case TXC_MUL:
+        if (annihilated(node))
+            break;
+        frame.operands = (const struct txc_node *const *)node->children;
+        frame.amount = node->children_amount;
+        break;
+    default:
+        frame.operands = (const struct txc_node *const *)node->children;
+        frame.amount = node->children_amount;
+        break;
+    }
+    return frame;
+}
+
+// Once the modulus is prepared, integer ones only need what mod_eval asks for and others the whole dividend.
+// Returns false if frame is no \bmod waiting for that.
+static bool drive_mod(struct drive_frame *const frame)
+{
+    const struct txc_node *const node = frame->node;
+    if (node->type != TXC_MOD || frame->operands != (const struct txc_node *const *)&node->children[1])
+        return false;
+    const struct txc_node *modulus = node->children[1];
+    if (modulus->children_amount > 0)
+        modulus = prepared_used > frame->base && prepared[frame->base].node == modulus ? prepared[frame->base].simple : NULL;
+    const bool int_modulus = modulus != NULL && modulus->type == TXC_INT && !txc_int_is_zero(modulus->impl.integer);
+    frame->next = 0;
+    if (int_modulus && mod_arith(node->children[0]->type)) {
+        mod_operands(frame, node->children[0]);
+    } else {
+        frame->operands = (const struct txc_node *const *)node->children;
+        frame->amount = modulus != NULL && modulus->type == TXC_INT && txc_int_is_zero(modulus->impl.integer) ? 0 : 1;
+    }
+    return true;
+}
+
+// Simplifies the operands of every node before the node itself with an explicit stack.
+// simplify then finds them prepared instead of recursing, only operands it did not announce are simplified by a nested drive.
+static struct txc_node *drive(const struct txc_node *const root)
+{
+    struct drive_frame *stack = NULL;
+    size_t used = 0;
+    size_t size = 0;
+    struct txc_node *simple = NULL;
+    const struct txc_node *push = root;
+    while (true) {
+        if (push != NULL) {
+            if (used == size) {
+                struct drive_frame *const tmp = txc_grow(stack, &size, sizeof *stack, "simplification stack");
+                if (tmp == NULL) {
+                    // the operand is simplified once it is asked for
+                    if (used == 0)
+                        return simplify_cached(root);
+                    push = NULL;
+                    continue;
+                }
+                stack = tmp;
+            }
+            stack[used++] = drive_frame(push);
+            push = NULL;
+        }
+        struct drive_frame *const top = &stack[used - 1];
+        if (top->next < top->amount) {
+            const struct txc_node *const operand = top->operands[top->next++];
+            // leaves are simplified directly when asked for and never looked up
+            if (operand->children_amount == 0)
+                continue;
+            if (answered(operand))
+                prepare(operand, simplify_cached(operand));
+            else
+                push = operand;
+            continue;
+        }
+        if (drive_mod(top))
+            continue;
+        const size_t base = prepared_base;
+        const size_t end = prepared_end;
+        const size_t next = prepared_next;
+        prepared_base = top->base;
+        prepared_end = prepared_used;
+        prepared_next = top->base;
+        simple = simplify_cached(top->node);
+        for (size_t i = top->base; i < prepared_used; i++)
+            txc_node_free(prepared[i].simple);
+        prepared_used = top->base;
+        prepared_base = base;
+        prepared_end = end;
+        prepared_next = next;
+        if (top->owned)
+            free((const struct txc_node **)top->operands);
+        used--;
+        if (used == 0)
+            break;
+        prepare(top->node, simple);
+    }
+    free(stack);
+    if (prepared_used == 0) {
+        free(prepared);
+        prepared = NULL;
+        prepared_size = 0;
+    }
+    return simple;
+}
+
+struct txc_node *txc_node_simplify(const struct txc_node *const node)
+{
+    assert(txc_node_test_valid(node, false));
+    if (node->children_amount == 0)
+        return simplify_cached(node);
+    // operands are usually asked for in the order they were prepared
+    if (prepared_next < prepared_end && prepared[prepared_next].node == node && prepared[prepared_next].simple != NULL)
+        return take(prepared_next++);
+    for (size_t i = prepared_base; i < prepared_end; i++) {
+        if (prepared[i].node == node && prepared[i].simple != NULL)
+            return take(i);
+    }
+    return drive(node);
+}
+
+void txc_node_fold_enable(const bool enable)
+{
+    fold_enabled = enable;
+}
+
+// Operations on integers and fractions whose value is one again, roots and other powers would only be simplified partially.
+static bool foldable(const struct txc_node *const node)
+{
+    if (node->type == TXC_ROOT || (node->type == TXC_POW && node->children[1]->type != TXC_INT))
+        return false;
+    for (size_t i = 0; i < node->children_amount; i++) {
+        if (!is_rational(node->children[i]))
+            return false;
+    }
+    if (node->type != TXC_POW)
+        return true;
+    size_t exponent;
+    if (!txc_int_abs_to_size(node->children[1]->impl.integer, &exponent))
+        return false;
+    const struct txc_node *base = node->children[0];
+    while (base->type == TXC_NEG)
+        base = base->children[0];
+    size_t bits = base->type == TXC_INT ? txc_int_bit_length(base->impl.integer) : txc_int_bit_length(base->children[0]->impl.integer);
+    if (base->type == TXC_FRAC && base->children_amount == 2)
+        bits = txc_max(bits, txc_int_bit_length(base->children[1]->impl.integer));
+    return exponent == 0 || bits <= TXC_NODE_FOLD_BITS / exponent;
+}
+
+struct txc_node *txc_node_fold(struct txc_node *const node)
+{
+    assert(txc_node_test_valid(node, false));
+    if (!fold_enabled || arena_active || node->children_amount == 0 || !foldable(node))
+        return node;
+    // the usual operations on two integers skip simplify
+    const bool ints = node->children[0]->type == TXC_INT && (node->children_amount == 1 || node->children[1]->type == TXC_INT);
+    if (ints && (node->type == TXC_NEG || ((node->type == TXC_ADD || node->type == TXC_MUL) && node->children_amount == 2))) {
+        txc_int *result;
+        if (node->type == TXC_NEG) {
+            result = txc_int_neg(txc_int_copy(node->children[0]->impl.integer));
+        } else {
+            const txc_int *const operands[] = { node->children[0]->impl.integer, node->children[1]->impl.integer };
+            result = node->type == TXC_ADD ? txc_int_add(operands, 2) : txc_int_mul(operands, 2);
+        }
+        txc_node_free(node);
+        return txc_int_to_node(result);
+    }
+    struct txc_node *const value = simplify(node);
+    // a NAN operand would stop the whole line, which only happens for NANs of the input itself
+    if (value->type == TXC_NAN) {
+        txc_node_free(value);
+        return node;
+    }
+    txc_node_free(node);
+    return value;
+}
+
+/* PRINT */
+
+// How an operation is written around its children.
+struct notation {
+    const char *pre;
+    const char *op;
+    const char *post;
+    bool reverse_children;
+};
+
+// NULL for INTs, NANs, VARIABLEs and invalid types.
+static const struct notation *notation_of(const struct txc_node *const node)
+{
+    static const struct notation neg = { "(-", "", ")", false };
+    static const struct notation add = { "(", " + ", ")", false };
+    static const struct notation mul = { "(", " \\cdot ", ")", false };
+    static const struct notation unit_frac = { "\\frac{1}{", "", "}", true };
+    static const struct notation frac = { "\\frac{", "}{", "}", true };
+    static const struct notation power = { "{", "}^{", "}", false };
+    static const struct notation square_root = { "\\sqrt{", "", "}", false };
+    static const struct notation root = { "\\sqrt[", "]{", "}", true };
+    static const struct notation fact = { "{", "", "}!", false };
+    static const struct notation binom = { "\\binom{", "}{", "}", false };
+    static const struct notation mod = { "(", " \\bmod ", ")", false };
+    static const struct notation floor_brackets = { "\\lfloor ", "", " \\rfloor", false };
+    switch (node->type) {
     case TXC_NEG:
-        return concat_children_in_paren((const struct txc_node *const *)node->children, node->children_amount, false, "(-", "", ")");
+        return &neg;
     case TXC_ADD:
-        return concat_children_in_paren((const struct txc_node *const *)node->children, node->children_amount, false, "(", " + ", ")");
+        return &add;
     case TXC_MUL:
-        return concat_children_in_paren((const struct txc_node *const *)node->children, node->children_amount, false, "(", " \\cdot ", ")");
+        return &mul;
     case TXC_FRAC:
-        if (node->children_amount == 1)
-            return concat_children_in_paren((const struct txc_node *const *)node->children, node->children_amount, true, "\\frac{1}{", "", "}");
-        else
-            return concat_children_in_paren((const struct txc_node *const *)node->children, node->children_amount, true, "\\frac{", "}{", "}");
+        return node->children_amount == 1 ? &unit_frac : &frac;
+    case TXC_POW:
+        return &power;
+    case TXC_ROOT:
+        return node->children_amount == 1 ? &square_root : &root;
+    case TXC_FACT:
+        return &fact;
+    case TXC_BINOM:
+        return &binom;
+    case TXC_MOD:
+        return &mod;
+    case TXC_FLOOR:
+        return &floor_brackets;
     default:
+        return NULL;
+    }
+}
+
+// The whole string is written into one buffer doubling when full, instead of concatenating the strings of the children on every level.
+struct str_buf {
+    char *str;
+    size_t len;
+    size_t size;
+};
+
+static bool str_reserve(struct str_buf *const buf, const size_t len)
+{
+    while (buf->size - buf->len <= len) {
+        char *const tmp = txc_grow(buf->str, &buf->size, sizeof *buf->str, "node string");
+        if (tmp == NULL)
+            return false;
+        buf->str = tmp;
+    }
+    return true;
+}
+
+static bool str_append(struct str_buf *const buf, const char *const str)
+{
+    const size_t len = strlen(str);
+    if (!str_reserve(buf, len))
+        return false;
+    memcpy(buf->str + buf->len, str, len + 1);
+    buf->len += len;
+    return true;
+}
+
+static bool str_append_leaf(struct str_buf *const buf, const struct txc_node *const node)
+{
+    if (node->type == TXC_NAN) {
+        const size_t len = strlen(TXC_NAN_REASON) + strlen(node->impl.reason);
+        if (!str_reserve(buf, len))
+            return false;
+        buf->len += (size_t)snprintf(buf->str + buf->len, len + 1, TXC_NAN_REASON, node->impl.reason);
+        return true;
+    }
+    if (node->type == TXC_VARIABLE)
+        return str_append(buf, node->impl.name);
+    if (node->type != TXC_INT) {
         TXC_ERROR_INVALID_NODE_TYPE(node->type);
-        return txc_node_to_str(&TXC_NAN_ERROR_INVALID_NODE_TYPE);
+        return str_append_leaf(buf, &TXC_NAN_ERROR_INVALID_NODE_TYPE);
+    }
+    char *const str = txc_int_to_str(node->impl.integer);
+    if (str == NULL)
+        return str_append_leaf(buf, &TXC_NAN_ERROR_ALLOC);
+    const bool success = str_append(buf, str);
+    free(str);
+    return success;
+}
+
+char *txc_node_to_str(const struct txc_node *const node)
+{
+    assert(txc_node_test_valid(node, true));
+    struct str_buf buf = { NULL, 0, 0 };
+    // operations whose children after next are still to be written
+    struct str_frame {
+        const struct txc_node *node;
+        size_t next;
+    } *stack = NULL;
+    size_t used = 0;
+    size_t size = 0;
+    struct str_frame cur = { node, 0 };
+    bool success = str_reserve(&buf, 0);
+    while (success) {
+        const struct notation *const notation = notation_of(cur.node);
+        const size_t amount = cur.node->children_amount;
+        if (cur.next == 0)
+            success = notation == NULL ? str_append_leaf(&buf, cur.node) : str_append(&buf, notation->pre);
+        if (success && notation != NULL && cur.next < amount) {
+            if (cur.next > 0)
+                success = str_append(&buf, notation->op);
+            if (success && used == size) {
+                struct str_frame *const tmp = txc_grow(stack, &size, sizeof *stack, "string stack");
+                success = tmp != NULL;
+                stack = success ? tmp : stack;
+            }
+            if (!success)
+                break;
+            const size_t child = notation->reverse_children ? amount - cur.next - 1 : cur.next;
+            stack[used++] = (struct str_frame){ cur.node, cur.next + 1 };
+            cur = (struct str_frame){ cur.node->children[child], 0 };
+            continue;
+        }
+        if (success && notation != NULL)
+            success = str_append(&buf, notation->post);
+        if (!success || used == 0)
+            break;
+        cur = stack[--used];
+    }
+    free(stack);
+    if (!success) {
+        free(buf.str);
+        return node == &TXC_NAN_ERROR_ALLOC ? NULL : txc_node_to_str(&TXC_NAN_ERROR_ALLOC);
     }
+    return buf.str;
 }
 
 void txc_node_print(const struct txc_node *const node)
@@ -655,11 +3101,91 @@ void txc_node_print_if_debug(const struct txc_node *const node)
 #endif /* DEBUG */
 }
 
-void txc_node_simplify_and_print(const struct txc_node *const node)
+char *txc_node_simplify_to_str(const struct txc_node *const node, bool *const nan)
+{
+    return txc_node_simplify_to_str_and_keep(node, nan, NULL);
+}
+
+char *txc_node_simplify_to_str_and_keep(const struct txc_node *const node, bool *const nan, struct txc_node **const kept)
 {
     assert(txc_node_test_valid(node, true));
-    txc_node_print_if_debug(node);
-    const struct txc_node *const simple_node = txc_node_simplify(node);
-    txc_node_print(simple_node);
+    assert(nan != NULL);
+    *nan = false;
+    const bool nested = in_line;
+    // the tree belongs to the caller, only the hashes and repeated marks are written
+    if (!nested && !cons_build((struct txc_node *)node))
+        cons_clear();
+    struct memo_entry *const line = nested || memo_budget == 0 ? NULL : memo_find(node);
+    if (line != NULL && line->str != NULL) {
+        memo_hit(line);
+        cons_clear();
+        if (kept != NULL)
+            *kept = txc_node_copy(line->simple);
+        return txc_strdup(line->str);
+    }
+    // lines of kept operation types are counted by txc_node_simplify
+    if (!nested && memo_budget != 0 && !memo_worth(node->type))
+        memo_stats.misses++;
+    in_line = true;
+    struct txc_node *const simple_node = txc_node_simplify(node);
+    in_line = nested;
+    if (!nested) {
+        cons_clear();
+        divisor_cache_clear();
+    }
+    *nan = simple_node->type == TXC_NAN;
+    char *const str = txc_node_to_str(simple_node);
+    if (str != NULL && !nested && memo_budget != 0)
+        memo_keep_line(node, simple_node, str);
+    if (kept != NULL && !simple_node->in_arena) {
+        *kept = simple_node;
+        return str;
+    }
+    if (kept != NULL)
+        *kept = txc_node_copy(simple_node);
     txc_node_free(simple_node);
+    return str;
+}
+
+void txc_node_print_str(const char *const str)
+{
+    printf(TXC_PRINT_FORMAT, str == NULL ? TXC_PRINT_ERROR : str);
+}
+
+char *txc_node_line_str(const struct txc_node *const input, const char *const str)
+{
+    assert(txc_node_test_valid(input, true));
+    const char *const result = str == NULL ? TXC_PRINT_ERROR : str;
+    // the format is longer than what replaces its %s
+    size_t len = strlen(TXC_PRINT_FORMAT) + strlen(result);
+#if DEBUG
+    char *const echo = txc_node_to_str(input);
+    const char *const shown = echo == NULL ? TXC_PRINT_ERROR : echo;
+    len += strlen(TXC_PRINT_FORMAT) + strlen(shown);
+#else
+    (void)input;
+#endif /* DEBUG */
+    char *const line = malloc(len + 1);
+    size_t used = 0;
+    if (line == NULL) {
+        TXC_ERROR_ALLOC(len + 1, "printed line");
+    } else {
+#if DEBUG
+        used += (size_t)snprintf(line, len + 1, TXC_PRINT_FORMAT, shown);
+#endif /* DEBUG */
+        snprintf(line + used, len + 1 - used, TXC_PRINT_FORMAT, result);
+    }
+#if DEBUG
+    free(echo);
+#endif /* DEBUG */
+    return line;
+}
+
+void txc_node_simplify_and_print(const struct txc_node *const node)
+{
+    txc_node_print_if_debug(node);
+    bool nan;
+    char *const str = txc_node_simplify_to_str(node, &nan);
+    txc_node_print_str(str);
+    free(str);
 }
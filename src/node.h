@@ -21,6 +21,7 @@
 #include "common.h"
 
 #include <stdbool.h>
+#include <stddef.h>
 
 /* DEFINITIONS */
 
@@ -30,47 +31,140 @@ enum txc_node_type {
     TXC_NEG,
     TXC_ADD,
     TXC_MUL,
-    TXC_FRAC
+    TXC_FRAC,
+    TXC_POW,
+    TXC_ROOT,
+    TXC_FACT,
+    TXC_BINOM,
+    TXC_MOD,
+    TXC_FLOOR,
+    TXC_VARIABLE
 };
 
 union impl {
     char *reason;
     struct txc_int *integer;
+    char *name;
 };
 
 typedef struct txc_node txc_node;
 
+struct txc_node_memo_stats {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    size_t entries;
+    size_t bytes;
+};
+
+// How often txc_node_simplify took a cheaper way than the generic kernels.
+struct txc_node_rewrite_stats {
+    // multiplications and divisions by powers of two done by shifting
+    size_t shifts;
+    // factors of 1 and -1 dropped
+    size_t units;
+    // products with a factor of 0 whose other factors were not evaluated
+    size_t zeros;
+    // quotients of equal integers
+    size_t quotients;
+    // negations of negations cancelled before their operand was evaluated
+    size_t negations;
+};
+
 /* CONSTANTS */
 
 extern const txc_node TXC_NAN_ERROR_ALLOC;
 extern const txc_node TXC_NAN_ERROR_INVALID_NODE_TYPE;
 extern const txc_node TXC_NAN_ERROR_OVERFLOW;
+
+extern const txc_node TXC_NAN_ERROR_UNDEFINED;
 extern const txc_node TXC_NAN_ERROR_NYI;
+extern const txc_node TXC_NAN_ERROR_NOT_REAL;
 extern const txc_node TXC_NAN_ERROR_ZERO_DIVISION;
 extern const txc_node TXC_NAN_UNSPECIFIED;
 
+extern const txc_node TXC_NAN_ERROR_UNKNOWN_VARIABLE;
+extern const txc_node TXC_NAN_ERROR_CYCLIC_DEFINITION;
+
 /* VALID */
 
 extern bool txc_node_test_valid(const txc_node *const node, const bool recursive);
 
+extern bool txc_node_is_nan(const txc_node *const node);
+
 /* MEMORY */
 
 extern struct txc_int *txc_node_to_int(txc_node *const node);
 
+extern enum txc_node_type txc_node_get_type(const txc_node *const node);
+
+extern size_t txc_node_children_amount(const txc_node *const node);
+
+extern const txc_node *txc_node_child(const txc_node *const node, const size_t i);
+
+// NULL unless node is a NAN
+extern const char *txc_node_nan_reason(const txc_node *const node);
+
+// NULL unless node is a VARIABLE
+extern const char *txc_node_variable_name(const txc_node *const node);
+
 extern txc_node *txc_node_create(txc_node *const *const children, const union impl impl, const size_t children_amount, const enum txc_node_type type);
 
 extern txc_node *txc_node_create_nan(const char *const reason);
 
+// A VARIABLE leaf standing for name, which is copied.
+extern txc_node *txc_node_create_variable(const char *const name);
+
+// The operation nodes take ownership of their operands, also when they fail.
 extern txc_node *txc_node_create_un_op(const enum txc_node_type type, txc_node *const operand);
 
 extern txc_node *txc_node_create_bin_op(const enum txc_node_type type, txc_node *const operand_1, txc_node *const operand_2);
 
+// Appends operand to chain if it is an ADD or MUL of type, doubling its children as needed, and creates a binary operation otherwise.
+// chain has to come from txc_node_create_bin_op or txc_node_append, whose children are allocated in powers of two.
+extern txc_node *txc_node_append(const enum txc_node_type type, txc_node *const chain, txc_node *const operand);
+
 extern void txc_node_free(const txc_node *const node);
 
+// The copy is on the heap even while the arena is in use, so it outlives the line.
+extern txc_node *txc_node_copy(const txc_node *const node);
+
+// A copy of node in which every VARIABLE is replaced by a copy of value(name).
+extern txc_node *txc_node_substitute(const txc_node *const node, const txc_node *(*const value)(const char *const name));
+
+// While the arena is in use, new nodes come from it and txc_node_free ignores them.
+// txc_node_arena_release drops all of them at once, integers meant to outlive that need their own txc_int_copy.
+extern void txc_node_arena_init(void);
+
+extern void txc_node_arena_release(void);
+
+extern void txc_node_arena_free(void);
+
+// Folding evaluates operations on integers and fractions of them as soon as they are created, so numeric lines never become a tree.
+// It is off while the arena is in use, as every intermediate value is freed once it is used up.
+extern void txc_node_fold_enable(const bool enable);
+
+// Returns the value of node and frees it if folding applies, node itself otherwise.
+extern txc_node *txc_node_fold(txc_node *const node);
+
+// Keeps simplified fractions, powers, roots, factorials, binomials, moduli, floors and whole lines for later lines.
+// The least recently used entries are evicted to stay within budget bytes, 0 disables it.
+extern void txc_node_memo_init(const size_t budget);
+
+extern void txc_node_memo_free(void);
+
 /* NODE */
 
+// VARIABLEs are replaced by their txc_var_value once the simplification reaches them, so factors of 0 keep others from being evaluated.
 extern txc_node *txc_node_simplify(const txc_node *const node);
 
+// Whether node always evaluates to an integer and never to a NAN, as long as memory suffices and pure(name) holds for its variables.
+extern bool txc_node_pure(const txc_node *const node, bool (*const pure)(const char *const name));
+
+extern struct txc_node_memo_stats txc_node_memo_stats(void);
+
+extern struct txc_node_rewrite_stats txc_node_rewrite_stats(void);
+
 /* PRINT */
 
 extern char *txc_node_to_str(const txc_node *const node);
@@ -79,6 +173,19 @@ extern void txc_node_print(const txc_node *const node);
 
 extern void txc_node_print_if_debug(const txc_node *const node);
 
+// Equal operations of the tree, also sums and products of the same operands in another order, are simplified once.
+// nan is set if the result is a NAN. Returns NULL if rendering failed.
+extern char *txc_node_simplify_to_str(const txc_node *const node, bool *const nan);
+
+// Same as txc_node_simplify_to_str, but also hands out the simplified tree on the heap if kept is not NULL.
+extern char *txc_node_simplify_to_str_and_keep(const txc_node *const node, bool *const nan, txc_node **const kept);
+
+// Prints a line rendered by txc_node_simplify_to_str, or an error for NULL.
+extern void txc_node_print_str(const char *const str);
+
+// The lines txc_node_simplify_and_print prints for input whose result rendered to str, input itself only in debug builds.
+extern char *txc_node_line_str(const txc_node *const input, const char *const str);
+
 extern void txc_node_simplify_and_print(const txc_node *const node);
 
 #endif /* TXC_NODE */
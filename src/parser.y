@@ -16,9 +16,15 @@
  */
 
 %{
+    #include <stdint.h>
     #include <stdio.h>
 
-    extern int yylex(void);
+    #include "cache.h"
+    #include "var.h"
+
+    #define yylex txc_cache_lex
+    // the parser stacks are on the heap, so deeply nested input is only limited by memory and not by the default of 10000
+    #define YYMAXDEPTH (PTRDIFF_MAX / 64)
     extern void yyerror(const char *);
 %}
 
@@ -40,13 +46,19 @@
     txc_node *node;
 }
 
-%token <pascal_str> BIN_INT DEC_INT HEX_INT
+%token <pascal_str> BIN_INT DEC_INT HEX_INT VAR
+%precedence PMOD
 %left PLUS MINUS
-%left CDOT FRAC
-%token L_PAREN R_PAREN L_BRACE R_BRACE
-%token END
+%left CDOT FRAC BMOD
+%precedence UMINUS
+%precedence CARET
+%precedence <pascal_str> CARET_DIGIT
+%precedence BANG
+%token L_PAREN R_PAREN L_BRACE R_BRACE L_BRACKET R_BRACKET LFLOOR RFLOOR SQRT BINOM
+%token EQUALS END
 
-%type <node> expr int
+%type <node> expr int var
+%destructor { txc_node_free($$); } <node>
 
 %start input
 
@@ -59,24 +71,39 @@ input:
 
 line:
   END
-| expr END { txc_node_simplify_and_print($1); }
+| expr END { txc_cache_simplify_and_print($1); txc_node_free($1); txc_node_arena_release(); }
+| var EQUALS expr END { txc_cache_define_and_print($1, $3); txc_node_free($1); txc_node_free($3); txc_node_arena_release(); }
 ;
 
 expr:
   int
-| expr PLUS expr                                 { $$ = txc_node_create_bin_op(TXC_ADD, $1, $3); }
-| expr MINUS expr                                { $$ = txc_node_create_bin_op(TXC_ADD, $1, txc_node_create_un_op(TXC_NEG, $3)); }
-| expr CDOT expr                                 { $$ = txc_node_create_bin_op(TXC_MUL, $1, $3); }
-| FRAC L_BRACE expr R_BRACE L_BRACE expr R_BRACE { $$ = txc_node_create_bin_op(TXC_FRAC, $6, $3); }
-| L_PAREN expr R_PAREN                           { $$ = $2; }
+| var
+| expr PLUS expr                                     { $$ = txc_node_fold(txc_node_append(TXC_ADD, $1, $3)); }
+| expr MINUS expr                                    { $$ = txc_node_fold(txc_node_append(TXC_ADD, $1, txc_node_fold(txc_node_create_un_op(TXC_NEG, $3)))); }
+| expr CDOT expr                                     { $$ = txc_node_fold(txc_node_append(TXC_MUL, $1, $3)); }
+| FRAC L_BRACE expr R_BRACE L_BRACE expr R_BRACE     { $$ = txc_node_fold(txc_node_create_bin_op(TXC_FRAC, $6, $3)); }
+| SQRT L_BRACE expr R_BRACE                          { $$ = txc_node_create_un_op(TXC_ROOT, $3); }
+| SQRT L_BRACKET expr R_BRACKET L_BRACE expr R_BRACE { $$ = txc_node_create_bin_op(TXC_ROOT, $6, $3); }
+| expr CARET L_BRACE expr R_BRACE                    { $$ = txc_node_fold(txc_node_create_bin_op(TXC_POW, $1, $4)); }
+| expr CARET_DIGIT                                   { $$ = txc_node_fold(txc_node_create_bin_op(TXC_POW, $1, txc_int_create_int_node($2.str, $2.len, 10))); }
+| expr BMOD expr                                     { $$ = txc_node_fold(txc_node_create_bin_op(TXC_MOD, $1, $3)); }
+| expr PMOD L_BRACE expr R_BRACE                     { $$ = txc_node_fold(txc_node_create_bin_op(TXC_MOD, $1, $4)); }
+| expr BANG                                          { $$ = txc_node_fold(txc_node_create_un_op(TXC_FACT, $1)); }
+| BINOM L_BRACE expr R_BRACE L_BRACE expr R_BRACE    { $$ = txc_node_fold(txc_node_create_bin_op(TXC_BINOM, $3, $6)); }
+| MINUS expr %prec UMINUS                            { $$ = txc_node_fold(txc_node_create_un_op(TXC_NEG, $2)); }
+| PLUS expr %prec UMINUS                             { $$ = $2; }
+| L_PAREN expr R_PAREN                               { $$ = $2; }
+| LFLOOR expr RFLOOR                                 { $$ = txc_node_fold(txc_node_create_un_op(TXC_FLOOR, $2)); }
 ;
 
 int:
-  BIN_INT   { $$ = txc_int_create_int_node($1.str, $1.len, 2); }
-| DEC_INT   { $$ = txc_int_create_int_node($1.str, $1.len, 10); }
-| HEX_INT   { $$ = txc_int_create_int_node($1.str, $1.len, 16); }
-| MINUS int { $$ = txc_node_create_un_op(TXC_NEG, $2); }
-| PLUS int  { $$ = $2; }
+  BIN_INT { $$ = txc_int_create_int_node($1.str, $1.len, 2); }
+| DEC_INT { $$ = txc_int_create_int_node($1.str, $1.len, 10); }
+| HEX_INT { $$ = txc_int_create_int_node($1.str, $1.len, 16); }
+;
+
+var:
+  VAR { $$ = txc_var_reference($1.str, $1.len); }
 ;
 
 %%
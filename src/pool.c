@@ -0,0 +1,269 @@
+/*
+ *     Copyright (C) 2024 - 2025  Einholz
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU Affero General Public License as published
+ *     by the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU Affero General Public License for more details.
+ *
+ *     You should have received a copy of the GNU Affero General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef TXC_THREADS
+#include <pthread.h>
+#endif /* TXC_THREADS */
+
+#include "pool.h"
+#include "util.h"
+
+/* DEFINITIONS */
+
+#ifdef TXC_THREADS
+struct deque {
+    struct txc_pool_task *newest;
+    struct txc_pool_task *oldest;
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t finished = PTHREAD_COND_INITIALIZER;
+static pthread_key_t self_key;
+static bool self_key_created = false;
+static pthread_t *workers = NULL;
+// index 0 is shared by all threads not belonging to the pool
+static struct deque *deques = NULL;
+static size_t *indices = NULL;
+static size_t queued = 0;
+static bool stopping = false;
+#endif /* TXC_THREADS */
+static size_t worker_amount = 0;
+
+/* POOL */
+
+#ifdef TXC_THREADS
+static size_t self_index(void)
+{
+    const size_t *const self = pthread_getspecific(self_key);
+    return self == NULL ? 0 : *self;
+}
+
+static void push_locked(struct deque *const deque, struct txc_pool_task *const task)
+{
+    task->older = deque->newest;
+    task->newer = NULL;
+    if (deque->newest != NULL)
+        deque->newest->newer = task;
+    else
+        deque->oldest = task;
+    deque->newest = task;
+    queued++;
+}
+
+static struct txc_pool_task *pop_newest_locked(struct deque *const deque)
+{
+    struct txc_pool_task *const task = deque->newest;
+    if (task == NULL)
+        return NULL;
+    deque->newest = task->older;
+    if (deque->newest != NULL)
+        deque->newest->newer = NULL;
+    else
+        deque->oldest = NULL;
+    queued--;
+    return task;
+}
+
+static struct txc_pool_task *steal_oldest_locked(struct deque *const deque)
+{
+    struct txc_pool_task *const task = deque->oldest;
+    if (task == NULL)
+        return NULL;
+    deque->oldest = task->newer;
+    if (deque->oldest != NULL)
+        deque->oldest->older = NULL;
+    else
+        deque->newest = NULL;
+    queued--;
+    return task;
+}
+
+// Own work is taken newest first to stay cache local, stolen work oldest first as it is usually the largest.
+static struct txc_pool_task *find_locked(const size_t self)
+{
+    if (queued == 0)
+        return NULL;
+    struct txc_pool_task *const own = pop_newest_locked(&deques[self]);
+    if (own != NULL)
+        return own;
+    for (size_t i = 1; i <= worker_amount; i++) {
+        struct txc_pool_task *const stolen = steal_oldest_locked(&deques[(self + i) % (worker_amount + 1)]);
+        if (stolen != NULL)
+            return stolen;
+    }
+    return NULL;
+}
+
+// Expects lock to be held and releases it while running the task.
+static void run_locked(struct txc_pool_task *const task)
+{
+    pthread_mutex_unlock(&lock);
+    task->fun(task->arg);
+    pthread_mutex_lock(&lock);
+    task->done = true;
+    pthread_cond_broadcast(&finished);
+}
+
+static void *worker(void *const arg)
+{
+    const size_t self = *(const size_t *)arg;
+    pthread_setspecific(self_key, arg);
+    pthread_mutex_lock(&lock);
+    while (true) {
+        while (queued == 0 && !stopping)
+            pthread_cond_wait(&work, &lock);
+        struct txc_pool_task *const task = find_locked(self);
+        if (task == NULL)
+            break;
+        run_locked(task);
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+#endif /* TXC_THREADS */
+
+size_t txc_pool_threads(void)
+{
+    return worker_amount + 1;
+}
+
+void txc_pool_submit(struct txc_pool_task *const task, void (*const fun)(void *), void *const arg)
+{
+    assert(task != NULL);
+    assert(fun != NULL);
+    task->fun = fun;
+    task->arg = arg;
+    task->older = NULL;
+    task->newer = NULL;
+    task->done = false;
+#ifdef TXC_THREADS
+    if (worker_amount > 0) {
+        pthread_mutex_lock(&lock);
+        push_locked(&deques[self_index()], task);
+        pthread_cond_signal(&work);
+        pthread_mutex_unlock(&lock);
+        return;
+    }
+#endif /* TXC_THREADS */
+    fun(arg);
+    task->done = true;
+}
+
+void txc_pool_wait(struct txc_pool_task *const task)
+{
+    assert(task != NULL);
+#ifdef TXC_THREADS
+    if (worker_amount == 0) {
+        assert(task->done);
+        return;
+    }
+    const size_t self = self_index();
+    pthread_mutex_lock(&lock);
+    while (!task->done) {
+        struct txc_pool_task *const other = find_locked(self);
+        if (other != NULL)
+            run_locked(other);
+        else
+            pthread_cond_wait(&finished, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+#else /* TXC_THREADS */
+    assert(task->done);
+#endif /* TXC_THREADS */
+}
+
+/* MEMORY */
+
+bool txc_pool_init(const size_t threads)
+{
+    txc_pool_free();
+    if (threads <= 1)
+        return true;
+#ifdef TXC_THREADS
+    const size_t amount = threads - 1;
+    if (amount > SIZE_MAX / sizeof *deques - 1) {
+        TXC_ERROR_OVERFLOW("thread pool size");
+        return false;
+    }
+    if (!self_key_created) {
+        if (pthread_key_create(&self_key, NULL) != 0) {
+            TXC_ERROR_THREAD("thread pool key");
+            return false;
+        }
+        self_key_created = true;
+    }
+    workers = malloc(sizeof *workers * amount);
+    deques = malloc(sizeof *deques * (amount + 1));
+    indices = malloc(sizeof *indices * (amount + 1));
+    if (workers == NULL || deques == NULL || indices == NULL) {
+        TXC_ERROR_ALLOC(sizeof *workers * amount + (sizeof *deques + sizeof *indices) * (amount + 1), "thread pool");
+        free(workers);
+        free(deques);
+        free(indices);
+        workers = NULL;
+        deques = NULL;
+        indices = NULL;
+        return false;
+    }
+    for (size_t i = 0; i <= amount; i++) {
+        deques[i].newest = NULL;
+        deques[i].oldest = NULL;
+        indices[i] = i;
+    }
+    for (; worker_amount < amount; worker_amount++) {
+        if (pthread_create(&workers[worker_amount], NULL, &worker, &indices[worker_amount + 1]) != 0) {
+            TXC_ERROR_THREAD("thread pool worker");
+            return false;
+        }
+    }
+    return true;
+#else /* TXC_THREADS */
+    TXC_ERROR_NYI("Threads in this environment");
+    return false;
+#endif /* TXC_THREADS */
+}
+
+void txc_pool_free(void)
+{
+#ifdef TXC_THREADS
+    if (workers == NULL)
+        return;
+    pthread_mutex_lock(&lock);
+    stopping = true;
+    pthread_cond_broadcast(&work);
+    pthread_mutex_unlock(&lock);
+    for (size_t i = 0; i < worker_amount; i++)
+        pthread_join(workers[i], NULL);
+    assert(queued == 0);
+    free(workers);
+    free(deques);
+    free(indices);
+    workers = NULL;
+    deques = NULL;
+    indices = NULL;
+    worker_amount = 0;
+    stopping = false;
+#endif /* TXC_THREADS */
+}
@@ -0,0 +1,55 @@
+/*
+ *     Copyright (C) 2024 - 2025  Einholz
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU Affero General Public License as published
+ *     by the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU Affero General Public License for more details.
+ *
+ *     You should have received a copy of the GNU Affero General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TXC_POOL
+#define TXC_POOL
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* DEFINITIONS */
+
+// Owned by the caller (usually on its stack) until txc_pool_wait returned.
+struct txc_pool_task {
+    void (*fun)(void *arg);
+    void *arg;
+    struct txc_pool_task *older;
+    struct txc_pool_task *newer;
+    bool done;
+};
+
+/* MEMORY */
+
+// threads includes the calling thread, so 0 or 1 disables the pool.
+extern bool txc_pool_init(const size_t threads);
+
+extern void txc_pool_free(void);
+
+/* POOL */
+
+extern size_t txc_pool_threads(void);
+
+// Pushes onto the deque of the calling thread, idle threads steal the oldest tasks of others.
+// Runs fun(arg) inline if the pool is disabled.
+extern void txc_pool_submit(struct txc_pool_task *const task, void (*const fun)(void *), void *const arg);
+
+// Executes other queued tasks while waiting, so tasks may submit and wait for subtasks themselves.
+extern void txc_pool_wait(struct txc_pool_task *const task);
+
+#endif /* TXC_POOL */
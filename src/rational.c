@@ -0,0 +1,418 @@
+/*
+ *     Copyright (C) 2024  Einholz
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU Affero General Public License as published
+ *     by the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU Affero General Public License for more details.
+ *
+ *     You should have received a copy of the GNU Affero General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "integer.h"
+#include "node.h"
+#include "rational.h"
+#include "util.h"
+
+// in bits of numerator and denominator together, smaller operands are combined without any gcd and the result is reduced only once it gets bigger
+#ifndef TXC_RAT_LAZY_BITS
+#define TXC_RAT_LAZY_BITS 128
+#endif /* TXC_RAT_LAZY_BITS */
+
+/* DEFINITIONS */
+
+struct txc_rat {
+    // carries the sign
+    struct txc_int *num;
+    // always positive
+    struct txc_int *den;
+    bool reduced;
+};
+
+/* VALID */
+
+bool txc_rat_test_valid(const struct txc_rat *const rat)
+{
+    if (rat == NULL) {
+        TXC_ERROR_NULL("txc_rat");
+        return false;
+    }
+    if (!txc_int_test_valid(rat->num) || !txc_int_test_valid(rat->den))
+        return false;
+    if (txc_int_is_zero(rat->den) || txc_int_is_neg(rat->den)) {
+        TXC_ERROR_NYI("Non positive denominators");
+        return false;
+    }
+    return true;
+}
+
+/* MEMORY */
+
+struct txc_rat *txc_rat_create(struct txc_int *const num, struct txc_int *const den)
+{
+    struct txc_rat *const rat = malloc(sizeof *rat);
+    if (rat == NULL || num == NULL || den == NULL) {
+        if (rat == NULL)
+            TXC_ERROR_ALLOC(sizeof *rat, "rational");
+        txc_int_free(num);
+        txc_int_free(den);
+        free(rat);
+        return NULL;
+    }
+    assert(!txc_int_is_zero(den));
+    rat->num = num;
+    rat->den = den;
+    rat->reduced = txc_int_is_pos_one(den);
+    if (txc_int_is_neg(den)) {
+        rat->num = txc_int_neg(num);
+        rat->den = txc_int_neg(den);
+        if (rat->num == NULL || rat->den == NULL) {
+            txc_int_free(rat->num);
+            txc_int_free(rat->den);
+            free(rat);
+            return NULL;
+        }
+    }
+    assert(txc_rat_test_valid(rat));
+    return rat;
+}
+
+static struct txc_rat *copy(const struct txc_rat *const from)
+{
+    if (from == NULL)
+        return NULL;
+    assert(txc_rat_test_valid(from));
+    struct txc_rat *const rat = txc_rat_create(txc_int_copy(from->num), txc_int_copy(from->den));
+    if (rat != NULL)
+        rat->reduced = from->reduced;
+    return rat;
+}
+
+void txc_rat_free(const struct txc_rat *const rat)
+{
+    if (rat == NULL)
+        return;
+    txc_int_free(rat->num);
+    txc_int_free(rat->den);
+    free((struct txc_rat *)rat);
+}
+
+static struct txc_rat *reduce(struct txc_rat *const rat);
+
+// INT for denominators of 1, otherwise a FRAC with a NEG around it for negative values
+struct txc_node *txc_rat_to_node(struct txc_rat *const rat)
+{
+    if (reduce(rat) == NULL)
+        return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+    struct txc_int *num = rat->num;
+    struct txc_int *const den = rat->den;
+    free(rat);
+    if (txc_int_is_pos_one(den)) {
+        txc_int_free(den);
+        return txc_int_to_node(num);
+    }
+    const bool neg = txc_int_is_neg(num);
+    if (neg)
+        num = txc_int_neg(num);
+    if (num == NULL) {
+        txc_int_free(den);
+        return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+    }
+    union impl impl;
+    impl.integer = NULL;
+    struct txc_node *children[] = { txc_int_to_node(den), NULL };
+    size_t children_amount = 1;
+    if (txc_int_is_pos_one(num)) {
+        txc_int_free(num);
+    } else {
+        children[1] = txc_int_to_node(num);
+        children_amount = 2;
+    }
+    if (txc_node_is_nan(children[0]) || (children[1] != NULL && txc_node_is_nan(children[1]))) {
+        txc_node_free(children[0]);
+        txc_node_free(children[1]);
+        return (struct txc_node *)&TXC_NAN_ERROR_ALLOC;
+    }
+    struct txc_node *const frac = txc_node_create(children, impl, children_amount, TXC_FRAC);
+    if (txc_node_is_nan(frac)) {
+        txc_node_free(children[0]);
+        txc_node_free(children[1]);
+        return frac;
+    }
+    if (!neg)
+        return frac;
+    struct txc_node *const neg_node = txc_node_create(&frac, impl, 1, TXC_NEG);
+    if (txc_node_is_nan(neg_node))
+        txc_node_free(frac);
+    return neg_node;
+}
+
+/* RATIONAL */
+
+// Frees rat if it fails.
+struct txc_rat *txc_rat_neg(struct txc_rat *const rat)
+{
+    if (rat == NULL)
+        return NULL;
+    assert(txc_rat_test_valid(rat));
+    rat->num = txc_int_neg(rat->num);
+    if (rat->num == NULL) {
+        txc_rat_free(rat);
+        return NULL;
+    }
+    return rat;
+}
+
+// Frees rat if it fails.
+struct txc_rat *txc_rat_inv(struct txc_rat *const rat)
+{
+    if (rat == NULL)
+        return NULL;
+    assert(txc_rat_test_valid(rat));
+    assert(!txc_int_is_zero(rat->num));
+    struct txc_int *const num = rat->num;
+    rat->num = rat->den;
+    rat->den = num;
+    if (txc_int_is_neg(num)) {
+        rat->num = txc_int_neg(rat->num);
+        rat->den = txc_int_neg(rat->den);
+        if (rat->num == NULL || rat->den == NULL) {
+            txc_rat_free(rat);
+            return NULL;
+        }
+    }
+    return rat;
+}
+
+static struct txc_int *abs_gcd(const struct txc_int *const a, const struct txc_int *const b)
+{
+    struct txc_int *const gcd = txc_int_gcd(a, b);
+    return gcd != NULL && txc_int_is_neg(gcd) ? txc_int_neg(gcd) : gcd;
+}
+
+// Frees rat if it fails.
+static struct txc_rat *reduce(struct txc_rat *const rat)
+{
+    if (rat == NULL)
+        return NULL;
+    assert(txc_rat_test_valid(rat));
+    if (rat->reduced)
+        return rat;
+    struct txc_int *const gcd = abs_gcd(rat->num, rat->den);
+    if (gcd == NULL) {
+        txc_rat_free(rat);
+        return NULL;
+    }
+    if (!txc_int_is_pos_one(gcd)) {
+        // both divisions share the reciprocal of the gcd
+        const txc_int_divisor *const divisor = txc_int_divisor_create(gcd);
+        struct txc_int *const num = txc_int_divisor_div(rat->num, divisor);
+        struct txc_int *const den = txc_int_divisor_div(rat->den, divisor);
+        txc_int_divisor_free(divisor);
+        txc_int_free(rat->num);
+        txc_int_free(rat->den);
+        rat->num = num;
+        rat->den = den;
+    }
+    txc_int_free(gcd);
+    if (rat->num == NULL || rat->den == NULL) {
+        txc_rat_free(rat);
+        return NULL;
+    }
+    rat->reduced = true;
+    return rat;
+}
+
+static struct txc_int *mul_2(const struct txc_int *const a, const struct txc_int *const b)
+{
+    if (a == NULL || b == NULL)
+        return NULL;
+    const struct txc_int *const factors[2] = { a, b };
+    return txc_int_mul(factors, 2);
+}
+
+static struct txc_int *add_2(const struct txc_int *const a, const struct txc_int *const b)
+{
+    if (a == NULL || b == NULL)
+        return NULL;
+    const struct txc_int *const summands[2] = { a, b };
+    return txc_int_add(summands, 2);
+}
+
+static bool small(const struct txc_rat *const a, const struct txc_rat *const b)
+{
+    return txc_int_bit_length(a->num) + txc_int_bit_length(a->den) + txc_int_bit_length(b->num) + txc_int_bit_length(b->den) <= TXC_RAT_LAZY_BITS;
+}
+
+// Reduced copies of operands that are not reduced yet, so Henrici's formulas apply.
+static bool reduced_operands(const struct txc_rat *const a, const struct txc_rat *const b, const struct txc_rat **const ra, const struct txc_rat **const rb, struct txc_rat **const owned)
+{
+    owned[0] = a->reduced ? NULL : reduce(copy(a));
+    owned[1] = b->reduced ? NULL : reduce(copy(b));
+    *ra = a->reduced ? a : owned[0];
+    *rb = b->reduced ? b : owned[1];
+    return *ra != NULL && *rb != NULL;
+}
+
+// Henrici: with g = gcd(b, d), t = a * (d / g) + c * (b / g) and h = gcd(t, g) the sum a / b + c / d is (t / h) / ((b / g) * (d / h)) in lowest terms.
+static struct txc_rat *sum_pair(const struct txc_rat *const a, const struct txc_rat *const b)
+{
+    if (small(a, b) || txc_int_cmp(a->den, b->den) == 0) {
+        struct txc_rat *sum;
+        if (txc_int_cmp(a->den, b->den) == 0) {
+            sum = txc_rat_create(add_2(a->num, b->num), txc_int_copy(a->den));
+        } else {
+            struct txc_int *const ad = mul_2(a->num, b->den);
+            struct txc_int *const cb = mul_2(b->num, a->den);
+            sum = txc_rat_create(add_2(ad, cb), mul_2(a->den, b->den));
+            txc_int_free(ad);
+            txc_int_free(cb);
+        }
+        if (sum == NULL || small(sum, sum))
+            return sum;
+        return reduce(sum);
+    }
+    const struct txc_rat *ra;
+    const struct txc_rat *rb;
+    struct txc_rat *owned[2];
+    struct txc_rat *sum = NULL;
+    if (reduced_operands(a, b, &ra, &rb, owned)) {
+        struct txc_int *const g = abs_gcd(ra->den, rb->den);
+        struct txc_int *const b_g = g == NULL ? NULL : txc_int_div(ra->den, g);
+        struct txc_int *const d_g = g == NULL ? NULL : txc_int_div(rb->den, g);
+        struct txc_int *const ad = mul_2(ra->num, d_g);
+        struct txc_int *const cb = mul_2(rb->num, b_g);
+        struct txc_int *const t = add_2(ad, cb);
+        struct txc_int *const h = t == NULL ? NULL : abs_gcd(t, g);
+        struct txc_int *const d_h = h == NULL ? NULL : txc_int_div(rb->den, h);
+        sum = txc_rat_create(h == NULL ? NULL : txc_int_div(t, h), mul_2(b_g, d_h));
+        if (sum != NULL)
+            sum->reduced = true;
+        txc_int_free(g);
+        txc_int_free(b_g);
+        txc_int_free(d_g);
+        txc_int_free(ad);
+        txc_int_free(cb);
+        txc_int_free(t);
+        txc_int_free(h);
+        txc_int_free(d_h);
+    }
+    txc_rat_free(owned[0]);
+    txc_rat_free(owned[1]);
+    return sum;
+}
+
+// Sets num / den to the sum of the terms over the product of their denominators, equal denominators of both halves are only taken once.
+// Both are NULL if it fails.
+static bool sum_tree(const struct txc_rat *const *const terms, const size_t len, struct txc_int **const num, struct txc_int **const den)
+{
+    if (len == 1) {
+        *num = txc_int_copy(terms[0]->num);
+        *den = txc_int_copy(terms[0]->den);
+    } else {
+        struct txc_int *low_num;
+        struct txc_int *low_den;
+        struct txc_int *high_num;
+        struct txc_int *high_den;
+        const bool low = sum_tree(terms, len / 2, &low_num, &low_den);
+        const bool high = sum_tree(terms + len / 2, len - len / 2, &high_num, &high_den);
+        *num = NULL;
+        *den = NULL;
+        if (low && high && txc_int_cmp(low_den, high_den) == 0) {
+            *num = add_2(low_num, high_num);
+            *den = low_den;
+            low_den = NULL;
+        } else if (low && high) {
+            struct txc_int *const ad = mul_2(low_num, high_den);
+            struct txc_int *const cb = mul_2(high_num, low_den);
+            *num = add_2(ad, cb);
+            *den = mul_2(low_den, high_den);
+            txc_int_free(ad);
+            txc_int_free(cb);
+        }
+        txc_int_free(low_num);
+        txc_int_free(low_den);
+        txc_int_free(high_num);
+        txc_int_free(high_den);
+    }
+    if (*num != NULL && *den != NULL)
+        return true;
+    txc_int_free(*num);
+    txc_int_free(*den);
+    *num = NULL;
+    *den = NULL;
+    return false;
+}
+
+// Adding many terms pairwise reduces after every step, a product tree of the denominators only needs a single gcd at the end.
+// Two terms are added with Henrici's formula instead, whose gcds are of smaller operands than the one of the whole sum.
+struct txc_rat *txc_rat_sum(const struct txc_rat *const *const terms, const size_t len)
+{
+    if (len == 0)
+        return txc_rat_create(txc_int_create_zero(), txc_int_create_one());
+    if (terms == NULL)
+        return NULL;
+    for (size_t i = 0; i < len; i++) {
+        if (terms[i] == NULL)
+            return NULL;
+        assert(txc_rat_test_valid(terms[i]));
+    }
+    if (len == 2)
+        return sum_pair(terms[0], terms[1]);
+    struct txc_int *num;
+    struct txc_int *den;
+    if (!sum_tree(terms, len, &num, &den))
+        return NULL;
+    return reduce(txc_rat_create(num, den));
+}
+
+// Henrici: with g = gcd(a, d) and h = gcd(c, b) the product a / b * c / d is ((a / g) * (c / h)) / ((b / h) * (d / g)) in lowest terms.
+struct txc_rat *txc_rat_mul(const struct txc_rat *const a, const struct txc_rat *const b)
+{
+    if (a == NULL || b == NULL)
+        return NULL;
+    assert(txc_rat_test_valid(a));
+    assert(txc_rat_test_valid(b));
+    if (small(a, b)) {
+        struct txc_rat *const product = txc_rat_create(mul_2(a->num, b->num), mul_2(a->den, b->den));
+        if (product == NULL || small(product, product))
+            return product;
+        return reduce(product);
+    }
+    const struct txc_rat *ra;
+    const struct txc_rat *rb;
+    struct txc_rat *owned[2];
+    struct txc_rat *product = NULL;
+    if (reduced_operands(a, b, &ra, &rb, owned)) {
+        struct txc_int *const g = abs_gcd(ra->num, rb->den);
+        struct txc_int *const h = abs_gcd(rb->num, ra->den);
+        struct txc_int *const a_g = g == NULL ? NULL : txc_int_div(ra->num, g);
+        struct txc_int *const d_g = g == NULL ? NULL : txc_int_div(rb->den, g);
+        struct txc_int *const c_h = h == NULL ? NULL : txc_int_div(rb->num, h);
+        struct txc_int *const b_h = h == NULL ? NULL : txc_int_div(ra->den, h);
+        product = txc_rat_create(mul_2(a_g, c_h), mul_2(b_h, d_g));
+        if (product != NULL)
+            product->reduced = true;
+        txc_int_free(g);
+        txc_int_free(h);
+        txc_int_free(a_g);
+        txc_int_free(d_g);
+        txc_int_free(c_h);
+        txc_int_free(b_h);
+    }
+    txc_rat_free(owned[0]);
+    txc_rat_free(owned[1]);
+    return product;
+}
@@ -0,0 +1,58 @@
+/*
+ *     Copyright (C) 2024  Einholz
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU Affero General Public License as published
+ *     by the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU Affero General Public License for more details.
+ *
+ *     You should have received a copy of the GNU Affero General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TXC_RATIONAL
+#define TXC_RATIONAL
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "integer.h"
+#include "node.h"
+
+/* DEFINITIONS */
+
+typedef struct txc_rat txc_rat;
+
+/* VALID */
+
+extern bool txc_rat_test_valid(const txc_rat *const rat);
+
+/* MEMORY */
+
+// Takes ownership of both integers, also if it fails. The denominator must not be 0.
+extern txc_rat *txc_rat_create(txc_int *const num, txc_int *const den);
+
+extern void txc_rat_free(const txc_rat *const rat);
+
+// Takes ownership of rat, which is reduced first.
+extern txc_node *txc_rat_to_node(txc_rat *const rat);
+
+/* RATIONAL */
+
+extern txc_rat *txc_rat_neg(txc_rat *const rat);
+
+// rat must not be 0
+extern txc_rat *txc_rat_inv(txc_rat *const rat);
+
+extern txc_rat *txc_rat_sum(const txc_rat *const *const terms, const size_t len);
+
+extern txc_rat *txc_rat_mul(const txc_rat *const a, const txc_rat *const b);
+
+#endif /* TXC_RATIONAL */
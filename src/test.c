@@ -22,11 +22,16 @@
 #include <string.h>
 #include <sys/wait.h>
 
+#include "cache.h"
+#include "flat.h"
 #include "integer.h"
 #include "node.h"
 #include "parser.h"
+#include "pool.h"
+#include "rational.h"
 #include "test.h"
 #include "util.h"
+#include "var.h"
 
 #define FUN(name) { *name, #name }
 
@@ -34,6 +39,8 @@
     else if (strcmp(name, #test) == 0) \
         ec = fork_test(&test);
 
+#define TXC_TEST_CACHE "texalc-test.cache"
+
 #ifndef TXC_BUF_SIZE
 #define TXC_BUF_SIZE 1024
 #endif /* TXC_BUF_SIZE */
@@ -55,6 +62,8 @@
 #define SIGNED_ADD_SOL "11111111222222223333333344444444555555556666666677777777888888889999999895894228432287293388506727316378868799631934918954323291964257619084693954932638000675873187263480170109800023662907847404519880476082940100232147322492776286"
 #define MUL_SOL "169350886551847025351832376500990702638926992872021541990550229385764480666443954620727122692539576421015350243734673536666653866729396898201004310585209594435286810069303568709210557326982963130851676763413581558443578795873115592910919779691911148276175667700944954397952321203102794641797091078746751182609160188237766491908753577450918900539229077851525582987958024530931747900325877049613035287995732265235660054809402532628592977406438503340547869801425036332338671990845012323610950305038127153995675360977548949584684778565074291984307606257594500433108529378185427348210348209590545241596666550329727911125652169401277956953386881018821711265407436265166815012041919282718363116717271448004304277408276100601462379515523612833354978056982494621003257578343632488899292157630632065255366196500859562680381003219723172796429522542662261391408826326384256351949283574595399553665260238357077597088374941062575920265619201357183467154234763614992374494943445825977845487436176364888647334729213371656976047160709297372472531171578789649078543127709608878474182093837204987832901201341261802484118524255098304545934285828335006845456312037640"
 #define NEG_MUL_SOL "(-169350886551847025351832376500990702638926992872021541990550229385764480666443954620727122692539576421015350243734673536666653866729396898201004310585209594435286810069303568709210557326982963130851676763413581558443578795873115592910919779691911148276175667700944954397952321203102794641797091078746751182609160188237766491908753577450918900539229077851525582987958024530931747900325877049613035287995732265235660054809402532628592977406438503340547869801425036332338671990845012323610950305038127153995675360977548949584684778565074291984307606257594500433108529378185427348210348209590545241596666550329727911125652169401277956953386881018821711265407436265166815012041919282718363116717271448004304277408276100601462379515523612833354978056982494621003257578343632488899292157630632065255366196500859562680381003219723172796429522542662261391408826326384256351949283574595399553665260238357077597088374941062575920265619201357183467154234763614992374494943445825977845487436176364888647334729213371656976047160709297372472531171578789649078543127709608878474182093837204987832901201341261802484118524255098304545934285828335006845456312037640)"
+#define PARALLEL_DIGITS 20000
+#define PARALLEL_THREADS 4
 #define DIVISOR "2688811131697455799312686635590409314476653708480527751110523555767208122010442771791153338445280213913034380290994023971"
 #define DIV_SOL "4591501"
 #define REASON_DUMMY "dummy reason"
@@ -161,7 +170,9 @@ static int parser(const char *const input, const char *const expected)
         goto error_cleanup;
     }
     close_fds[3] = -1;
+    txc_node_arena_init();
     yyparse();
+    txc_node_arena_free();
     const int i_flush_res = fflush(stdin);
     if (i_flush_res != 0)
         TXC_TEST_WARN_FFLUSH();
@@ -550,6 +561,578 @@ static void integer_signed_mul(void)
     exit(integer_add_mul(SIGNED_MUL, operands_node_2, ZERO));
 }
 
+static txc_int *integer_pattern(const size_t len, const unsigned int seed)
+{
+    char *const str = malloc(len);
+    if (str == NULL)
+        return NULL;
+    for (size_t i = 0; i < len; i++)
+        str[i] = "0123456789ABCDEF"[(i * i + seed * i + seed) % 16];
+    str[0] = 'F';
+    txc_node *const node = txc_int_create_int_node(str, len, 16);
+    free(str);
+    txc_int *const integer = txc_int_copy(txc_node_to_int(node));
+    txc_node_free(node);
+    return integer;
+}
+
+static void integer_mul_parallel(void)
+{
+    int ec = 0;
+    txc_int *const a = integer_pattern(PARALLEL_DIGITS, 3);
+    txc_int *const b = integer_pattern(PARALLEL_DIGITS - 7, 5);
+    const txc_int *const one = txc_int_create_one();
+    const txc_int *const b_one_summands[2] = { b, one };
+    const txc_int *const b_one = txc_int_add(b_one_summands, 2);
+    if (!txc_int_test_valid(a) || !txc_int_test_valid(b) || !txc_int_test_valid(b_one)) {
+        ec = 1;
+        goto clean_input;
+    }
+    const txc_int *const factors[2] = { a, b };
+    const txc_int *const serial = txc_int_mul(factors, 2);
+    if (!txc_pool_init(PARALLEL_THREADS) || txc_pool_threads() != PARALLEL_THREADS) {
+        ec = 2;
+        goto clean_serial;
+    }
+    const txc_int *const parallel = txc_int_mul(factors, 2);
+    const txc_int *const one_factors[2] = { a, b_one };
+    const txc_int *const parallel_one = txc_int_mul(one_factors, 2);
+    txc_pool_free();
+    if (!txc_int_test_valid(serial) || !txc_int_test_valid(parallel) || !txc_int_test_valid(parallel_one)) {
+        ec = 3;
+        goto clean_parallel;
+    }
+    if (txc_int_cmp(serial, parallel) != 0) {
+        ec = 4;
+        goto clean_parallel;
+    }
+    // a * (b + 1) = a * b + a
+    const txc_int *const check_summands[2] = { parallel, a };
+    const txc_int *const check = txc_int_add(check_summands, 2);
+    if (txc_int_cmp(check, parallel_one) != 0)
+        ec = 5;
+    txc_int_free(check);
+clean_parallel:
+    txc_int_free(parallel);
+    txc_int_free(parallel_one);
+clean_serial:
+    txc_int_free(serial);
+clean_input:
+    txc_int_free(a);
+    txc_int_free(b);
+    txc_int_free(one);
+    txc_int_free(b_one);
+    exit(ec);
+}
+
+static void integer_dec_parallel(void)
+{
+    int ec = 0;
+    char *const str = malloc(PARALLEL_DIGITS + 1);
+    if (str == NULL)
+        exit(1);
+    // long zero runs cross the chunk borders
+    for (size_t i = 0; i < PARALLEL_DIGITS; i++)
+        str[i] = (i / 1000) % 3 == 1 ? '0' : '0' + (i * i + 7 * i + 1) % 10;
+    str[0] = '9';
+    str[PARALLEL_DIGITS] = 0;
+    if (!txc_pool_init(PARALLEL_THREADS)) {
+        ec = 2;
+        goto clean_str;
+    }
+    txc_node *const node = txc_int_create_int_node(str, PARALLEL_DIGITS, 10);
+    if (!txc_node_test_valid(node, true)) {
+        ec = 3;
+        goto clean_pool;
+    }
+    char *const result = txc_int_to_str(txc_node_to_int(node));
+    if (result == NULL) {
+        ec = 4;
+        goto clean_node;
+    }
+    if (strcmp(result, str) != 0)
+        ec = 5;
+    free(result);
+clean_node:
+    txc_node_free(node);
+clean_pool:
+    txc_pool_free();
+clean_str:
+    free(str);
+    exit(ec);
+}
+
+static void integer_pow(void)
+{
+    int ec = 0;
+    const size_t exponents[] = { 0, 1, 2, 5, 16, 33, 100 };
+    txc_node *const even_node = txc_int_create_int_node("F0A300", 6, 16);
+    txc_int *const bases[4] = { integer_pattern(60, 7), integer_pattern(60, 7), txc_int_copy(txc_node_to_int(even_node)), txc_int_create_one() };
+    txc_node_free(even_node);
+    txc_int_neg(bases[1]);
+    txc_int_neg(bases[3]);
+    for (size_t i = 0; i < 4 && ec == 0; i++) {
+        if (!txc_int_test_valid(bases[i])) {
+            ec = 1;
+            break;
+        }
+        txc_int *expected = txc_int_create_one();
+        size_t done = 0;
+        for (size_t j = 0; j < sizeof exponents / sizeof *exponents && ec == 0; j++) {
+            for (; done < exponents[j]; done++) {
+                const txc_int *const factors[2] = { expected, bases[i] };
+                txc_int *const tmp = txc_int_mul(factors, 2);
+                txc_int_free(expected);
+                expected = tmp;
+            }
+            txc_int *const power = txc_int_pow(bases[i], exponents[j]);
+            if (!txc_int_test_valid(power) || !txc_int_test_valid(expected))
+                ec = 2;
+            else if (txc_int_cmp(power, expected) != 0)
+                ec = 3;
+            txc_int_free(power);
+        }
+        txc_int_free(expected);
+    }
+    for (size_t i = 0; i < 4; i++)
+        txc_int_free(bases[i]);
+    exit(ec);
+}
+
+static void integer_root(void)
+{
+    int ec = 0;
+    const size_t degrees[] = { 2, 3, 7, 40 };
+    txc_int *const base = integer_pattern(60, 11);
+    txc_int *const one = txc_int_create_one();
+    txc_int *const neg_one = txc_int_neg(txc_int_create_one());
+    for (size_t i = 0; i < sizeof degrees / sizeof *degrees && ec == 0; i++) {
+        txc_int *const power = txc_int_pow(base, degrees[i]);
+        const txc_int *const below_summands[2] = { power, neg_one };
+        const txc_int *const above_summands[2] = { power, one };
+        txc_int *const below = txc_int_add(below_summands, 2);
+        txc_int *const above = txc_int_add(above_summands, 2);
+        bool exact = false;
+        txc_int *const root = txc_int_root(power, degrees[i], &exact);
+        if (!txc_int_test_valid(root) || !exact || txc_int_cmp(root, base) != 0)
+            ec = 1;
+        txc_int_free(root);
+        exact = true;
+        txc_int *const above_root = txc_int_root(above, degrees[i], &exact);
+        if (ec == 0 && (!txc_int_test_valid(above_root) || exact || txc_int_cmp(above_root, base) != 0))
+            ec = 2;
+        txc_int_free(above_root);
+        // floor(root(base^n - 1)) = base - 1
+        exact = true;
+        txc_int *const below_root = txc_int_root(below, degrees[i], &exact);
+        const txc_int *const check_summands[2] = { below_root, one };
+        txc_int *const check = txc_int_add(check_summands, 2);
+        if (ec == 0 && (!txc_int_test_valid(check) || exact || txc_int_cmp(check, base) != 0))
+            ec = 3;
+        txc_int_free(below_root);
+        txc_int_free(check);
+        txc_int_free(power);
+        txc_int_free(below);
+        txc_int_free(above);
+    }
+    txc_int_free(base);
+    txc_int_free(one);
+    txc_int_free(neg_one);
+    exit(ec);
+}
+
+static void integer_factorial(void)
+{
+    int ec = 0;
+    txc_int *const one = txc_int_create_one();
+    txc_int *counter = txc_int_create_zero();
+    txc_int *naive = txc_int_create_one();
+    txc_int *factorials[301];
+    for (size_t n = 0; n <= 300 && ec == 0; n++) {
+        if (n > 0) {
+            const txc_int *const summands[2] = { counter, one };
+            txc_int *const next_counter = txc_int_add(summands, 2);
+            const txc_int *const factors[2] = { naive, next_counter };
+            txc_int *const next_naive = txc_int_mul(factors, 2);
+            txc_int_free(counter);
+            txc_int_free(naive);
+            counter = next_counter;
+            naive = next_naive;
+        }
+        factorials[n] = txc_int_factorial(n);
+        if (!txc_int_test_valid(factorials[n]) || txc_int_cmp(factorials[n], naive) != 0)
+            ec = 1;
+    }
+    // binom{n}{k} * k! * (n - k)! = n!, both with and without sieving
+    const size_t ns[] = { 0, 7, 64, 65, 129, 300, 300, 300 };
+    const size_t ks[] = { 0, 3, 32, 64, 65, 5, 150, 299 };
+    for (size_t i = 0; i < sizeof ns / sizeof *ns && ec == 0; i++) {
+        txc_int *const binom = txc_int_binomial(ns[i], ks[i]);
+        const txc_int *const factors[3] = { binom, factorials[ks[i]], factorials[ns[i] - ks[i]] };
+        txc_int *const product = txc_int_mul(factors, 3);
+        if (!txc_int_test_valid(binom) || txc_int_cmp(product, factorials[ns[i]]) != 0)
+            ec = 2;
+        txc_int_free(binom);
+        txc_int_free(product);
+    }
+    txc_int *const zero = txc_int_binomial(3, 4);
+    if (ec == 0 && !txc_int_is_zero(zero))
+        ec = 3;
+    txc_int_free(zero);
+    for (size_t n = 0; n <= 300; n++)
+        txc_int_free(factorials[n]);
+    txc_int_free(one);
+    txc_int_free(counter);
+    txc_int_free(naive);
+    exit(ec);
+}
+
+static void integer_divmod(void)
+{
+    int ec = 0;
+    const enum txc_int_div_mode modes[] = { TXC_INT_DIV_TRUNC, TXC_INT_DIV_FLOOR, TXC_INT_DIV_EUCLID };
+    for (unsigned int signs = 0; signs < 4 && ec == 0; signs++) {
+        txc_int *const a = integer_pattern(300, 7);
+        txc_int *const b = integer_pattern(120, 9);
+        if (signs & 1)
+            txc_int_neg(a);
+        if (signs & 2)
+            txc_int_neg(b);
+        for (size_t i = 0; i < sizeof modes / sizeof *modes && ec == 0; i++) {
+            txc_int *q = NULL;
+            txc_int *r = NULL;
+            if (!txc_int_divmod(a, b, modes[i], &q, &r) || !txc_int_test_valid(q) || !txc_int_test_valid(r)) {
+                ec = 1;
+                break;
+            }
+            // a = q * b + r with |r| < |b|
+            const txc_int *const factors[2] = { q, b };
+            txc_int *const product = txc_int_mul(factors, 2);
+            const txc_int *const summands[2] = { product, r };
+            txc_int *const sum = txc_int_add(summands, 2);
+            if (txc_int_cmp(sum, a) != 0 || txc_int_cmp_abs(r, b) >= 0 || txc_int_is_zero(r))
+                ec = 2;
+            else if (txc_int_is_neg(r) != (modes[i] == TXC_INT_DIV_TRUNC ? txc_int_is_neg(a) : modes[i] == TXC_INT_DIV_FLOOR ? txc_int_is_neg(b) : false))
+                ec = 3;
+            txc_int_free(q);
+            txc_int_free(r);
+            txc_int_free(product);
+            txc_int_free(sum);
+        }
+        txc_int_free(a);
+        txc_int_free(b);
+    }
+    exit(ec);
+}
+
+static void integer_shared(void)
+{
+    int ec = 0;
+    txc_int *const original = integer_pattern(300, 3);
+    txc_int *const expected = integer_pattern(300, 3);
+    // copies share the original until they are mutated
+    txc_int *const copy = txc_int_copy(original);
+    txc_int *const neg = txc_int_neg(txc_int_copy(original));
+    txc_int *acc = txc_int_copy(original);
+    if (copy != original || neg == original || !txc_int_is_neg(neg) || txc_int_cmp_abs(neg, expected) != 0)
+        ec = 1;
+    else if (!txc_int_addmul(&acc, copy, copy) || acc == original)
+        ec = 2;
+    txc_int_free(copy);
+    txc_int_free(neg);
+    txc_int_free(acc);
+    if (ec == 0 && (!txc_int_test_valid(original) || txc_int_is_neg(original) || txc_int_cmp(original, expected) != 0))
+        ec = 3;
+    txc_int_free(original);
+    txc_int_free(expected);
+    exit(ec);
+}
+
+// Shifts agree with multiplying and dividing by powers of two, also rounding negative integers.
+static void integer_shift(void)
+{
+    int ec = 0;
+    const size_t bits[] = { 0, 3, 8, 77, 2000 };
+    const enum txc_int_div_mode modes[] = { TXC_INT_DIV_TRUNC, TXC_INT_DIV_FLOOR };
+    txc_int *const one = txc_int_create_one();
+    txc_int *const two = txc_int_shift_left(one, 1);
+    txc_int_free(one);
+    for (unsigned int neg = 0; neg < 2 && ec == 0; neg++) {
+        txc_int *a = integer_pattern(120, 7);
+        if (neg)
+            a = txc_int_neg(a);
+        for (size_t i = 0; i < sizeof bits / sizeof *bits && ec == 0; i++) {
+            size_t exponent = SIZE_MAX;
+            txc_int *const power = txc_int_pow(two, bits[i]);
+            const txc_int *const factors[2] = { a, power };
+            txc_int *const product = txc_int_mul(factors, 2);
+            txc_int *const shifted = txc_int_shift_left(a, bits[i]);
+            if (!txc_int_is_pow2(power, &exponent) || exponent != bits[i] || txc_int_is_pow2(a, &exponent))
+                ec = 1;
+            else if (!txc_int_test_valid(shifted) || txc_int_cmp(shifted, product) != 0 || txc_int_trailing_zeros(shifted) != txc_int_trailing_zeros(a) + bits[i])
+                ec = 2;
+            for (size_t j = 0; j < sizeof modes / sizeof *modes && ec == 0; j++) {
+                txc_int *quotient = NULL;
+                txc_int *const right = txc_int_shift_right(a, bits[i], modes[j]);
+                if (!txc_int_divmod(a, power, modes[j], &quotient, NULL) || !txc_int_test_valid(right) || txc_int_cmp(right, quotient) != 0)
+                    ec = 3;
+                txc_int_free(quotient);
+                txc_int_free(right);
+            }
+            txc_int_free(power);
+            txc_int_free(product);
+            txc_int_free(shifted);
+        }
+        txc_int_free(a);
+    }
+    txc_int_free(two);
+    exit(ec);
+}
+
+static void integer_addmul(void)
+{
+    int ec = 0;
+    // row by row and through a product buffer, crossing zero in both directions
+    const size_t lens[] = { 3, 40, 9, 100, 250, 2 };
+    txc_int *acc = integer_pattern(20, 1);
+    txc_int *expected = txc_int_copy(acc);
+    for (size_t i = 0; i < sizeof lens / sizeof *lens && ec == 0; i++) {
+        txc_int *const a = integer_pattern(lens[i], (unsigned int)i + 2);
+        txc_int *const b = integer_pattern(lens[(i + 1) % (sizeof lens / sizeof *lens)], (unsigned int)i + 5);
+        if (i % 3 == 1)
+            txc_int_neg(b);
+        const bool sub = i % 2 == 0;
+        const txc_int *const factors[2] = { a, b };
+        txc_int *const product = txc_int_mul(factors, 2);
+        if (sub)
+            txc_int_neg(product);
+        const txc_int *const summands[2] = { expected, product };
+        txc_int *const sum = txc_int_add(summands, 2);
+        txc_int_free(expected);
+        expected = sum;
+        if (!(sub ? txc_int_submul(&acc, a, b) : txc_int_addmul(&acc, a, b)))
+            ec = 1;
+        else if (!txc_int_test_valid(acc) || txc_int_cmp(acc, expected) != 0)
+            ec = 2;
+        txc_int_free(a);
+        txc_int_free(b);
+        txc_int_free(product);
+    }
+    txc_int_free(acc);
+    txc_int_free(expected);
+    exit(ec);
+}
+
+static void integer_fixed(void)
+{
+    int ec = 0;
+    txc_int *const zero = txc_int_create_zero();
+    // 128, 256 and 512 bit operands of all sign combinations, checked against the generic paths
+    const size_t lens[] = { 32, 64, 128 };
+    for (size_t i = 0; i < sizeof lens / sizeof *lens * 4 && ec == 0; i++) {
+        txc_int *const a = integer_pattern(lens[i / 4], (unsigned int)i + 3);
+        txc_int *const b = integer_pattern(lens[i / 4], (unsigned int)i + 8);
+        if (i & 1)
+            txc_int_neg(a);
+        if (i & 2)
+            txc_int_neg(b);
+        const txc_int *const operands[2] = { a, b };
+        txc_int *const sum = txc_int_add(operands, 2);
+        txc_int *const product = txc_int_mul(operands, 2);
+        txc_int *const neg_sum = txc_int_neg(txc_int_copy(sum));
+        const txc_int *const summands[4] = { a, b, neg_sum, zero };
+        txc_int *const check = txc_int_add(summands, 4);
+        txc_int *q = NULL;
+        txc_int *r = NULL;
+        if (!txc_int_test_valid(sum) || !txc_int_test_valid(product) || !txc_int_is_zero(check))
+            ec = 1;
+        else if (!txc_int_divmod(product, b, TXC_INT_DIV_TRUNC, &q, &r) || txc_int_cmp(q, a) != 0 || !txc_int_is_zero(r))
+            ec = 2;
+        else if (txc_int_cmp_abs(a, a) != 0 || txc_int_cmp_abs(a, b) != -txc_int_cmp_abs(b, a))
+            ec = 3;
+        txc_int_free(a);
+        txc_int_free(b);
+        txc_int_free(sum);
+        txc_int_free(product);
+        txc_int_free(neg_sum);
+        txc_int_free(check);
+        txc_int_free(q);
+        txc_int_free(r);
+    }
+    txc_int_free(zero);
+    exit(ec);
+}
+
+static void integer_divisor(void)
+{
+    int ec = 0;
+    const enum txc_int_div_mode modes[] = { TXC_INT_DIV_TRUNC, TXC_INT_DIV_FLOOR, TXC_INT_DIV_EUCLID };
+    // a single limb, schoolbook and reciprocal sized divisors
+    const size_t divisor_lens[] = { 1, 2, 40, 150, 301 };
+    txc_int *const a = integer_pattern(2000, 11);
+    for (size_t i = 0; i < sizeof divisor_lens / sizeof *divisor_lens && ec == 0; i++) {
+        txc_int *const b = integer_pattern(divisor_lens[i], 13);
+        if (i % 2 == 1)
+            txc_int_neg(b);
+        const txc_int_divisor *const divisor = txc_int_divisor_create(b);
+        if (divisor == NULL || txc_int_cmp(txc_int_divisor_value(divisor), b) != 0)
+            ec = 1;
+        for (size_t j = 0; j < sizeof modes / sizeof *modes && ec == 0; j++) {
+            txc_int *q = NULL;
+            txc_int *r = NULL;
+            txc_int *expected_q = NULL;
+            txc_int *expected_r = NULL;
+            if (!txc_int_divisor_divmod(a, divisor, modes[j], &q, &r) || !txc_int_divmod(a, b, modes[j], &expected_q, &expected_r))
+                ec = 2;
+            else if (!txc_int_test_valid(q) || !txc_int_test_valid(r) || txc_int_cmp(q, expected_q) != 0 || txc_int_cmp(r, expected_r) != 0)
+                ec = 3;
+            txc_int_free(q);
+            txc_int_free(r);
+            txc_int_free(expected_q);
+            txc_int_free(expected_r);
+            // the same divisor again for the negated dividend
+            txc_int_neg(a);
+        }
+        txc_int_divisor_free(divisor);
+        txc_int_free(b);
+    }
+    txc_int_free(a);
+    exit(ec);
+}
+
+static void integer_mod(void)
+{
+    int ec = 0;
+    const size_t exponents[] = { 0, 1, 2, 31, 200 };
+    txc_int *const base = integer_pattern(40, 3);
+    txc_int *const modulus = txc_int_neg(integer_pattern(25, 5));
+    txc_int_mod_ctx *const ctx = txc_int_mod_ctx_create(modulus);
+    for (size_t i = 0; i < sizeof exponents / sizeof *exponents && ec == 0; i++) {
+        // the same exponent once as size_t and once as int
+        txc_int *exponent = txc_int_create_zero();
+        for (size_t j = 0; j < exponents[i]; j++) {
+            txc_int *const one = txc_int_create_one();
+            const txc_int *const summands[2] = { exponent, one };
+            txc_int *const next = txc_int_add(summands, 2);
+            txc_int_free(exponent);
+            txc_int_free(one);
+            exponent = next;
+        }
+        txc_int *const power = txc_int_pow(base, exponents[i]);
+        txc_int *const expected = txc_int_mod_reduce(ctx, power);
+        txc_int *const residue = txc_int_mod_pow(ctx, base, exponent);
+        if (!txc_int_test_valid(residue) || txc_int_cmp(residue, expected) != 0 || txc_int_is_neg(residue) || txc_int_cmp_abs(residue, modulus) >= 0)
+            ec = 1;
+        // (x + x) * x = 2 * x^2
+        txc_int *const sum = txc_int_mod_add(ctx, residue, residue);
+        txc_int *const product = txc_int_mod_mul(ctx, sum, residue);
+        const txc_int *const factors[2] = { power, power };
+        txc_int *const full = txc_int_mul(factors, 2);
+        const txc_int *const summands[2] = { full, full };
+        txc_int *const doubled = txc_int_add(summands, 2);
+        txc_int *const expected_product = txc_int_mod_reduce(ctx, doubled);
+        if (ec == 0 && (!txc_int_test_valid(product) || txc_int_cmp(product, expected_product) != 0))
+            ec = 2;
+        txc_int_free(exponent);
+        txc_int_free(power);
+        txc_int_free(expected);
+        txc_int_free(residue);
+        txc_int_free(sum);
+        txc_int_free(product);
+        txc_int_free(full);
+        txc_int_free(doubled);
+        txc_int_free(expected_product);
+    }
+    txc_int_mod_ctx_free(ctx);
+    txc_int_free(base);
+    txc_int_free(modulus);
+    exit(ec);
+}
+
+static txc_rat *rational_pattern(const size_t num_len, const size_t den_len, const txc_int *const common, const unsigned int seed)
+{
+    txc_int *const num = integer_pattern(num_len, seed);
+    txc_int *const den = integer_pattern(den_len, seed + 1);
+    const txc_int *const factors[2] = { den, common };
+    txc_int *const den_common = txc_int_mul(factors, 2);
+    txc_int_free(den);
+    return txc_rat_create(num, den_common);
+}
+
+// Takes ownership of node.
+static char *simplified_str(txc_node *const node)
+{
+    txc_node *const simple = txc_node_simplify(node);
+    char *const str = txc_node_to_str(simple);
+    txc_node_free(node);
+    txc_node_free(simple);
+    return str;
+}
+
+static txc_node *fraction(const char *const num, const char *const den)
+{
+    return txc_node_create_bin_op(TXC_FRAC, txc_int_create_int_node(den, strlen(den), 10), txc_int_create_int_node(num, strlen(num), 10));
+}
+
+static void rational_arithmetic(void)
+{
+    int ec = 0;
+    // big enough for Henrici's formulas, with a common factor of the denominators
+    txc_int *const common = integer_pattern(20, 1);
+    txc_node *const a = txc_rat_to_node(rational_pattern(40, 10, common, 2));
+    txc_node *const b = txc_rat_to_node(txc_rat_neg(rational_pattern(35, 12, common, 4)));
+    char *const a_str = txc_node_to_str(a);
+    // (a + b) - b = a, both are sums of two fractions
+    txc_node *const sum = txc_node_simplify(txc_node_create_bin_op(TXC_ADD, txc_node_copy(a), txc_node_copy(b)));
+    char *const diff = simplified_str(txc_node_create_bin_op(TXC_ADD, sum, txc_node_create_un_op(TXC_NEG, txc_node_copy(b))));
+    if (a_str == NULL || diff == NULL || strcmp(diff, a_str) != 0)
+        ec = 1;
+    // (a * b) / b = a
+    txc_node *const product = txc_node_simplify(txc_node_create_bin_op(TXC_MUL, txc_node_copy(a), txc_node_copy(b)));
+    char *const quotient = simplified_str(txc_node_create_bin_op(TXC_FRAC, txc_node_copy(b), product));
+    if (ec == 0 && (quotient == NULL || strcmp(quotient, a_str) != 0))
+        ec = 2;
+    // 1 / 6 + 1 / (-3), small operands are only reduced when converted
+    char *const half = simplified_str(txc_node_create_bin_op(TXC_ADD, fraction("1", "6"), txc_node_create_bin_op(TXC_FRAC, txc_node_create_un_op(TXC_NEG, txc_int_create_int_node("3", 1, 10)), txc_int_create_int_node("1", 1, 10))));
+    if (ec == 0 && (half == NULL || strcmp(half, "(-\\frac{1}{6})") != 0))
+        ec = 3;
+    free(a_str);
+    free(diff);
+    free(quotient);
+    free(half);
+    txc_node_free(a);
+    txc_node_free(b);
+    txc_int_free(common);
+    exit(ec);
+}
+
+static void rational_sum(void)
+{
+    int ec = 0;
+    // 1 / (i * (i + 1)) telescopes to 1 - 1 / (n + 1)
+    const size_t n = 300;
+    txc_node *sum = NULL;
+    txc_node *pairwise = txc_int_create_int_node("0", 1, 10);
+    for (size_t i = 0; i < n; i++) {
+        char den[16];
+        snprintf(den, sizeof den, "%zu", (i + 1) * (i + 2));
+        sum = sum == NULL ? fraction("1", den) : txc_node_create_bin_op(TXC_ADD, sum, fraction("1", den));
+        // every step adds two fractions, the whole sum goes over a product tree of the denominators
+        txc_node *const step = txc_node_create_bin_op(TXC_ADD, pairwise, fraction("1", den));
+        pairwise = txc_node_simplify(step);
+        txc_node_free(step);
+    }
+    char *const sum_str = simplified_str(sum);
+    char *const pairwise_str = simplified_str(pairwise);
+    if (sum_str == NULL || strcmp(sum_str, "\\frac{300}{301}") != 0)
+        ec = 1;
+    else if (pairwise_str == NULL || strcmp(pairwise_str, sum_str) != 0)
+        ec = 2;
+    free(sum_str);
+    free(pairwise_str);
+    exit(ec);
+}
+
 static void integer_gcd(void)
 {
     if (!txc_int_is_pos_one(txc_int_mul(NULL, 0)))
@@ -737,6 +1320,8 @@ static void node_constants(void)
     txc_node_free(&TXC_NAN_ERROR_INVALID_NODE_TYPE);
     txc_node_free(&TXC_NAN_ERROR_OVERFLOW);
     txc_node_free(&TXC_NAN_ERROR_NYI);
+    txc_node_free(&TXC_NAN_ERROR_NOT_REAL);
+    txc_node_free(&TXC_NAN_ERROR_UNDEFINED);
     txc_node_free(&TXC_NAN_ERROR_ZERO_DIVISION);
     txc_node_free(&TXC_NAN_UNSPECIFIED);
     if (!txc_node_test_valid(&TXC_NAN_ERROR_ALLOC, true))
@@ -751,6 +1336,10 @@ static void node_constants(void)
         exit(5);
     if (!txc_node_test_valid(&TXC_NAN_UNSPECIFIED, true))
         exit(6);
+    if (!txc_node_test_valid(&TXC_NAN_ERROR_NOT_REAL, true))
+        exit(7);
+    if (!txc_node_test_valid(&TXC_NAN_ERROR_UNDEFINED, true))
+        exit(8);
     exit(EXIT_SUCCESS);
 }
 
@@ -793,6 +1382,174 @@ static void node_neg(void)
     exit(EXIT_SUCCESS);
 }
 
+static void node_arena(void)
+{
+    int ec = 0;
+    txc_int *kept = NULL;
+    txc_node_arena_init();
+    // lines larger than the first chunk, released and reused a few times
+    for (size_t line = 0; line < 3 && ec == 0; line++) {
+        txc_node *sum = txc_int_create_int_node("1", 1, 10);
+        for (size_t i = 1; i < 5000; i++)
+            sum = txc_node_create_bin_op(TXC_ADD, sum, txc_node_create_un_op(TXC_NEG, txc_int_create_int_node("3", 1, 10)));
+        txc_node *const result = txc_node_simplify(sum);
+        char *const str = txc_node_to_str(result);
+        if (str == NULL || strcmp(str, "(-14996)") != 0)
+            ec = 1;
+        free(str);
+        txc_int_free(kept);
+        kept = txc_int_copy(txc_node_to_int(result));
+        txc_node_free(sum);
+        txc_node_free(result);
+        txc_node_arena_release();
+    }
+    txc_node_arena_free();
+    if (ec == 0 && (kept == NULL || !txc_int_test_valid(kept) || !txc_int_is_neg(kept)))
+        ec = 2;
+    txc_int_free(kept);
+    exit(ec);
+}
+
+// \binom{40}{20} \bmod 7 + line
+static txc_node *memo_line(const char *const line)
+{
+    txc_node *const binom = txc_node_create_bin_op(TXC_BINOM, txc_int_create_int_node("40", 2, 10), txc_int_create_int_node("20", 2, 10));
+    return txc_node_create_bin_op(TXC_ADD, txc_node_create_bin_op(TXC_MOD, binom, txc_int_create_int_node("7", 1, 10)), txc_int_create_int_node(line, strlen(line), 10));
+}
+
+static void node_memo(void)
+{
+    // only the printed lines go there
+    if (freopen("/dev/null", "w", stdout) == NULL)
+        exit(1);
+    const char *const lines[4] = { "0", "1", "1", "0" };
+    struct txc_node_memo_stats stats[2];
+    for (size_t budget = 0; budget < 2; budget++) {
+        txc_node_memo_init(budget == 0 ? 1 << 20 : 1);
+        txc_node_arena_init();
+        for (size_t i = 0; i < 4; i++) {
+            txc_node *const tree = memo_line(lines[i]);
+            txc_node_simplify_and_print(tree);
+            txc_node_free(tree);
+            txc_node_arena_release();
+        }
+        txc_node_arena_free();
+        stats[budget] = txc_node_memo_stats();
+        txc_node_memo_free();
+    }
+    // the binomial, the modulus and both lines are kept, the modulus is hit once and each line when it repeats
+    if (stats[0].hits != 3 || stats[0].misses != 4 || stats[0].entries != 4 || stats[0].evictions != 0)
+        exit(2);
+    if (stats[1].hits != 0 || stats[1].entries != 0 || stats[1].bytes != 0)
+        exit(3);
+    exit(0);
+}
+
+static void node_flat(void)
+{
+    int ec = 0;
+    // (1 + (-2)) + ((\frac{3}{4} \cdot 5) \cdot {6}^{7}) with a NAN factor in a second product
+    txc_node *const product = txc_node_create_bin_op(TXC_MUL, txc_node_create_bin_op(TXC_FRAC, txc_int_create_int_node("4", 1, 10), txc_int_create_int_node("3", 1, 10)), txc_int_create_int_node("5", 1, 10));
+    txc_node *const tree = txc_node_create_bin_op(TXC_ADD, txc_node_create_bin_op(TXC_ADD, txc_int_create_int_node("1", 1, 10), txc_node_create_un_op(TXC_NEG, txc_int_create_int_node("2", 1, 10))), txc_node_create_bin_op(TXC_MUL, product, txc_node_create_bin_op(TXC_POW, txc_int_create_int_node("6", 1, 10), txc_int_create_int_node("7", 1, 10))));
+    txc_node *const nan_tree = txc_node_create_bin_op(TXC_MUL, txc_int_create_int_node("8", 1, 10), txc_node_create_nan("flat"));
+    txc_flat *const flat = txc_flat_from_node(tree);
+    txc_flat *const nan_flat = txc_flat_from_node(nan_tree);
+    if (flat == NULL || nan_flat == NULL || !txc_flat_test_valid(flat) || !txc_flat_test_valid(nan_flat)) {
+        ec = 1;
+    } else {
+        txc_node *const back = txc_flat_to_node(flat);
+        txc_node *const nan_back = txc_flat_to_node(nan_flat);
+        char *const str = txc_node_to_str(back);
+        txc_node *const simple = txc_node_simplify(tree);
+        txc_node *const result = txc_flat_eval(flat);
+        char *const simple_str = txc_node_to_str(simple);
+        char *const result_str = txc_node_to_str(result);
+        char *const nan_str = txc_node_to_str(nan_back);
+        char *const nan_tree_str = txc_node_to_str(nan_tree);
+        // the nested sum is merged into the root, the products into one
+        if (strcmp(str, "(1 + (-2) + (\\frac{3}{4} \\cdot 5 \\cdot {6}^{7}))") != 0)
+            ec = 2;
+        else if (strcmp(simple_str, result_str) != 0)
+            ec = 3;
+        else if (strcmp(nan_str, nan_tree_str) != 0)
+            ec = 4;
+        free(str);
+        free(simple_str);
+        free(result_str);
+        free(nan_str);
+        free(nan_tree_str);
+        txc_node_free(back);
+        txc_node_free(nan_back);
+        txc_node_free(simple);
+        txc_node_free(result);
+    }
+    txc_flat_free(flat);
+    txc_flat_free(nan_flat);
+    txc_node_free(tree);
+    txc_node_free(nan_tree);
+    // a long parsed sum becomes a single node over contiguous summands
+    txc_node *sum = txc_int_create_int_node("1", 1, 10);
+    for (size_t i = 1; i < 10000; i++)
+        sum = txc_node_create_bin_op(TXC_ADD, sum, txc_int_create_int_node("2", 1, 10));
+    txc_flat *const sum_flat = txc_flat_from_node(sum);
+    txc_node *const sum_back = sum_flat == NULL ? NULL : txc_flat_to_node(sum_flat);
+    txc_node *const sum_result = sum_flat == NULL ? NULL : txc_flat_eval(sum_flat);
+    char *const sum_str = sum_result == NULL ? NULL : txc_node_to_str(sum_result);
+    if (ec == 0 && (sum_back == NULL || txc_node_children_amount(sum_back) != 10000 || sum_str == NULL || strcmp(sum_str, "19999") != 0))
+        ec = 5;
+    free(sum_str);
+    txc_node_free(sum_back);
+    txc_node_free(sum_result);
+    txc_flat_free(sum_flat);
+    txc_node_free(sum);
+    exit(ec);
+}
+
+static void node_flat_eval(void)
+{
+    // \lfloor \frac{x}{7} \rfloor + x^{2} \bmod 5 with inputs 7, x, x, 2, 5 and 1 / x in a second tree
+    txc_node *const floor_node = txc_node_create_un_op(TXC_FLOOR, txc_node_create_bin_op(TXC_FRAC, txc_int_create_int_node("7", 1, 10), txc_int_create_int_node("0", 1, 10)));
+    txc_node *const mod_node = txc_node_create_bin_op(TXC_MOD, txc_node_create_bin_op(TXC_POW, txc_int_create_int_node("0", 1, 10), txc_int_create_int_node("2", 1, 10)), txc_int_create_int_node("5", 1, 10));
+    txc_node *const tree = txc_node_create_bin_op(TXC_ADD, floor_node, mod_node);
+    txc_node *const inv_tree = txc_node_create_un_op(TXC_FRAC, txc_int_create_int_node("0", 1, 10));
+    txc_flat *const flat = txc_flat_from_node(tree);
+    txc_flat *const inv = txc_flat_from_node(inv_tree);
+    txc_node_free(tree);
+    txc_node_free(inv_tree);
+    int ec = flat == NULL || inv == NULL || txc_flat_inputs(flat) != 5 || txc_flat_inputs(inv) != 1;
+    // the fractions of negative x and all of 1 / x but 1 / 1 and 1 / -1 are left to txc_node_simplify
+    for (int x = -20; ec == 0 && x <= 20; x++) {
+        char str[16];
+        const int len = snprintf(str, sizeof str, "%d", x < 0 ? -x : x);
+        txc_node *const x_node = txc_int_create_int_node(str, len, 10);
+        txc_int *const value = x < 0 ? txc_int_neg(txc_int_copy(txc_node_to_int(x_node))) : txc_int_copy(txc_node_to_int(x_node));
+        txc_node_free(x_node);
+        if (!txc_flat_bind(flat, 1, value) || !txc_flat_bind(flat, 2, value) || !txc_flat_bind(inv, 0, value))
+            ec = 1;
+        txc_int_free(value);
+        for (size_t i = 0; ec == 0 && i < 2; i++) {
+            txc_flat *const cur = i == 0 ? flat : inv;
+            txc_node *const back = txc_flat_to_node(cur);
+            txc_node *const expected = txc_node_simplify(back);
+            txc_node *const result = txc_flat_eval(cur);
+            char *const expected_str = txc_node_to_str(expected);
+            char *const result_str = txc_node_to_str(result);
+            if (strcmp(expected_str, result_str) != 0) {
+                fprintf(stderr, "Got:\n%s\nExpected:\n%s\n", result_str, expected_str);
+                ec = 2;
+            }
+            free(expected_str);
+            free(result_str);
+            txc_node_free(back);
+            txc_node_free(expected);
+            txc_node_free(result);
+        }
+    }
+    txc_flat_free(flat);
+    txc_flat_free(inv);
+    exit(ec);
+}
+
 static int node_add_mul(const enum op op, const char *const operand_strs[5], const char *const sol_str)
 {
     if (txc_int_neg(NULL) != NULL)
@@ -899,11 +1656,364 @@ static void node_frac_int_inverted(void)
     exit(node_frac_int(true));
 }
 
+// Nested deeper than the stack could hold if any pass recursed.
+static void node_deep(void)
+{
+    const size_t depth = 100000;
+    txc_node *sum = txc_int_create_int_node("1", 1, 10);
+    for (size_t i = 0; i < depth; i++)
+        sum = txc_node_create_bin_op(TXC_ADD, txc_int_create_int_node("1", 1, 10), sum);
+    if (!txc_node_test_valid(sum, true))
+        exit(1);
+    char *const tree = txc_node_to_str(sum);
+    txc_node *const result = txc_node_simplify(sum);
+    char *const str = txc_node_to_str(result);
+    txc_node_free(sum);
+    txc_node_free(result);
+    int ec = 0;
+    if (tree == NULL || strlen(tree) < 4 * depth)
+        ec = 2;
+    else if (strcmp(str, "100001") != 0) {
+        fprintf(stderr, "Got:\n%s\nExpected:\n100001\n", str);
+        ec = 3;
+    }
+    free(tree);
+    free(str);
+    exit(ec);
+}
+
+static void node_rewrites(void)
+{
+    // 0 \cdot 5! + --7 + \frac{6}{6} + 5 \cdot 8 \cdot (-1), neither the factorial nor the inner negation is simplified
+    txc_node *const fact = txc_node_create_un_op(TXC_FACT, txc_int_create_int_node("5", 1, 10));
+    txc_node *const zero = txc_node_create_bin_op(TXC_MUL, txc_int_create_int_node("0", 1, 10), fact);
+    txc_node *const neg = txc_node_create_un_op(TXC_NEG, txc_node_create_un_op(TXC_NEG, txc_int_create_int_node("7", 1, 10)));
+    txc_node *const frac = txc_node_create_bin_op(TXC_FRAC, txc_int_create_int_node("6", 1, 10), txc_int_create_int_node("6", 1, 10));
+    txc_node *product = txc_node_create_bin_op(TXC_MUL, txc_int_create_int_node("5", 1, 10), txc_int_create_int_node("8", 1, 10));
+    product = txc_node_append(TXC_MUL, product, txc_node_create_un_op(TXC_NEG, txc_int_create_int_node("1", 1, 10)));
+    txc_node *sum = txc_node_create_bin_op(TXC_ADD, zero, neg);
+    sum = txc_node_append(TXC_ADD, sum, frac);
+    sum = txc_node_append(TXC_ADD, sum, product);
+    bool nan;
+    char *const str = txc_node_simplify_to_str(sum, &nan);
+    const struct txc_node_rewrite_stats stats = txc_node_rewrite_stats();
+    int ec = 0;
+    if (str == NULL || nan || strcmp(str, "(-32)") != 0)
+        ec = 1;
+    else if (stats.zeros != 1 || stats.negations != 1 || stats.quotients != 1 || stats.shifts != 1 || stats.units != 1)
+        ec = 2;
+    free(str);
+    txc_node_free(sum);
+    exit(ec);
+}
+
+static void node_append(void)
+{
+    const size_t amount = 1000;
+    txc_node_arena_init();
+    txc_node *sum = txc_int_create_int_node("1", 1, 10);
+    for (size_t i = 1; i < amount; i++)
+        sum = txc_node_append(TXC_ADD, sum, txc_node_create_un_op(TXC_NEG, txc_int_create_int_node("2", 1, 10)));
+    int ec = 0;
+    if (txc_node_get_type(sum) != TXC_ADD || txc_node_children_amount(sum) != amount)
+        ec = 1;
+    txc_node *const result = txc_node_simplify(sum);
+    char *const str = txc_node_to_str(result);
+    txc_node_free(result);
+    txc_node_arena_free();
+    if (ec == 0 && strcmp(str, "(-1997)") != 0) {
+        fprintf(stderr, "Got:\n%s\nExpected:\n(-1997)\n", str);
+        ec = 2;
+    }
+    free(str);
+    exit(ec);
+}
+
+static void node_fold(void)
+{
+    txc_node_fold_enable(true);
+    // \frac{1}{2} - 3 \cdot 4 + \sqrt{2}, where the root cannot be folded
+    txc_node *const half = txc_node_fold(txc_node_create_bin_op(TXC_FRAC, txc_int_create_int_node("2", 1, 10), txc_int_create_int_node("1", 1, 10)));
+    txc_node *const prod = txc_node_fold(txc_node_append(TXC_MUL, txc_int_create_int_node("3", 1, 10), txc_int_create_int_node("4", 1, 10)));
+    bool folded = txc_node_get_type(prod) == TXC_INT;
+    txc_node *const diff = txc_node_fold(txc_node_append(TXC_ADD, half, txc_node_fold(txc_node_create_un_op(TXC_NEG, prod))));
+    folded = folded && txc_node_get_type(diff) != TXC_ADD;
+    txc_node *const sum = txc_node_fold(txc_node_append(TXC_ADD, diff, txc_node_create_un_op(TXC_ROOT, txc_int_create_int_node("2", 1, 10))));
+    txc_node_fold_enable(false);
+    int ec = 0;
+    if (!folded || txc_node_get_type(sum) != TXC_ADD)
+        ec = 1;
+    txc_node *const result = txc_node_simplify(sum);
+    char *const str = txc_node_to_str(result);
+    txc_node_free(sum);
+    txc_node_free(result);
+    if (ec == 0 && strcmp(str, "(\\sqrt{2} + (-\\frac{23}{2}))") != 0) {
+        fprintf(stderr, "Got:\n%s\nExpected:\n(\\sqrt{2} + (-\\frac{23}{2}))\n", str);
+        ec = 2;
+    }
+    free(str);
+    exit(ec);
+}
+
+// Only the redefined variable and what depends on it are evaluated again, y on its flat definition.
+static void var_invalidation(void)
+{
+    txc_node *const x = txc_var_reference("x", 1);
+    txc_node *const y = txc_var_reference("y", 1);
+    txc_node *const z = txc_var_reference("z_{1}", 5);
+    txc_node *const y_def = txc_node_create_bin_op(TXC_ADD, txc_var_reference("x", 1), txc_int_create_int_node("1", 1, 10));
+    txc_node *const z_def = txc_node_create_bin_op(TXC_POW, txc_int_create_int_node("5", 1, 10), txc_int_create_int_node("3", 1, 10));
+    txc_node *const one = txc_int_create_int_node("1", 1, 10);
+    txc_node *const two = txc_int_create_int_node("2", 1, 10);
+    int ec = 0;
+    bool nan;
+    if (txc_var_define(x, one, NULL) != NULL || txc_var_define(y, y_def, NULL) != NULL || txc_var_define(z, z_def, NULL) != NULL)
+        ec = 1;
+    else if (strcmp(txc_var_str("y", 1, &nan), "2") != 0 || strcmp(txc_var_str("z_1", 3, &nan), "125") != 0 || txc_var_stats().evaluations != 3)
+        ec = 2;
+    else if (txc_var_define(x, y_def, NULL) != &TXC_NAN_ERROR_CYCLIC_DEFINITION || txc_var_define(x, two, NULL) != NULL || txc_var_stats().invalidations != 2)
+        ec = 3;
+    else if (strcmp(txc_var_str("y", 1, &nan), "3") != 0 || strcmp(txc_var_str("z_{1}", 5, &nan), "125") != 0 || txc_var_stats().evaluations != 5 || txc_var_stats().flat_evaluations != 2)
+        ec = 4;
+    txc_node_free(x);
+    txc_node_free(y);
+    txc_node_free(z);
+    txc_node_free(y_def);
+    txc_node_free(z_def);
+    txc_node_free(one);
+    txc_node_free(two);
+    txc_var_free();
+    exit(ec);
+}
+
+// A factor of 0 keeps y from being evaluated, and a later line sees the value of y after x changed, not a kept one.
+static void var_lazy(void)
+{
+    txc_node_memo_init(1 << 20);
+    txc_node *const x = txc_var_reference("x", 1);
+    txc_node *const y = txc_var_reference("y", 1);
+    txc_node *const y_def = txc_node_create_bin_op(TXC_POW, txc_var_reference("x", 1), txc_int_create_int_node("2", 1, 10));
+    txc_node *const three = txc_int_create_int_node("3", 1, 10);
+    txc_node *const four = txc_int_create_int_node("4", 1, 10);
+    txc_node *const zero_y = txc_node_create_bin_op(TXC_MUL, txc_int_create_int_node("0", 1, 10), txc_var_reference("y", 1));
+    txc_node *const zero_z = txc_node_create_bin_op(TXC_MUL, txc_int_create_int_node("0", 1, 10), txc_var_reference("z", 1));
+    txc_node *const y_pow = txc_node_create_bin_op(TXC_POW, txc_var_reference("y", 1), txc_int_create_int_node("2", 1, 10));
+    int ec = 0;
+    bool nan;
+    char *str[4] = { NULL };
+    if (txc_var_define(x, three, NULL) != NULL || txc_var_define(y, y_def, NULL) != NULL)
+        ec = 1;
+    str[0] = txc_node_simplify_to_str(zero_y, &nan);
+    if (ec == 0 && (strcmp(str[0], "0") != 0 || txc_var_stats().evaluations != 0))
+        ec = 2;
+    // z is not defined, so it is no pure factor
+    str[1] = txc_node_simplify_to_str(zero_z, &nan);
+    if (ec == 0 && (!nan || strcmp(str[1], "\\text{NAN(Variable is not defined.)}") != 0))
+        ec = 3;
+    str[2] = txc_node_simplify_to_str(y_pow, &nan);
+    if (ec == 0 && (strcmp(str[2], "81") != 0 || txc_var_stats().evaluations != 2))
+        ec = 4;
+    if (ec == 0 && txc_var_define(x, four, NULL) != NULL)
+        ec = 5;
+    str[3] = txc_node_simplify_to_str(y_pow, &nan);
+    if (ec == 0 && strcmp(str[3], "256") != 0)
+        ec = 6;
+    for (size_t i = 0; i < 4; i++)
+        free(str[i]);
+    txc_node_free(x);
+    txc_node_free(y);
+    txc_node_free(y_def);
+    txc_node_free(three);
+    txc_node_free(four);
+    txc_node_free(zero_y);
+    txc_node_free(zero_z);
+    txc_node_free(y_pow);
+    txc_var_free();
+    txc_node_memo_free();
+    exit(ec);
+}
+
 static void parser_combined(void)
 {
     parser("\\frac{0x80 \\cdot 0B10 - 200 + 5 \\cdot 5}{(8 - 2 - 2) \\cdot (5 - 8)} \\\\", "= (-\\frac{27}{4}) \\\\\n");
 }
 
+static void parser_pow(void)
+{
+    parser("2^{10} + (-3)^3 - -2^2 + 0^0 \\cdot 5^2 \\\\", "= 1026 \\\\\n");
+}
+
+static void parser_pow_frac(void)
+{
+    parser("(-\\frac{2}{3})^{-3} \\\\", "= (-\\frac{27}{8}) \\\\\n");
+}
+
+static void parser_root(void)
+{
+    parser("\\sqrt{2^{10}} + \\sqrt[3]{-27} \\\\", "= 29 \\\\\n");
+}
+
+static void parser_root_extract(void)
+{
+    parser("\\sqrt[3]{-1080} \\\\", "= ((-6) \\cdot \\sqrt[3]{5}) \\\\\n");
+}
+
+static void parser_floor(void)
+{
+    parser("\\lfloor \\frac{-7}{2} \\rfloor + \\lfloor \\frac{7}{2} \\rfloor \\cdot 10 + -7 \\bmod -3 \\\\", "= 28 \\\\\n");
+}
+
+static void parser_rational(void)
+{
+    parser("\\frac{1}{6} + \\frac{1}{3} \\cdot \\frac{3}{4} - \\frac{\\frac{1}{2}}{3} + 2 \\cdot \\frac{-1}{8} \\\\", "= 0 \\\\\n");
+}
+
+static void parser_dot(void)
+{
+    parser("2 \\cdot 3 + 4 \\cdot 5 - 6 \\cdot 7 + -2 \\cdot -3 \\\\", "= (-10) \\\\\n");
+}
+
+static void parser_mod(void)
+{
+    parser("3^{100} \\bmod 7 + -7 \\bmod 3 + 10 \\pmod{5} \\\\", "= 1 \\\\\n");
+}
+
+static void parser_factorial(void)
+{
+    parser("5! - 3!^2 + -2 \\cdot 0! + \\binom{10}{3} - \\binom{-4}{3} \\\\", "= 222 \\\\\n");
+}
+
+static void parser_shared(void)
+{
+    parser("\\lfloor \\frac{7}{2} \\rfloor \\cdot 5 + 5 \\cdot \\lfloor \\frac{7}{2} \\rfloor - (\\lfloor \\frac{7}{2} \\rfloor \\cdot 5)^2 \\\\", "= (-195) \\\\\n");
+}
+
+static void parser_rewrites(void)
+{
+    parser("0 \\cdot 100! \\cdot (1 - 1) + --3 + \\frac{2^{70} + 1}{2^{70} + 1} + \\lfloor \\frac{-7}{4} \\rfloor \\cdot 2^{3} \\cdot (-1) + \\frac{48}{2^{6}} \\cdot 4 \\\\", "= 23 \\\\\n");
+}
+
+static void parser_variables(void)
+{
+    parser("x = 2 \\\\ y = x^{10} + 1 \\\\ x = 3 \\\\ x_{1} = \\frac{1}{2} \\\\ y + x_1 \\\\", "= \\frac{118101}{2} \\\\\n");
+}
+
+static void parser_variables_rebind(void)
+{
+    // the value of x is bound to all three of its references, also after a fraction left y to txc_node_simplify
+    parser("x = 2 \\\\ y = x \\cdot x + 3 \\cdot (x + 1) + (x + 1) \\\\ x = -5 \\\\ y \\\\ x = \\frac{1}{2} \\\\ y \\\\ x = 4 \\\\ y \\\\", "= 36 \\\\\n");
+}
+
+static void parser_variables_cycle(void)
+{
+    // the definition of x is rejected and the old one kept
+    parser("x = 2 \\\\ y = x^{10} + 1 \\\\ x = y \\\\ y + x + z \\\\ z = 1 \\\\ y + x + z \\\\", "= 1028 \\\\\n");
+}
+
+// Parses input in a child process like a separate run would, which fails unless the cache file was hit hits times.
+static int cache_run(const char *const input, const size_t hits)
+{
+    const int cpid = fork();
+    if (cpid < 0) {
+        TXC_TEST_ERROR_FORK();
+        return -1;
+    } else if (cpid == 0) {
+        FILE *const in = fopen(TXC_TEST_CACHE ".in", "w");
+        if (in == NULL || fputs(input, in) < 0 || fclose(in) != 0)
+            exit(1);
+        if (freopen(TXC_TEST_CACHE ".in", "r", stdin) == NULL || freopen(TXC_TEST_CACHE ".out", "w", stdout) == NULL || !txc_cache_open(TXC_TEST_CACHE))
+            exit(2);
+        txc_node_arena_init();
+        yyparse();
+        txc_node_arena_free();
+        const struct txc_cache_stats stats = txc_cache_stats();
+        txc_cache_close();
+        exit(stats.hits == hits ? EXIT_SUCCESS : 3);
+    }
+    int status;
+    waitpid(cpid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -2;
+}
+
+// Fails unless the last cache_run printed exactly expected, so a hit has to print the same lines as a miss.
+static int cache_output(const char *const expected)
+{
+    char buf[TXC_BUF_SIZE];
+    FILE *const out = fopen(TXC_TEST_CACHE ".out", "r");
+    const size_t len = out == NULL ? 0 : fread(buf, 1, sizeof buf - 1, out);
+    buf[len] = '\0';
+    if (out != NULL)
+        fclose(out);
+    if (strcmp(buf, expected) == 0)
+        return 0;
+    fprintf(stderr, "Got:\n%s\nExpected:\n%s\n", buf, expected);
+    return 4;
+}
+
+static void parser_cache(void)
+{
+    // NANs are never kept and the last line only differs in whitespace
+    const char *const input = "\\frac{1}{0} \\\\\n\\binom{30}{15} \\bmod 1000 + 1 \\\\\n\\binom{30}{15}   \\bmod 1000+1\\\\\n";
+    // the tests are built for debugging, which prints every line before its result
+    const char *const expected = "= \\frac{1}{0} \\\\\n= \\text{NAN(Divided by 0.)} \\\\\n= ((\\binom{30}{15} \\bmod 1000) + 1) \\\\\n= 521 \\\\\n= ((\\binom{30}{15} \\bmod 1000) + 1) \\\\\n= 521 \\\\\n";
+    remove(TXC_TEST_CACHE);
+    int ec = cache_run(input, 1);
+    if (ec == 0)
+        ec = cache_output(expected);
+    if (ec == 0)
+        ec = cache_run(input, 2);
+    if (ec == 0)
+        ec = cache_output(expected);
+    remove(TXC_TEST_CACHE);
+    remove(TXC_TEST_CACHE ".in");
+    remove(TXC_TEST_CACHE ".out");
+    exit(ec);
+}
+
+static void parser_cache_zeros(void)
+{
+    // replayed lexemes of 0 are followed by the digits of the next ones, the first run must not read them
+    const char *const input = "0+0 \\\\\n0 \\cdot 0 \\\\\n100 \\\\\n0 \\\\\n0^{0} \\\\\n";
+    const char *const expected = "= (0 + 0) \\\\\n= 0 \\\\\n= (0 \\cdot 0) \\\\\n= 0 \\\\\n= 100 \\\\\n= 100 \\\\\n= 0 \\\\\n= 0 \\\\\n= {0}^{0} \\\\\n= 1 \\\\\n";
+    remove(TXC_TEST_CACHE);
+    int ec = cache_run(input, 0);
+    if (ec == 0)
+        ec = cache_output(expected);
+    if (ec == 0)
+        ec = cache_run(input, 5);
+    if (ec == 0)
+        ec = cache_output(expected);
+    remove(TXC_TEST_CACHE);
+    remove(TXC_TEST_CACHE ".in");
+    remove(TXC_TEST_CACHE ".out");
+    exit(ec);
+}
+
+static void parser_cache_variables(void)
+{
+    // once x is redefined, only z and the lines referring to y miss
+    const char *const input = "x = 7 \\\\\ny = x^2 \\\\\nz = 3 \\\\\ny + z \\\\\nz \\\\\n";
+    const char *const changed = "x = 8 \\\\\ny = x^2 \\\\\nz = 3 \\\\\ny + z \\\\\nz \\\\\n";
+    const char *const expected = "= 7 \\\\\n= 7 \\\\\n= {x}^{2} \\\\\n= 49 \\\\\n= 3 \\\\\n= 3 \\\\\n= (y + z) \\\\\n= 52 \\\\\n= z \\\\\n= 3 \\\\\n";
+    const char *const expected_changed = "= 8 \\\\\n= 8 \\\\\n= {x}^{2} \\\\\n= 64 \\\\\n= 3 \\\\\n= 3 \\\\\n= (y + z) \\\\\n= 67 \\\\\n= z \\\\\n= 3 \\\\\n";
+    remove(TXC_TEST_CACHE);
+    int ec = cache_run(input, 0);
+    if (ec == 0)
+        ec = cache_output(expected);
+    if (ec == 0)
+        ec = cache_run(input, 5);
+    if (ec == 0)
+        ec = cache_output(expected);
+    if (ec == 0)
+        ec = cache_run(changed, 2);
+    if (ec == 0)
+        ec = cache_output(expected_changed);
+    remove(TXC_TEST_CACHE);
+    remove(TXC_TEST_CACHE ".in");
+    remove(TXC_TEST_CACHE ".out");
+    exit(ec);
+}
+
 /* MAIN */
 
 int individual(char *name)
@@ -917,6 +2027,7 @@ int individual(char *name)
     TEST(integer_one)
     TEST(integer_zero)
     TEST(integer_copy)
+    TEST(integer_shared)
     TEST(integer_create_bin)
     TEST(integer_create_dec)
     TEST(integer_create_hex)
@@ -924,6 +2035,19 @@ int individual(char *name)
     TEST(integer_signed_add)
     TEST(integer_unsigned_mul)
     TEST(integer_signed_mul)
+    TEST(integer_mul_parallel)
+    TEST(integer_dec_parallel)
+    TEST(integer_pow)
+    TEST(integer_root)
+    TEST(integer_factorial)
+    TEST(integer_shift)
+    TEST(integer_addmul)
+    TEST(integer_fixed)
+    TEST(integer_divmod)
+    TEST(integer_divisor)
+    TEST(integer_mod)
+    TEST(rational_arithmetic)
+    TEST(rational_sum)
     TEST(integer_gcd)
     TEST(integer_div_invalid)
     TEST(integer_div)
@@ -931,13 +2055,40 @@ int individual(char *name)
     TEST(node_constants)
     TEST(node_create_nan)
     TEST(node_neg)
+    TEST(node_arena)
+    TEST(node_memo)
+    TEST(node_flat)
+    TEST(node_flat_eval)
     TEST(node_unsigned_add)
     TEST(node_signed_add)
     TEST(node_unsigned_mul)
     TEST(node_signed_mul)
     TEST(node_frac_int_normal)
     TEST(node_frac_int_inverted)
+    TEST(node_deep)
+    TEST(node_rewrites)
+    TEST(node_append)
+    TEST(node_fold)
+    TEST(var_invalidation)
+    TEST(var_lazy)
     TEST(parser_combined)
+    TEST(parser_pow)
+    TEST(parser_pow_frac)
+    TEST(parser_root)
+    TEST(parser_root_extract)
+    TEST(parser_rational)
+    TEST(parser_dot)
+    TEST(parser_mod)
+    TEST(parser_floor)
+    TEST(parser_factorial)
+    TEST(parser_shared)
+    TEST(parser_rewrites)
+    TEST(parser_variables)
+    TEST(parser_variables_rebind)
+    TEST(parser_variables_cycle)
+    TEST(parser_cache)
+    TEST(parser_cache_zeros)
+    TEST(parser_cache_variables)
     else
     {
         fprintf(stderr, "No test with name %s exists.\n", name);
@@ -960,6 +2111,7 @@ int main(int argc, char **argv)
         FUN(integer_one),
         FUN(integer_zero),
         FUN(integer_copy),
+        FUN(integer_shared),
         FUN(integer_create_bin),
         FUN(integer_create_dec),
         FUN(integer_create_hex),
@@ -967,6 +2119,19 @@ int main(int argc, char **argv)
         FUN(integer_signed_add),
         FUN(integer_unsigned_mul),
         FUN(integer_signed_mul),
+        FUN(integer_mul_parallel),
+        FUN(integer_dec_parallel),
+        FUN(integer_pow),
+        FUN(integer_root),
+        FUN(integer_factorial),
+        FUN(integer_shift),
+        FUN(integer_addmul),
+        FUN(integer_fixed),
+        FUN(integer_divmod),
+        FUN(integer_divisor),
+        FUN(integer_mod),
+        FUN(rational_arithmetic),
+        FUN(rational_sum),
         FUN(integer_gcd),
         FUN(integer_div_invalid),
         FUN(integer_div),
@@ -974,13 +2139,40 @@ int main(int argc, char **argv)
         FUN(node_constants),
         FUN(node_create_nan),
         FUN(node_neg),
+        FUN(node_arena),
+        FUN(node_memo),
+        FUN(node_flat),
+        FUN(node_flat_eval),
         FUN(node_unsigned_add),
         FUN(node_signed_add),
         FUN(node_unsigned_mul),
         FUN(node_signed_mul),
         FUN(node_frac_int_normal),
         FUN(node_frac_int_inverted),
-        FUN(parser_combined)
+        FUN(node_deep),
+        FUN(node_rewrites),
+        FUN(node_append),
+        FUN(node_fold),
+        FUN(var_invalidation),
+        FUN(var_lazy),
+        FUN(parser_combined),
+        FUN(parser_pow),
+        FUN(parser_pow_frac),
+        FUN(parser_root),
+        FUN(parser_root_extract),
+        FUN(parser_rational),
+        FUN(parser_dot),
+        FUN(parser_mod),
+        FUN(parser_floor),
+        FUN(parser_factorial),
+        FUN(parser_shared),
+        FUN(parser_rewrites),
+        FUN(parser_variables),
+        FUN(parser_variables_rebind),
+        FUN(parser_variables_cycle),
+        FUN(parser_cache),
+        FUN(parser_cache_zeros),
+        FUN(parser_cache_variables)
     };
     size_t total = sizeof tests / sizeof *tests;
     size_t passes = 0;
@@ -17,16 +17,83 @@
 
 #include "common.h"
 
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include "cache.h"
+#include "node.h"
 #include "parser.h"
+#include "pool.h"
+#include "var.h"
+
+#define TXC_USAGE "Usage: %s [-j threads] [-c cache_bytes] [-f cache_file] [-p] [-s]\n"
+#define TXC_STATS "Cache: %zu hits, %zu misses, %zu evictions, %zu entries in %zu bytes\n"
+#define TXC_REWRITE_STATS "Rewrites: %zu shifts, %zu units, %zu zeros, %zu quotients, %zu negations\n"
+#define TXC_FILE_STATS "Cache file: %zu hits, %zu misses, %zu stored\n"
+#define TXC_VAR_STATS "Variables: %zu evaluations (%zu flat), %zu invalidations\n"
+#define TXC_POOL_STATS "Threads: %zu\n"
 
 int main(int argc, char **argv)
 {
-    (void)argc;
-    (void)argv;
+    size_t threads = 1;
+    size_t cache_bytes = 0;
+    const char *cache_file = NULL;
+    bool fold = false;
+    bool stats = false;
+    for (int i = 1; i < argc; i++) {
+        char *end = NULL;
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = strtoul(argv[++i], &end, 10);
+            if (end != NULL && *end == 0)
+                continue;
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            cache_bytes = strtoul(argv[++i], &end, 10);
+            if (end != NULL && *end == 0)
+                continue;
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            cache_file = argv[++i];
+            continue;
+        } else if (strcmp(argv[i], "-p") == 0) {
+            fold = true;
+            continue;
+        } else if (strcmp(argv[i], "-s") == 0) {
+            stats = true;
+            continue;
+        }
+        fprintf(stderr, TXC_USAGE, argv[0]);
+        return EXIT_FAILURE;
+    }
     printf("This is TeXalC %u.%u.%u, a fancy calculator!\n", TXC_VERSION_MAJOR, TXC_VERSION_MINOR, TXC_VERSION_PATCH);
+    txc_pool_init(threads);
+    txc_node_memo_init(cache_bytes);
+    if (cache_file != NULL && !txc_cache_open(cache_file))
+        fprintf(stderr, "Continuing without the cache file %s.\n", cache_file);
+    // folded values are freed as soon as they are used up, which the arena would only do at the end of the line
+    txc_node_fold_enable(fold);
+    if (!fold)
+        txc_node_arena_init();
     int exit_code = yyparse();
+    txc_node_arena_free();
+    if (stats) {
+        const struct txc_node_memo_stats memo = txc_node_memo_stats();
+        fprintf(stderr, TXC_STATS, memo.hits, memo.misses, memo.evictions, memo.entries, memo.bytes);
+        const struct txc_node_rewrite_stats rewrite = txc_node_rewrite_stats();
+        fprintf(stderr, TXC_REWRITE_STATS, rewrite.shifts, rewrite.units, rewrite.zeros, rewrite.quotients, rewrite.negations);
+        if (cache_file != NULL) {
+            const struct txc_cache_stats file = txc_cache_stats();
+            fprintf(stderr, TXC_FILE_STATS, file.hits, file.misses, file.stored);
+        }
+        const struct txc_var_stats var = txc_var_stats();
+        fprintf(stderr, TXC_VAR_STATS, var.evaluations, var.flat_evaluations, var.invalidations);
+        // fewer than asked for with -j if some could not be started
+        fprintf(stderr, TXC_POOL_STATS, txc_pool_threads());
+    }
+    txc_cache_close();
+    txc_var_free();
+    txc_node_memo_free();
+    txc_pool_free();
     printf("Exiting TeXalC\n");
     return exit_code;
 }
@@ -16,6 +16,8 @@
  */
 
 #include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -60,3 +62,21 @@ char *txc_stpcpy(char *restrict dst, const char *restrict src)
     return dst + strlen(src);
 #endif /* _POSIX_VERSION >= 200809L */
 }
+
+void *txc_grow(void *const items, size_t *const size, const size_t element, const char *const purpose)
+{
+    assert(size != NULL);
+    assert(element > 0);
+    if (*size > SIZE_MAX / element / 2) {
+        TXC_ERROR_OVERFLOW(purpose);
+        return NULL;
+    }
+    const size_t grown = *size == 0 ? 64 : *size * 2;
+    void *const tmp = realloc(items, element * grown);
+    if (tmp == NULL) {
+        TXC_ERROR_ALLOC(element * grown, purpose);
+        return NULL;
+    }
+    *size = grown;
+    return tmp;
+}
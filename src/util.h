@@ -24,9 +24,12 @@
 #define TXC_ERROR_INVALID_CHILD_AMOUNT(type, amount) fprintf(stderr, "Node of type %u must not have %zu children at %s:%u.\n", type, amount, __FILE__, __LINE__)
 #define TXC_ERROR_INVALID_NODE_TYPE(type) fprintf(stderr, "Node type %u is invalid at %s:%u.\n", type, __FILE__, __LINE__)
 #define TXC_ERROR_INT_LEADING_ZERO() fprintf(stderr, "Integer must not have leading zero bytes at %s:%u.\n", __FILE__, __LINE__)
+#define TXC_ERROR_INT_UNREFERENCED() fprintf(stderr, "Integer must be referenced at least once at %s:%u.\n", __FILE__, __LINE__)
 #define TXC_ERROR_NULL(object) fprintf(stderr, "NULL is not allowed for %s at %s:%u.\n", object, __FILE__, __LINE__)
 #define TXC_ERROR_NYI(feature) fprintf(stderr, "%s is/are not yet implemented at %s:%u.\n", feature, __FILE__, __LINE__)
 #define TXC_ERROR_OVERFLOW(cause) fprintf(stderr, "Overflow was caught for %s in %s line %u.\n", cause, __FILE__, __LINE__)
+#define TXC_ERROR_THREAD(purpose) fprintf(stderr, "Creating a thread failed for %s at %s:%u.\n", purpose, __FILE__, __LINE__)
+#define TXC_ERROR_FILE(action, path) fprintf(stderr, "%s %s failed at %s:%u.\n", action, path, __FILE__, __LINE__)
 #define TXC_ERROR_OUT_OF_BOUNDS(index, bound) fprintf(stderr, "Index %zu out of bound %zu in %s line %u.\n", index, bound, __FILE__, __LINE__)
 
 struct txc_size_t_tuple {
@@ -43,4 +46,8 @@ extern char *txc_strrev(char *const str);
 
 extern char *txc_stpcpy(char *restrict dst, const char *restrict src);
 
+// Doubles an array of size elements (to 64 if it is empty), for the explicit stacks replacing recursion on trees.
+// Returns NULL and keeps items on failure.
+extern void *txc_grow(void *const items, size_t *const size, const size_t element, const char *const purpose);
+
 #endif /* TXC_UTIL */
@@ -0,0 +1,646 @@
+/*
+ *     Copyright (C) 2024 - 2025  Einholz
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU Affero General Public License as published
+ *     by the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU Affero General Public License for more details.
+ *
+ *     You should have received a copy of the GNU Affero General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flat.h"
+#include "integer.h"
+#include "node.h"
+#include "util.h"
+#include "var.h"
+
+// slots of the name index to start with, it doubles whenever it is half full
+#define TXC_VAR_SLOTS 64
+
+/* DEFINITIONS */
+
+// An input of the flat definition standing for a reference to variable.
+struct binding {
+    uint32_t input;
+    size_t variable;
+};
+
+// A vertex of the dependency graph, whose edges are kept both ways:
+// the dependencies are evaluated before the variable and the dependents are invalidated with it.
+struct variable {
+    char *name;
+    // on the heap, NULL while undefined
+    txc_node *definition;
+    // the definition with every reference as an input, built by the first evaluation depending on other variables
+    txc_flat *flat;
+    struct binding *bindings;
+    size_t bindings_used;
+    // on the heap, NULL until evaluated and again once the variable or one of its dependencies is redefined
+    txc_node *value;
+    // rendered value, which might be known without value
+    char *str;
+    bool nan;
+    // whether the definition alone tells that the value can only be a NAN for a lack of memory, valid with pure_known
+    bool pure;
+    bool pure_known;
+    size_t *dependencies;
+    size_t dependencies_used;
+    size_t *dependents;
+    size_t dependents_used;
+    size_t dependents_size;
+    // the last walk over the graph which reached this variable
+    size_t walk;
+};
+
+// Variables are addressed by their index, as the array moves when it grows.
+static struct variable *variables = NULL;
+static size_t variables_used = 0;
+static size_t variables_size = 0;
+// indices plus one by name, 0 for an empty slot
+static size_t *slots = NULL;
+static size_t slot_amount = 0;
+static size_t walks = 0;
+static struct txc_var_stats stats = { 0 };
+
+/* MEMORY */
+
+void txc_var_free(void)
+{
+    for (size_t i = 0; i < variables_used; i++) {
+        free(variables[i].name);
+        txc_node_free(variables[i].definition);
+        txc_flat_free(variables[i].flat);
+        free(variables[i].bindings);
+        txc_node_free(variables[i].value);
+        free(variables[i].str);
+        free(variables[i].dependencies);
+        free(variables[i].dependents);
+    }
+    free(variables);
+    free(slots);
+    variables = NULL;
+    variables_used = variables_size = 0;
+    slots = NULL;
+    slot_amount = 0;
+    walks = 0;
+    stats = (struct txc_var_stats){ 0 };
+}
+
+/* VARIABLES */
+
+// FNV-1a
+static size_t hash(const char *const name)
+{
+    uint64_t hash = 0xcbf29ce484222325u;
+    for (const char *c = name; *c != '\0'; c++)
+        hash = (hash ^ (unsigned char)*c) * 0x100000001b3u;
+    return (size_t)hash;
+}
+
+static size_t *slot_of(size_t *const table, const size_t amount, const char *const name)
+{
+    size_t i = hash(name) & (amount - 1);
+    while (table[i] != 0 && strcmp(variables[table[i] - 1].name, name) != 0)
+        i = (i + 1) & (amount - 1);
+    return &table[i];
+}
+
+static bool grow_slots(void)
+{
+    const size_t amount = slot_amount == 0 ? TXC_VAR_SLOTS : slot_amount * 2;
+    if (amount > SIZE_MAX / sizeof *slots) {
+        TXC_ERROR_OVERFLOW("variable slots");
+        return false;
+    }
+    size_t *const table = calloc(amount, sizeof *table);
+    if (table == NULL) {
+        TXC_ERROR_ALLOC(sizeof *table * amount, "variable slots");
+        return false;
+    }
+    for (size_t i = 0; i < variables_used; i++)
+        *slot_of(table, amount, variables[i].name) = i + 1;
+    free(slots);
+    slots = table;
+    slot_amount = amount;
+    return true;
+}
+
+// The index of the variable named name, which is created undefined if create is set. SIZE_MAX if there is none.
+static size_t find(const char *const name, const bool create)
+{
+    if (slots != NULL && *slot_of(slots, slot_amount, name) != 0)
+        return *slot_of(slots, slot_amount, name) - 1;
+    if (!create)
+        return SIZE_MAX;
+    if ((variables_used + 1) * 2 > slot_amount && !grow_slots())
+        return SIZE_MAX;
+    if (variables_used == variables_size) {
+        struct variable *const tmp = txc_grow(variables, &variables_size, sizeof *variables, "variables");
+        if (tmp == NULL)
+            return SIZE_MAX;
+        variables = tmp;
+    }
+    char *const dup = txc_strdup(name);
+    if (dup == NULL)
+        return SIZE_MAX;
+    memset(&variables[variables_used], 0, sizeof *variables);
+    variables[variables_used].name = dup;
+    *slot_of(slots, slot_amount, name) = variables_used + 1;
+    return variables_used++;
+}
+
+// x_{1} and x_1 are written the same, so subscripts of one character lose their braces.
+static char *canonical(const char *const name, const size_t len)
+{
+    char *const str = malloc(len + 1);
+    if (str == NULL) {
+        TXC_ERROR_ALLOC(len + 1, "variable name");
+        return NULL;
+    }
+    if (len == 5 && name[1] == '_' && name[2] == '{' && name[4] == '}') {
+        str[0] = name[0];
+        str[1] = '_';
+        str[2] = name[3];
+        str[3] = '\0';
+    } else {
+        memcpy(str, name, len);
+        str[len] = '\0';
+    }
+    return str;
+}
+
+static bool push(size_t **const stack, size_t *const used, size_t *const size, const size_t i, const char *const purpose)
+{
+    if (*used == *size) {
+        size_t *const tmp = txc_grow(*stack, size, sizeof **stack, purpose);
+        if (tmp == NULL)
+            return false;
+        *stack = tmp;
+    }
+    (*stack)[(*used)++] = i;
+    return true;
+}
+
+// The variables node refers to, each once, which are created undefined if necessary.
+static bool collect(const txc_node *const node, size_t **const found, size_t *const found_used)
+{
+    const size_t walk = ++walks;
+    size_t found_size = 0;
+    *found = NULL;
+    *found_used = 0;
+    const txc_node **stack = NULL;
+    size_t used = 0;
+    size_t size = 0;
+    const txc_node *cur = node;
+    bool success = true;
+    while (success) {
+        const char *const name = txc_node_variable_name(cur);
+        if (name != NULL) {
+            const size_t i = find(name, true);
+            success = i != SIZE_MAX;
+            if (success && variables[i].walk != walk) {
+                variables[i].walk = walk;
+                success = push(found, found_used, &found_size, i, "variable references");
+            }
+        }
+        for (size_t i = 0; success && i < txc_node_children_amount(cur); i++) {
+            if (used == size) {
+                const txc_node **const tmp = txc_grow(stack, &size, sizeof *stack, "reference stack");
+                success = tmp != NULL;
+                stack = success ? tmp : stack;
+            }
+            if (success)
+                stack[used++] = txc_node_child(cur, i);
+        }
+        if (used == 0)
+            break;
+        cur = stack[--used];
+    }
+    free(stack);
+    if (!success) {
+        free(*found);
+        *found = NULL;
+        *found_used = 0;
+    }
+    return success;
+}
+
+// Whether the dependencies starting from the amount variables in from lead to target. failed is set if memory ran out.
+static bool reaches(const size_t *const from, const size_t amount, const size_t target, bool *const failed)
+{
+    *failed = false;
+    // nothing can lead to a variable nothing depends on, which is the case for all new ones, so defining them stays cheap
+    if (variables[target].dependents_used == 0) {
+        for (size_t i = 0; i < amount; i++)
+            if (from[i] == target)
+                return true;
+        return false;
+    }
+    const size_t walk = ++walks;
+    size_t *stack = NULL;
+    size_t used = 0;
+    size_t size = 0;
+    bool reached = false;
+    for (size_t i = 0; !*failed && i < amount; i++)
+        *failed = !push(&stack, &used, &size, from[i], "cycle stack");
+    while (!reached && !*failed && used > 0) {
+        struct variable *const cur = &variables[stack[--used]];
+        if (cur->walk == walk)
+            continue;
+        cur->walk = walk;
+        reached = cur == &variables[target];
+        for (size_t i = 0; !reached && !*failed && i < cur->dependencies_used; i++)
+            *failed = !push(&stack, &used, &size, cur->dependencies[i], "cycle stack");
+    }
+    free(stack);
+    return reached;
+}
+
+static void drop_value(struct variable *const variable)
+{
+    if (variable->value != NULL || variable->str != NULL)
+        stats.invalidations++;
+    txc_node_free(variable->value);
+    free(variable->str);
+    variable->value = NULL;
+    variable->str = NULL;
+    variable->nan = false;
+    variable->pure = false;
+    variable->pure_known = false;
+}
+
+// Whether the variable holds anything derived from its dependencies.
+static bool settled(const struct variable *const variable)
+{
+    return variable->value != NULL || variable->str != NULL || variable->pure_known;
+}
+
+// The variable and everything depending on it lose their values and purity.
+// Both are only computed from those of the dependencies, so the dependents of other variables without either have none and the walk stops there.
+static void invalidate(const size_t i)
+{
+    size_t *stack = NULL;
+    size_t used = 0;
+    size_t size = 0;
+    size_t cur = i;
+    while (true) {
+        struct variable *const variable = &variables[cur];
+        if (cur == i || settled(variable)) {
+            drop_value(variable);
+            for (size_t j = 0; j < variable->dependents_used; j++) {
+                if (push(&stack, &used, &size, variable->dependents[j], "invalidation stack"))
+                    continue;
+                // values which are out of date must not stay, so all of them go
+                for (size_t k = 0; k < variables_used; k++)
+                    if (settled(&variables[k]))
+                        drop_value(&variables[k]);
+                free(stack);
+                return;
+            }
+        }
+        if (used == 0)
+            break;
+        cur = stack[--used];
+    }
+    free(stack);
+}
+
+static void unlink_dependent(const size_t dependency, const size_t dependent)
+{
+    struct variable *const variable = &variables[dependency];
+    for (size_t i = 0; i < variable->dependents_used; i++) {
+        if (variable->dependents[i] == dependent) {
+            variable->dependents[i] = variable->dependents[--variable->dependents_used];
+            return;
+        }
+    }
+}
+
+txc_node *txc_var_reference(const char *const name, const size_t len)
+{
+    char *const str = canonical(name, len);
+    // the variable exists from its first reference on, so lines without any need not be searched for them
+    if (str == NULL || find(str, true) == SIZE_MAX) {
+        free(str);
+        return (txc_node *)&TXC_NAN_ERROR_ALLOC;
+    }
+    txc_node *const node = txc_node_create_variable(str);
+    free(str);
+    return node;
+}
+
+const txc_node *txc_var_define(const txc_node *const var, const txc_node *const definition, const char *const str)
+{
+    assert(txc_node_get_type(var) == TXC_VARIABLE);
+    const size_t i = find(txc_node_variable_name(var), true);
+    size_t *dependencies;
+    size_t dependencies_used;
+    if (i == SIZE_MAX || !collect(definition, &dependencies, &dependencies_used))
+        return &TXC_NAN_ERROR_ALLOC;
+    bool failed;
+    if (reaches(dependencies, dependencies_used, i, &failed) || failed) {
+        free(dependencies);
+        return failed ? &TXC_NAN_ERROR_ALLOC : &TXC_NAN_ERROR_CYCLIC_DEFINITION;
+    }
+    // room for the new edges is made first, so linking them cannot fail halfway
+    for (size_t j = 0; j < dependencies_used; j++) {
+        struct variable *const dependency = &variables[dependencies[j]];
+        if (dependency->dependents_used < dependency->dependents_size)
+            continue;
+        size_t *const tmp = txc_grow(dependency->dependents, &dependency->dependents_size, sizeof *tmp, "dependents");
+        if (tmp == NULL) {
+            free(dependencies);
+            return &TXC_NAN_ERROR_ALLOC;
+        }
+        dependency->dependents = tmp;
+    }
+    txc_node *const cpy = txc_node_copy(definition);
+    char *const dup = str == NULL ? NULL : txc_strdup(str);
+    if (cpy == &TXC_NAN_ERROR_ALLOC || (str != NULL && dup == NULL)) {
+        free(dependencies);
+        txc_node_free(cpy);
+        free(dup);
+        return &TXC_NAN_ERROR_ALLOC;
+    }
+    struct variable *const variable = &variables[i];
+    for (size_t j = 0; j < variable->dependencies_used; j++)
+        unlink_dependent(variable->dependencies[j], i);
+    free(variable->dependencies);
+    variable->dependencies = dependencies;
+    variable->dependencies_used = dependencies_used;
+    for (size_t j = 0; j < dependencies_used; j++) {
+        struct variable *const dependency = &variables[dependencies[j]];
+        dependency->dependents[dependency->dependents_used++] = i;
+    }
+    txc_node_free(variable->definition);
+    variable->definition = cpy;
+    txc_flat_free(variable->flat);
+    free(variable->bindings);
+    variable->flat = NULL;
+    variable->bindings = NULL;
+    variable->bindings_used = 0;
+    invalidate(i);
+    variable->str = dup;
+    return NULL;
+}
+
+static const txc_node *value_of(const char *const name)
+{
+    const size_t i = find(name, false);
+    if (i == SIZE_MAX || variables[i].definition == NULL)
+        return &TXC_NAN_ERROR_UNKNOWN_VARIABLE;
+    // a dependency which could not be evaluated first
+    if (variables[i].value == NULL)
+        return &TXC_NAN_ERROR_ALLOC;
+    return variables[i].value;
+}
+
+// stands in for every reference while a flat definition is built
+static txc_node *placeholder = NULL;
+
+static const txc_node *placeholder_of(const char *const name)
+{
+    (void)name;
+    return placeholder;
+}
+
+// Inputs are numbered in post-order, which meets the leaves in the same order as this walk from the left.
+// Sets *inputs to the amount of leaves which became one.
+static bool bind_references(struct variable *const variable, uint32_t *const inputs)
+{
+    const txc_node **stack = NULL;
+    size_t used = 0;
+    size_t size = 0;
+    size_t bindings_size = 0;
+    uint32_t input = 0;
+    const txc_node *cur = variable->definition;
+    bool success = true;
+    while (success) {
+        const char *const name = txc_node_variable_name(cur);
+        if (name != NULL) {
+            struct binding *const tmp = variable->bindings_used < bindings_size ? variable->bindings : txc_grow(variable->bindings, &bindings_size, sizeof *tmp, "bindings");
+            success = tmp != NULL;
+            if (success) {
+                variable->bindings = tmp;
+                variable->bindings[variable->bindings_used++] = (struct binding){ input, find(name, false) };
+            }
+        }
+        if (name != NULL || txc_node_get_type(cur) == TXC_INT)
+            input++;
+        // pushed from the right, so the leftmost child is walked first
+        for (size_t i = txc_node_children_amount(cur); success && i-- > 0;) {
+            if (used == size) {
+                const txc_node **const tmp = txc_grow(stack, &size, sizeof *stack, "binding stack");
+                success = tmp != NULL;
+                stack = success ? tmp : stack;
+            }
+            if (success)
+                stack[used++] = txc_node_child(cur, i);
+        }
+        if (used == 0)
+            break;
+        cur = stack[--used];
+    }
+    free(stack);
+    *inputs = input;
+    return success;
+}
+
+static bool prepare_flat(struct variable *const variable)
+{
+    placeholder = txc_int_to_node(txc_int_create_zero());
+    if (txc_node_is_nan(placeholder))
+        return false;
+    txc_node *const tree = txc_node_substitute(variable->definition, &placeholder_of);
+    txc_node_free(placeholder);
+    placeholder = NULL;
+    variable->flat = txc_node_is_nan(tree) ? NULL : txc_flat_from_node(tree);
+    txc_node_free(tree);
+    uint32_t inputs;
+    if (variable->flat != NULL && bind_references(variable, &inputs)) {
+        assert(inputs == txc_flat_inputs(variable->flat));
+        return true;
+    }
+    txc_flat_free(variable->flat);
+    free(variable->bindings);
+    variable->flat = NULL;
+    variable->bindings = NULL;
+    variable->bindings_used = 0;
+    return false;
+}
+
+// Binds the values of the dependencies to the flat definition, which takes no tree unless the result is no integer.
+// Returns NULL if a value is no integer either, then the definition is left to txc_node_simplify.
+static txc_node *evaluate_flat(struct variable *const variable)
+{
+    if (variable->flat == NULL && !prepare_flat(variable))
+        return NULL;
+    for (size_t j = 0; j < variable->bindings_used; j++) {
+        const struct binding binding = variable->bindings[j];
+        txc_node *const value = variables[binding.variable].value;
+        if (value == NULL || txc_node_get_type(value) != TXC_INT || !txc_flat_bind(variable->flat, binding.input, txc_node_to_int(value)))
+            return NULL;
+    }
+    txc_node *const result = txc_flat_eval(variable->flat);
+    // the result might be in the arena, but values outlive the line
+    txc_node *const value = txc_node_copy(result);
+    txc_node_free(result);
+    stats.flat_evaluations++;
+    return value;
+}
+
+static void evaluate_one(const size_t i)
+{
+    const txc_node *const definition = variables[i].definition;
+    txc_node *value = variables[i].dependencies_used == 0 ? NULL : evaluate_flat(&variables[i]);
+    bool nan = value != NULL && txc_node_is_nan(value);
+    char *str = value == NULL ? NULL : txc_node_to_str(value);
+    if (value == NULL) {
+        txc_node *const resolved = variables[i].dependencies_used == 0 ? NULL : txc_node_substitute(definition, &value_of);
+        str = txc_node_simplify_to_str_and_keep(resolved == NULL ? definition : resolved, &nan, &value);
+        txc_node_free(resolved);
+    }
+    // a variable without a value counts as not evaluated yet, so the value of a failed evaluation is the NAN that failed it
+    if (value == NULL) {
+        value = (txc_node *)&TXC_NAN_ERROR_ALLOC;
+        nan = true;
+    }
+    struct variable *const variable = &variables[i];
+    variable->value = value;
+    free(variable->str);
+    variable->str = str;
+    variable->nan = nan;
+    stats.evaluations++;
+}
+
+// Dependencies are evaluated first, on an explicit stack as chains of definitions can be long.
+static void evaluate(const size_t i)
+{
+    size_t *stack = NULL;
+    size_t used = 0;
+    size_t size = 0;
+    if (!push(&stack, &used, &size, i, "evaluation stack")) {
+        if (variables[i].definition != NULL && variables[i].value == NULL)
+            evaluate_one(i);
+        return;
+    }
+    while (used > 0) {
+        const size_t cur = stack[used - 1];
+        const struct variable *const variable = &variables[cur];
+        if (variable->definition == NULL || variable->value != NULL) {
+            used--;
+            continue;
+        }
+        bool pushed = false;
+        bool room = true;
+        for (size_t j = 0; !pushed && room && j < variable->dependencies_used; j++) {
+            const size_t dependency = variable->dependencies[j];
+            if (variables[dependency].definition == NULL || variables[dependency].value != NULL)
+                continue;
+            // without room the dependencies left are missing from the value, which turns into a NAN
+            room = push(&stack, &used, &size, dependency, "evaluation stack");
+            pushed = room;
+        }
+        if (pushed)
+            continue;
+        evaluate_one(cur);
+        used--;
+    }
+    free(stack);
+}
+
+const char *txc_var_str(const char *const name, const size_t len, bool *const nan)
+{
+    assert(nan != NULL);
+    *nan = false;
+    char *const str = canonical(name, len);
+    const size_t i = str == NULL ? SIZE_MAX : find(str, false);
+    free(str);
+    if (i == SIZE_MAX || variables[i].definition == NULL)
+        return NULL;
+    if (variables[i].str == NULL)
+        evaluate(i);
+    *nan = variables[i].nan;
+    return variables[i].str;
+}
+
+const txc_node *txc_var_value(const char *const name)
+{
+    const size_t i = find(name, false);
+    if (i != SIZE_MAX && variables[i].definition != NULL && variables[i].value == NULL)
+        evaluate(i);
+    return value_of(name);
+}
+
+// Undefined variables are NANs and never pure, a known value tells more than the definition.
+static bool pure_of(const char *const name)
+{
+    const size_t i = find(name, false);
+    if (i == SIZE_MAX)
+        return false;
+    const struct variable *const variable = &variables[i];
+    return variable->value != NULL || variable->str != NULL ? !variable->nan : variable->pure;
+}
+
+static bool pure_settled(const struct variable *const variable)
+{
+    return variable->definition == NULL || settled(variable);
+}
+
+// The dependencies are settled first, on an explicit stack like in evaluate.
+bool txc_var_pure(const char *const name)
+{
+    const size_t i = find(name, false);
+    size_t *stack = NULL;
+    size_t used = 0;
+    size_t size = 0;
+    if (i == SIZE_MAX || pure_settled(&variables[i]) || !push(&stack, &used, &size, i, "purity stack"))
+        return pure_of(name);
+    while (used > 0) {
+        struct variable *const variable = &variables[stack[used - 1]];
+        if (pure_settled(variable)) {
+            used--;
+            continue;
+        }
+        bool pushed = false;
+        bool room = true;
+        for (size_t j = 0; !pushed && room && j < variable->dependencies_used; j++) {
+            const size_t dependency = variable->dependencies[j];
+            if (pure_settled(&variables[dependency]))
+                continue;
+            room = push(&stack, &used, &size, dependency, "purity stack");
+            pushed = room;
+        }
+        // a purity missing for a lack of memory is asked for again next time
+        if (!room)
+            break;
+        if (pushed)
+            continue;
+        variable->pure = txc_node_pure(variable->definition, &pure_of);
+        variable->pure_known = true;
+        used--;
+    }
+    free(stack);
+    return pure_of(name);
+}
+
+struct txc_var_stats txc_var_stats(void)
+{
+    return stats;
+}
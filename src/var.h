@@ -0,0 +1,65 @@
+/*
+ *     Copyright (C) 2024 - 2025  Einholz
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU Affero General Public License as published
+ *     by the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU Affero General Public License for more details.
+ *
+ *     You should have received a copy of the GNU Affero General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TXC_VAR
+#define TXC_VAR
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "node.h"
+
+/* DEFINITIONS */
+
+struct txc_var_stats {
+    size_t evaluations;
+    // evaluations of definitions with references on their flat tree
+    size_t flat_evaluations;
+    size_t invalidations;
+};
+
+/* MEMORY */
+
+extern void txc_var_free(void);
+
+/* VARIABLES */
+
+// Variables are a letter with an optional subscript, where x_{1} and x_1 are the same.
+// Returns a VARIABLE node for the name of length len.
+extern txc_node *txc_var_reference(const char *const name, const size_t len);
+
+// Definitions are kept with their variables, which may also be defined later on and are NANs until then.
+// The values depending on var are dropped and only evaluated again once they are asked for.
+// str is the rendered value of definition if it is known already, so var is not evaluated before it is needed either.
+// Returns NULL, or a NAN telling why the old definition is kept.
+extern const txc_node *txc_var_define(const txc_node *const var, const txc_node *const definition, const char *const str);
+
+// The rendered value of the variable named by the len characters of name, which is evaluated unless known. nan is set if it is a NAN.
+// Returns NULL if the variable is not defined or rendering failed.
+extern const char *txc_var_str(const char *const name, const size_t len, bool *const nan);
+
+// The value of the variable named name, which is evaluated unless known, or a NAN if it is not defined.
+extern const txc_node *txc_var_value(const char *const name);
+
+// Whether the value of the variable named name can only be a NAN for a lack of memory, which is told without evaluating it.
+extern bool txc_var_pure(const char *const name);
+
+extern struct txc_var_stats txc_var_stats(void);
+
+#endif /* TXC_VAR */